@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+
+/*
+ * Many topics over a few channels.
+ *
+ * A bus is a directory segment ("__BUS_DIR__<name>") mapping topic names to
+ * topic ids, and a fixed number of broadcast channels, the rings
+ * ("__BUS<k>__<name>"). Topic id t always goes through ring (t - 1) % rings.
+ * Messages are tagged with the id of their topic, and every receiver skips the
+ * topics it has not subscribed to in place, in the queue (see chan_wrapper::subscribe).
+ * Whatever the number of topics, a bus uses the same shm objects,
+ * so registering or subscribing to a topic creates no OS object.
+ *
+ * A bus object only receives on the rings holding a topic it has subscribed to,
+ * or on all of them while it has a wildcard subscription. Like any broadcast
+ * channel, a ring takes at most 32 receivers, and a slow receiver only holds
+ * back the senders of its own rings. Messages keep their order on a topic,
+ * but not across topics of different rings.
+ *
+ * Topic names are like "sensors/left/temp", at most max_topic_name characters.
+ * Subscriptions take either a topic name or a pattern where, as in MQTT,
+ * '+' stands for exactly one level and a final '#' for all the remaining ones:
+ * "sensors/+/temp", "sensors/#".
+ *
+ * As on any channel, a bus object does not receive what it has published itself.
+ * A bus object is not thread-safe: subscribe from the thread that receives.
+*/
+
+class IPC_EXPORT bus {
+    bus(bus const &) = delete;
+    bus &operator=(bus const &) = delete;
+
+public:
+    enum : std::size_t {
+        max_topics     = 4096,
+        max_topic_name = 55,
+        default_rings  = 4,
+        max_rings      = 64
+    };
+
+    bus();
+    explicit bus(char const * name, unsigned mode = ipc::sender | ipc::receiver,
+                 std::size_t rings = default_rings);
+    ~bus();
+
+    bool valid() const noexcept;
+
+    /**
+     * The first object connecting to a bus sets its number of rings,
+     * the rings argument of the others is ignored.
+    */
+    bool connect(char const * name, unsigned mode = ipc::sender | ipc::receiver,
+                 std::size_t rings = default_rings);
+    void disconnect() noexcept;
+
+    /**
+     * The number of rings of the bus, 0 if not connected.
+    */
+    std::size_t rings() const noexcept;
+
+    /**
+     * The id of a topic, registered on first use.
+     * Returns 0 for an invalid name, or if the directory is full.
+    */
+    topic_t topic(char const * name);
+
+    /**
+     * The name of a registered topic id, nullptr if unknown.
+    */
+    char const * topic_name(topic_t topic) const;
+
+    /**
+     * Sends a message on a topic (see chan_wrapper::send for tm).
+     * If no one receives on the ring of the topic, the message is dropped
+     * and it returns true.
+    */
+    bool publish(topic_t topic, void const * data, std::size_t size, std::uint64_t tm = default_timeout);
+    bool publish(char const * topic, void const * data, std::size_t size, std::uint64_t tm = default_timeout);
+
+    bool publish(char const * topic, std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->publish(topic, str.c_str(), str.size() + 1, tm);
+    }
+
+    /**
+     * Subscribes to a topic name or pattern.
+     * Topics registered later are matched against the patterns as well.
+     * Subscriptions are checked when a message is received,
+     * so they also apply to the messages already queued.
+    */
+    bool subscribe(char const * pattern);
+    void unsubscribe(char const * pattern);
+
+    /**
+     * Receives a message of a subscribed topic (tm is in ms).
+     * If topic isn't nullptr, it receives the topic of the message.
+     * A receiver without any subscription receives nothing.
+    */
+    buffer recv(std::uint64_t tm = invalid_value, topic_t * topic = nullptr);
+    buffer try_recv(topic_t * topic = nullptr);
+
+private:
+    class bus_;
+    bus_* p_;
+};
+
+} // namespace ipc
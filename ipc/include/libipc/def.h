@@ -23,6 +23,8 @@ template <> struct uint<64> { using type = std::uint64_t; };
 template <std::size_t N>
 using uint_t = typename uint<N>::type;
 
+using topic_t = std::uint16_t; // message tag for subscriptions, 0 if untagged
+
 // constants
 
 enum : std::uint32_t {
@@ -37,6 +39,20 @@ enum : std::size_t {
     large_msg_cache = 32,
 };
 
+// Minimum offset between two objects to avoid false sharing.
+enum : std::size_t {
+// #if __cplusplus >= 201703L
+//     cache_line_size = std::hardware_destructive_interference_size
+// #else /*__cplusplus < 201703L*/
+    cache_line_size = 64
+// #endif/*__cplusplus < 201703L*/
+};
+
+constexpr std::size_t make_align(std::size_t align, std::size_t size) noexcept {
+    // align must be 2^n
+    return (size + align - 1) & ~(align - 1);
+}
+
 enum class relat { // multiplicity of the relationship
     single,
     multi
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+
+namespace ipc {
+
+/*
+ * Bridges a channel to another host over a stream socket.
+ *
+ * gateway_out drains a local channel and writes its messages to a socket,
+ * gateway_in accepts that socket on the other side and re-sends every message
+ * into a local channel of the same kind.
+ * Endpoints are "tcp://host:port" or "unix://path".
+ *
+ * On the wire, a message is its length (4 bytes, little-endian) followed by its bytes.
+ * The messages queued behind the first one are taken in the same pass (up to 'batch'),
+ * and written together with a single gathering write.
+ *
+ * The bridge drops nothing by itself. When the receivers behind gateway_in lag,
+ * or there is no receiver at all, it keeps the messages it could not re-send
+ * and stops reading the socket; the socket buffers fill up, gateway_out waits
+ * in its write and stops draining, and the backlog shows up in the source channel
+ * just as with any slow local receiver.
+ * Messages are lost only with the connection: the bytes of a message that
+ * gateway_out was writing when it stopped or failed, and the partial message
+ * gateway_in holds when its peer goes away.
+ *
+ * Flag must match the channel kind (ipc::route or ipc::channel) used for the name.
+ * Not available on Windows yet: open() fails there.
+*/
+
+template <typename Flag>
+class IPC_EXPORT gateway_out {
+    gateway_out(gateway_out const &) = delete;
+    gateway_out &operator=(gateway_out const &) = delete;
+
+public:
+    enum : std::size_t {
+        default_batch = 64
+    };
+
+    gateway_out();
+    gateway_out(char const * channel, char const * endpoint, std::size_t batch = default_batch);
+    ~gateway_out();
+
+    /**
+     * Connects to channel as a receiver, then connects the socket to endpoint.
+    */
+    bool open(char const * channel, char const * endpoint, std::size_t batch = default_batch);
+    void close() noexcept;
+
+    /**
+     * Whether the socket is still usable.
+    */
+    bool valid() const noexcept;
+
+    /**
+     * Waits for a message (tm is in ms), then forwards it with the ones queued behind it.
+     * Returns the number of messages written. On a socket error, the gateway is closed.
+    */
+    std::size_t pump(std::uint64_t tm = invalid_value);
+
+    /**
+     * Pumps until stop() is called (returns true), or until the socket breaks (returns false).
+     * stop() also interrupts a write to a peer that has stopped reading,
+     * which closes the socket.
+    */
+    bool run();
+    void stop() noexcept;
+
+private:
+    class gateway_out_;
+    gateway_out_* p_;
+};
+
+template <typename Flag>
+class IPC_EXPORT gateway_in {
+    gateway_in(gateway_in const &) = delete;
+    gateway_in &operator=(gateway_in const &) = delete;
+
+public:
+    enum : std::size_t {
+        default_max_size = 16 * 1024 * 1024
+    };
+
+    gateway_in();
+    gateway_in(char const * endpoint, char const * channel, std::size_t max_size = default_max_size);
+    ~gateway_in();
+
+    /**
+     * Listens on endpoint, and connects to channel as a sender.
+     * A "unix://" path still accepted on by another gateway is not taken over:
+     * open() fails; a stale socket file is replaced.
+     * A new peer is accepted whenever the previous one has gone.
+     * A peer announcing an empty message, or one larger than max_size bytes,
+     * is taken for broken or hostile and disconnected.
+    */
+    bool open(char const * endpoint, char const * channel, std::size_t max_size = default_max_size);
+    void close() noexcept;
+
+    /**
+     * Whether it is still listening.
+    */
+    bool valid() const noexcept;
+
+    /**
+     * The endpoint actually listened on (with the port chosen for "tcp://host:0").
+    */
+    std::string endpoint() const;
+
+    /**
+     * Accepts a peer or reads what it sent, waiting at most tm ms,
+     * then re-sends every complete message into the channel.
+     * Messages left over by a previous call, because the receivers lagged,
+     * are re-sent first; the socket is not read until they are all out.
+     * Returns the number of messages re-sent.
+    */
+    std::size_t pump(std::uint64_t tm = invalid_value);
+
+    /**
+     * Pumps until stop() is called (returns true), or until listening fails (returns false).
+    */
+    bool run();
+    void stop() noexcept;
+
+private:
+    class gateway_in_;
+    gateway_in_* p_;
+};
+
+using route_gateway_out   = gateway_out<wr<relat::single, relat::multi, trans::broadcast>>;
+using route_gateway_in    = gateway_in <wr<relat::single, relat::multi, trans::broadcast>>;
+using channel_gateway_out = gateway_out<wr<relat::multi , relat::multi, trans::broadcast>>;
+using channel_gateway_in  = gateway_in <wr<relat::multi , relat::multi, trans::broadcast>>;
+
+} // namespace ipc
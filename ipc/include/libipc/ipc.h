@@ -31,15 +31,42 @@ struct IPC_EXPORT chan_impl {
 
     static bool   send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
     static buff_t recv(ipc::handle_t h, std::uint64_t tm);
+    static buff_t recv(ipc::handle_t h, std::uint64_t tm, ipc::topic_t * topic);
 
     static bool   try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
     static buff_t try_recv(ipc::handle_t h);
+
+    static bool send    (ipc::handle_t h, ipc::topic_t topic, void const * data, std::size_t size, std::uint64_t tm);
+    static bool try_send(ipc::handle_t h, ipc::topic_t topic, void const * data, std::size_t size, std::uint64_t tm);
+
+    static void subscribe      (ipc::handle_t h, ipc::topic_t topic, bool on);
+    static void unsubscribe_all(ipc::handle_t h);
+
+    static std::size_t credits(ipc::handle_t h);
+    static bool wait_for_credits(ipc::handle_t h, std::size_t count, std::uint64_t tm);
+    static void set_window(ipc::handle_t h, std::size_t window);
 };
 
+#if defined(LIBIPC_HEADER_ONLY)
+namespace detail {
+
+/**
+ * Same interface as chan_impl, defined inline in libipc/ipc.inc.
+*/
+template <typename Flag>
+struct chan_inline;
+
+} // namespace detail
+#endif
+
 template <typename Flag>
 class chan_wrapper {
 private:
+#if defined(LIBIPC_HEADER_ONLY)
+    using detail_t = detail::chan_inline<Flag>;
+#else
     using detail_t = chan_impl<Flag>;
+#endif
 
     ipc::handle_t h_ = nullptr;
     unsigned mode_   = ipc::sender;
@@ -154,13 +181,94 @@ public:
         return this->try_send(str.c_str(), str.size() + 1, tm);
     }
 
+    /**
+     * Same as above, with the message tagged by topic (see subscribe).
+    */
+    bool send(ipc::topic_t topic, void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return detail_t::send(h_, topic, data, size, tm);
+    }
+    bool send(ipc::topic_t topic, buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->send(topic, buff.data(), buff.size(), tm);
+    }
+    bool send(ipc::topic_t topic, std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->send(topic, str.c_str(), str.size() + 1, tm);
+    }
+
+    bool try_send(ipc::topic_t topic, void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return detail_t::try_send(h_, topic, data, size, tm);
+    }
+    bool try_send(ipc::topic_t topic, buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->try_send(topic, buff.data(), buff.size(), tm);
+    }
+    bool try_send(ipc::topic_t topic, std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->try_send(topic, str.c_str(), str.size() + 1, tm);
+    }
+
     buff_t recv(std::uint64_t tm = invalid_value) {
         return detail_t::recv(h_, tm);
     }
 
+    /**
+     * Like recv, and stores the topic the message was sent with in *topic.
+    */
+    buff_t recv(std::uint64_t tm, ipc::topic_t * topic) {
+        return detail_t::recv(h_, tm, topic);
+    }
+
     buff_t try_recv() {
         return detail_t::try_recv(h_);
     }
+
+    /**
+     * Once subscribed to a topic, this connection only receives the messages tagged
+     * with one of its subscribed topics (0 for the untagged ones).
+     * Other messages, like the ones sent through this very connection, are skipped
+     * in the queue without being copied out.
+     * Broadcast only: on a unicast channel a skipped message would be lost to
+     * the other receivers too, so subscribing there is refused and changes nothing.
+     * Not to be called while another thread is receiving through the same object.
+    */
+    void subscribe(ipc::topic_t topic) {
+        detail_t::subscribe(h_, topic, true);
+    }
+
+    void unsubscribe(ipc::topic_t topic) {
+        detail_t::subscribe(h_, topic, false);
+    }
+
+    /**
+     * Receives every message again, whatever its topic.
+    */
+    void unsubscribe_all() {
+        detail_t::unsubscribe_all(h_);
+    }
+
+    /**
+     * Flow control, on the sender side: how many messages could be sent right now
+     * without waiting, as granted by the slowest receiver (0 without any receiver).
+     * Only shared counters are read, so it is cheap enough to check before
+     * building a message, then to batch, delay or drop it instead of blocking in send.
+     * Messages which can't get a chunk for their payload take (size - 1) / data_length + 1 credits.
+    */
+    std::size_t credits() const {
+        return detail_t::credits(h_);
+    }
+
+    /**
+     * Waits until at least count credits are available (tm is in ms).
+    */
+    bool wait_for_credits(std::size_t count, std::uint64_t tm = invalid_value) const {
+        return detail_t::wait_for_credits(h_, count, tm);
+    }
+
+    /**
+     * Flow control, on the receiver side: grants senders at most window messages
+     * ahead of this receiver (0, the default, for the whole queue).
+     * Senders see it through credits(); send itself is still only bounded by the queue.
+    */
+    void set_window(std::size_t window) {
+        detail_t::set_window(h_, window);
+    }
 };
 
 template <relat Rp, relat Rc, trans Ts>
@@ -190,3 +298,15 @@ using route = chan<relat::single, relat::multi, trans::broadcast>;
 using channel = chan<relat::multi, relat::multi, trans::broadcast>;
 
 } // namespace ipc
+
+#if defined(LIBIPC_HEADER_ONLY)
+/**
+ * Define LIBIPC_HEADER_ONLY (the same way in every translation unit) to let
+ * the compiler inline send/recv into user code. It needs libipc's src directory
+ * on the include path, and still links against the library for shm and sync.
+ *
+ * The private headers are not installed, so this mode is only available
+ * when building against the libipc source tree (add_subdirectory).
+*/
+#include "libipc/ipc.inc"
+#endif
@@ -0,0 +1,535 @@
+#pragma once
+
+/*
+ * Journaling and replay of channel traffic.
+ *
+ * Header-only, and unlike the rest of libipc it needs C++20 and mio
+ * (mio/mio.hpp on the include path): segments are written through
+ * mio::mmap_sink and read back through mio::mmap_source.
+ *
+ * A journal is a series of segment files "<base>.<index>.journal".
+ * Each segment is preallocated to its full size when it is created,
+ * then filled through its mapping: appending a message is a memcpy and
+ * a store, without any system call. The next segment is prepared on a
+ * helper thread as soon as the current one is half full, so rolling over
+ * only waits if that thread has not finished by then.
+ *
+ * Nothing is printed: a writer or reader that fails keeps the cause,
+ * see error().
+ *
+ * Segment layout (little-endian, as written by the host):
+ *   segment_head, then records, each one a record_head followed by
+ *   the message bytes, padded to record_align.
+ * segment_head::used_ is stored (release) after every append, so a reader
+ * may follow a journal that is still being written.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mio/mio.hpp"
+
+#include "libipc/def.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+namespace journal {
+
+enum : std::size_t {
+    default_segment_size = 64 * 1024 * 1024,
+    record_align         = 8
+};
+
+constexpr char const magic[8] = {'I', 'P', 'C', 'J', 'R', 'N', 'L', '\0'};
+constexpr std::uint32_t version = 1;
+
+struct segment_head {
+    char          magic_[8];
+    std::uint32_t version_;
+    std::uint32_t index_;
+    std::uint64_t size_;    // of the segment file
+    std::uint64_t used_;    // bytes holding complete records, this head included
+    std::uint64_t count_;   // records in this segment
+    std::uint8_t  reserved_[24];
+};
+static_assert(sizeof(segment_head) == 64, "Unexpected segment_head size.");
+
+struct record_head {
+    std::uint64_t ts_;      // ns since the epoch of std::chrono::system_clock
+    std::uint32_t size_;    // of the message, without padding
+    std::uint32_t flags_;   // reserved, 0
+};
+static_assert(sizeof(record_head) % record_align == 0, "Unexpected record_head size.");
+
+constexpr std::size_t record_size(std::size_t msg_size) noexcept {
+    return sizeof(record_head) + (((msg_size + record_align - 1) / record_align) * record_align);
+}
+
+inline std::filesystem::path segment_path(std::filesystem::path const & base, std::uint32_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06u.journal", index);
+    auto p = base;
+    p += suffix;
+    return p;
+}
+
+inline std::uint64_t now_ns() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * One message read back from a journal.
+ * data points into the mapped segment, and stays valid until the next read.
+*/
+struct record {
+    std::uint64_t ts   = 0;
+    void const *  data = nullptr;
+    std::size_t   size = 0;
+};
+
+/**
+ * Appends messages to a journal.
+ * Not movable: the helper thread preparing the next segment refers to it.
+*/
+class writer {
+    struct segment_t {
+        mio::mmap_sink sink_;
+        std::uint32_t  index_ = 0;
+
+        segment_head * head() noexcept {
+            return reinterpret_cast<segment_head *>(sink_.data());
+        }
+    };
+
+    std::filesystem::path base_;
+    std::size_t   segment_size_ = default_segment_size;
+    segment_t     curr_, next_;
+    std::future<std::error_code> next_ready_; // next_ is being prepared while valid()
+    std::uint32_t index_ = 0;
+    std::uint64_t count_ = 0;
+    std::error_code error_;
+
+    static std::error_code preallocate(std::filesystem::path const & path, std::size_t size) {
+#if !defined(_WIN32)
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return {errno, std::system_category()};
+        // reserve the blocks now, not on a page fault in the middle of an append
+        int err = (::ftruncate(fd, static_cast<off_t>(size)) == 0) ? 0 : errno;
+#if defined(__linux__)
+        if (err == 0) err = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+#endif
+        ::close(fd);
+        return {err, std::system_category()};
+#else
+        std::error_code ec;
+        { std::FILE * f = std::fopen(path.string().c_str(), "wb"); if (f != nullptr) std::fclose(f); }
+        std::filesystem::resize_file(path, size, ec);
+        return ec;
+#endif
+    }
+
+    std::error_code create(segment_t & seg, std::uint32_t index, std::size_t size) {
+        auto path = segment_path(base_, index);
+        auto ec = preallocate(path, size);
+        if (ec) return ec;
+        seg.sink_.map(path.string(), ec);
+        if (ec) return ec;
+        seg.index_ = index;
+        auto head = seg.head();
+        std::memset(head, 0, sizeof(segment_head));
+        std::memcpy(head->magic_, magic, sizeof(magic));
+        head->version_ = version;
+        head->index_   = index;
+        head->size_    = size;
+        std::atomic_ref<std::uint64_t>{head->used_}.store(sizeof(segment_head), std::memory_order_release);
+        return {};
+    }
+
+    /* Waits for the helper thread, if next_ is being prepared. */
+    void join_next() {
+        if (!next_ready_.valid()) return;
+        if (next_ready_.get()) next_.sink_.unmap(); // a failed preparation is retried when rolling over
+    }
+
+    /* Makes room for a record of rec_size bytes, rolling to the next segment if needed. */
+    bool reserve(std::size_t rec_size) {
+        auto head = curr_.head();
+        if (head->used_ + rec_size <= head->size_) return true;
+        std::error_code ec;
+        curr_.sink_.sync(ec);
+        curr_.sink_.unmap();
+        auto need = sizeof(segment_head) + rec_size;
+        join_next();
+        if (next_.sink_.is_mapped()) {
+            if (next_.sink_.size() >= need) {
+                std::swap(curr_, next_);
+                ++index_;
+                return true;
+            }
+            // too small for this record: recreated below
+            next_.sink_.unmap();
+        }
+        if ((error_ = create(curr_, index_ + 1, (std::max)(segment_size_, need)))) {
+            return false;
+        }
+        ++index_;
+        return true;
+    }
+
+public:
+    writer() = default;
+    writer(writer const &) = delete;
+    writer &operator=(writer const &) = delete;
+
+    writer(std::filesystem::path base, std::size_t segment_size = default_segment_size) {
+        open(std::move(base), segment_size);
+    }
+
+    ~writer() {
+        close();
+    }
+
+    bool valid() const noexcept {
+        return curr_.sink_.is_mapped();
+    }
+
+    /**
+     * Starts a new journal at base, replacing its segments if they exist.
+    */
+    bool open(std::filesystem::path base, std::size_t segment_size = default_segment_size) {
+        close();
+        base_ = std::move(base);
+        segment_size_ = (std::max)(segment_size, sizeof(segment_head) + record_size(0));
+        index_ = 0;
+        count_ = 0;
+        // stale segments of an older journal would be read as part of this one
+        std::error_code ec;
+        for (std::uint32_t i = 0; std::filesystem::remove(segment_path(base_, i), ec); ++i) ;
+        error_ = create(curr_, 0, segment_size_);
+        return !error_;
+    }
+
+    void close() {
+        std::error_code ec;
+        join_next();
+        if (curr_.sink_.is_mapped()) {
+            curr_.sink_.sync(ec);
+            curr_.sink_.unmap();
+        }
+        if (next_.sink_.is_mapped()) {
+            // prepared but never used
+            next_.sink_.unmap();
+            std::filesystem::remove(segment_path(base_, next_.index_), ec);
+        }
+    }
+
+    /**
+     * Appends one message, stamped with ts (default: now).
+    */
+    bool append(void const * data, std::size_t size, std::uint64_t ts = now_ns()) {
+        if (!valid() || (size > 0xffffffffu)) return false;
+        auto rec_size = record_size(size);
+        if (!reserve(rec_size)) return false;
+        auto head = curr_.head();
+        auto used = head->used_;
+        auto rec  = reinterpret_cast<record_head *>(curr_.sink_.data() + used);
+        rec->ts_    = ts;
+        rec->size_  = static_cast<std::uint32_t>(size);
+        rec->flags_ = 0;
+        if (size != 0) std::memcpy(rec + 1, data, size);
+        head->count_ += 1;
+        std::atomic_ref<std::uint64_t>{head->used_}.store(used + rec_size, std::memory_order_release);
+        ++count_;
+        // prepare the next segment ahead of time, off the recording thread
+        if (!next_ready_.valid() && !next_.sink_.is_mapped() && (used + rec_size > head->size_ / 2)) {
+            next_ready_ = std::async(std::launch::async, [this, index = curr_.index_ + 1] {
+                return create(next_, index, segment_size_);
+            });
+        }
+        return true;
+    }
+
+    /**
+     * Asks the OS to write the mapped pages back to disk.
+    */
+    void flush() {
+        std::error_code ec;
+        if (curr_.sink_.is_mapped()) curr_.sink_.sync(ec);
+    }
+
+    std::uint64_t count() const noexcept {
+        return count_;
+    }
+
+    /**
+     * Why the last open or roll-over failed, empty if none did.
+    */
+    std::error_code error() const noexcept {
+        return error_;
+    }
+};
+
+/**
+ * Reads a journal back, in order, across its segments.
+*/
+class reader {
+    std::filesystem::path base_;
+    mio::mmap_source src_;
+    mio::mmap_source next_src_; // the following segment, once found, while this one is drained
+    std::uint32_t index_  = 0;
+    std::uint64_t offset_ = 0;
+    std::error_code error_;
+
+    segment_head const * head() const noexcept {
+        return reinterpret_cast<segment_head const *>(src_.data());
+    }
+
+    /* Maps segment index into src, if it exists and holds a record. */
+    bool map(std::uint32_t index, mio::mmap_source & out) {
+        auto path = segment_path(base_, index);
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) return false;
+        // a following segment may still be being created by the writer's helper thread
+        if ((index != 0) && (std::filesystem::file_size(path, ec) < sizeof(segment_head))) return false;
+        mio::mmap_source src;
+        src.map(path.string(), ec);
+        if (ec) {
+            error_ = ec;
+            return false;
+        }
+        auto h = reinterpret_cast<segment_head const *>(src.data());
+        if ((index != 0) && (src.size() >= sizeof(segment_head)) &&
+            (std::atomic_ref<std::uint64_t const>{h->used_}.load(std::memory_order_acquire) == 0)) {
+            return false; // its head is not written yet
+        }
+        if ((src.size() < sizeof(segment_head)) ||
+            (std::memcmp(h->magic_, magic, sizeof(magic)) != 0) || (h->version_ != version)) {
+            error_ = std::make_error_code(std::errc::invalid_argument); // not a journal segment
+            return false;
+        }
+        if ((index != 0) && (std::atomic_ref<std::uint64_t const>{h->used_}.load(std::memory_order_acquire)
+                             == sizeof(segment_head))) {
+            // prepared ahead by the writer, which may still be filling the current one
+            return false;
+        }
+        out = std::move(src);
+        return true;
+    }
+
+    bool map(std::uint32_t index) {
+        if (!next_src_.is_mapped() && !map(index, next_src_)) return false;
+        src_    = std::move(next_src_);
+        index_  = index;
+        offset_ = sizeof(segment_head);
+        next_src_.unmap();
+        return true;
+    }
+
+    bool corrupt() {
+        error_ = std::make_error_code(std::errc::illegal_byte_sequence);
+        src_.unmap();
+        next_src_.unmap();
+        return false;
+    }
+
+public:
+    reader() = default;
+
+    explicit reader(std::filesystem::path base) {
+        open(std::move(base));
+    }
+
+    bool valid() const noexcept {
+        return src_.is_mapped();
+    }
+
+    bool open(std::filesystem::path base) {
+        base_ = std::move(base);
+        src_.unmap();
+        next_src_.unmap();
+        error_.clear();
+        return map(0);
+    }
+
+    /**
+     * Why a segment could not be read, empty if none failed.
+     * The end of the journal is not an error.
+    */
+    std::error_code error() const noexcept {
+        return error_;
+    }
+
+    /**
+     * Reads the next record. Returns false at the end of the journal
+     * (for now: a journal being written may grow later), or if a segment
+     * is truncated or corrupt, see error().
+    */
+    bool next(record & out) {
+        while (valid()) {
+            auto used = std::atomic_ref<std::uint64_t const>{head()->used_}.load(std::memory_order_acquire);
+            if (used > src_.size()) return corrupt();
+            if (offset_ + sizeof(record_head) <= used) {
+                auto rec = reinterpret_cast<record_head const *>(src_.data() + offset_);
+                if (offset_ + record_size(rec->size_) > used) return corrupt();
+                out.ts   = rec->ts_;
+                out.size = rec->size_;
+                out.data = rec + 1;
+                offset_ += record_size(rec->size_);
+                return true;
+            }
+            if (!next_src_.is_mapped()) {
+                if (!map(index_ + 1, next_src_)) return false;
+                // The writer appends to the next segment only after its last append here,
+                // which may have landed since used was loaded: drain this one first.
+                continue;
+            }
+            map(index_ + 1);
+        }
+        return false;
+    }
+};
+
+/**
+ * Records everything a channel carries, as one more receiver of it.
+*/
+template <typename Flag>
+class recorder {
+    ipc::chan_wrapper<Flag> chan_;
+    writer                  writer_;
+    std::atomic<bool>       quit_ {false};
+
+public:
+    recorder() = default;
+
+    recorder(char const * channel, std::filesystem::path base, std::size_t segment_size = default_segment_size) {
+        open(channel, std::move(base), segment_size);
+    }
+
+    bool valid() const noexcept {
+        return writer_.valid();
+    }
+
+    bool open(char const * channel, std::filesystem::path base, std::size_t segment_size = default_segment_size) {
+        if (!writer_.open(std::move(base), segment_size)) return false;
+        if (!chan_.connect(channel, ipc::receiver)) {
+            writer_.close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        chan_.disconnect();
+        writer_.close();
+    }
+
+    /**
+     * Waits for a message (tm is in ms), then records it and the ones queued behind it.
+     * Returns the number of messages recorded.
+    */
+    std::size_t pump(std::uint64_t tm = invalid_value) {
+        std::size_t n = 0;
+        for (auto buf = chan_.recv(tm); !buf.empty(); buf = chan_.try_recv()) {
+            if (!writer_.append(buf.data(), buf.size())) break;
+            ++n;
+        }
+        return n;
+    }
+
+    /**
+     * Records until stop() is called.
+    */
+    void run() {
+        while (!quit_.load(std::memory_order_acquire)) pump(100);
+        quit_.store(false, std::memory_order_release);
+    }
+
+    void stop() noexcept {
+        quit_.store(true, std::memory_order_release);
+    }
+
+    void flush() {
+        writer_.flush();
+    }
+
+    std::uint64_t count() const noexcept {
+        return writer_.count();
+    }
+};
+
+/**
+ * Publishes the messages of a journal into a channel.
+*/
+template <typename Flag>
+class replayer {
+    ipc::chan_wrapper<Flag> chan_;
+    std::filesystem::path   base_;
+
+public:
+    replayer() = default;
+
+    replayer(std::filesystem::path base, char const * channel) {
+        open(std::move(base), channel);
+    }
+
+    bool valid() const noexcept {
+        return chan_.valid();
+    }
+
+    bool open(std::filesystem::path base, char const * channel) {
+        base_ = std::move(base);
+        return chan_.connect(channel, ipc::sender);
+    }
+
+    ipc::chan_wrapper<Flag> & channel() noexcept {
+        return chan_;
+    }
+
+    /**
+     * Sends the whole journal.
+     * speed > 0 keeps the recorded gaps between messages, divided by speed
+     * (1 is the original timing); speed <= 0 sends as fast as possible.
+     * Returns the number of messages sent.
+    */
+    std::uint64_t replay(double speed = 0) {
+        reader rd {base_};
+        record rec;
+        std::uint64_t n = 0, ts0 = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (rd.next(rec)) {
+            if (speed > 0) {
+                if (n == 0) ts0 = rec.ts;
+                // system_clock may have stepped back while recording: no gap then
+                auto gap = (rec.ts > ts0) ? (rec.ts - ts0) : 0;
+                auto due = start + std::chrono::nanoseconds(
+                                   static_cast<std::int64_t>(double(gap) / speed));
+                std::this_thread::sleep_until(due);
+            }
+            if (rec.size == 0) continue; // channels carry no empty message
+            if (!chan_.send(rec.data, rec.size)) break;
+            ++n;
+        }
+        return n;
+    }
+};
+
+} // namespace journal
+} // namespace ipc
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ipc {
+
+/*
+ * A pointer stored as the distance from its own address.
+ *
+ * As long as both the offset_ptr and its target live in the same mapping,
+ * it stays valid no matter where that mapping is placed in each process.
+ * A zero offset means null, so zero-filled shared memory holds null pointers.
+*/
+template <typename T>
+class offset_ptr {
+    std::ptrdiff_t off_ = 0;
+
+    static std::ptrdiff_t distance(void const * from, void const * to) noexcept {
+        return reinterpret_cast<std::intptr_t>(to) - reinterpret_cast<std::intptr_t>(from);
+    }
+
+    void set(T const * p) noexcept {
+        off_ = (p == nullptr) ? 0 : distance(this, p);
+    }
+
+public:
+    using element_type = T;
+
+    offset_ptr() noexcept = default;
+    offset_ptr(std::nullptr_t) noexcept {}
+    offset_ptr(T * p) noexcept { set(p); }
+    offset_ptr(offset_ptr const & rhs) noexcept { set(rhs.get()); }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    offset_ptr(offset_ptr<U> const & rhs) noexcept { set(rhs.get()); }
+
+    offset_ptr & operator=(offset_ptr const & rhs) noexcept {
+        set(rhs.get());
+        return *this;
+    }
+
+    offset_ptr & operator=(T * p) noexcept {
+        set(p);
+        return *this;
+    }
+
+    T * get() const noexcept {
+        if (off_ == 0) return nullptr;
+        return reinterpret_cast<T *>(reinterpret_cast<std::intptr_t>(this) + off_);
+    }
+
+    T * operator->() const noexcept { return get(); }
+    T & operator* () const noexcept { return *get(); }
+    T & operator[](std::size_t i) const noexcept { return get()[i]; }
+
+    explicit operator bool() const noexcept { return off_ != 0; }
+
+    friend bool operator==(offset_ptr const & a, offset_ptr const & b) noexcept { return a.get() == b.get(); }
+    friend bool operator!=(offset_ptr const & a, offset_ptr const & b) noexcept { return a.get() != b.get(); }
+    friend bool operator==(offset_ptr const & a, std::nullptr_t) noexcept { return !a; }
+    friend bool operator!=(offset_ptr const & a, std::nullptr_t) noexcept { return !!a; }
+};
+
+} // namespace ipc
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+
+namespace ipc {
+
+/*
+ * Request/reply on top of channels.
+ *
+ * Clients send their requests on one request channel ("<name>"),
+ * and get the replies back on a reply channel of their own.
+ * Every request carries the id of its client and of a pending-call slot,
+ * so one client may have many calls in flight from many threads.
+ *
+ * Payloads larger than ipc::large_msg_limit travel through the chunk storage:
+ * they are copied once into shm by the sender, and the receiver reads them
+ * in place.
+ *
+ * There is one server per name: the request channel is a broadcast channel,
+ * so rpc_server::connect fails if the name already has a server.
+ *
+ * The server never blocks on a client: a reply that does not fit into
+ * the client's reply queue is dropped, see rpc_server::reply.
+*/
+
+/**
+ * A request received by rpc_server: the payload, and where its reply goes.
+*/
+class rpc_request {
+    friend class rpc_server;
+
+    buffer        buff_;
+    void const *  data_   = nullptr;
+    std::size_t   size_   = 0;
+    std::uint64_t client_ = 0;
+    std::uint32_t slot_   = 0;
+    std::uint32_t seq_    = 0;
+
+public:
+    rpc_request() = default;
+    rpc_request(rpc_request &&) = default;
+    rpc_request &operator=(rpc_request &&) = default;
+
+    bool empty() const noexcept {
+        return buff_.empty();
+    }
+
+    void const * data() const noexcept {
+        return data_;
+    }
+
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+    std::uint64_t client() const noexcept {
+        return client_;
+    }
+};
+
+class IPC_EXPORT rpc_client {
+    rpc_client(rpc_client const &) = delete;
+    rpc_client &operator=(rpc_client const &) = delete;
+
+public:
+    enum : std::size_t {
+        default_slots = 64
+    };
+
+    rpc_client();
+    explicit rpc_client(char const * name, std::size_t slots = default_slots);
+    ~rpc_client();
+
+    bool valid() const noexcept;
+    bool connect(char const * name, std::size_t slots = default_slots);
+    void disconnect() noexcept;
+
+    /**
+     * The unique id of this client, also what rpc_request::client() reports.
+    */
+    std::uint64_t id() const noexcept;
+
+    /**
+     * Sends a request, then waits for its reply (tm is in ms).
+     * Thread-safe: at most 'slots' calls are pending at the same time,
+     * a further call waits for a free slot.
+     * Returns an empty buffer on failure or timeout;
+     * a reply with no payload looks the same.
+    */
+    buffer call(void const * data, std::size_t size, std::uint64_t tm = invalid_value);
+
+    buffer call(buffer const & buff, std::uint64_t tm = invalid_value) {
+        return this->call(buff.data(), buff.size(), tm);
+    }
+    buffer call(std::string const & str, std::uint64_t tm = invalid_value) {
+        return this->call(str.c_str(), str.size() + 1, tm);
+    }
+
+private:
+    class rpc_client_;
+    rpc_client_* p_;
+};
+
+class IPC_EXPORT rpc_server {
+    rpc_server(rpc_server const &) = delete;
+    rpc_server &operator=(rpc_server const &) = delete;
+
+public:
+    enum : std::size_t {
+        /* Reply channels kept open; clients that went away are closed first, then the least recently used. */
+        max_clients = 64
+    };
+
+    rpc_server();
+    explicit rpc_server(char const * name);
+    ~rpc_server();
+
+    bool valid() const noexcept;
+    bool connect(char const * name);
+    void disconnect() noexcept;
+
+    /**
+     * Waits for at least one request (tm is in ms), then takes the requests
+     * already queued behind it without waiting again, up to count in all.
+     * Returns the number of requests stored in reqs.
+    */
+    std::size_t recv(rpc_request * reqs, std::size_t count, std::uint64_t tm = invalid_value);
+
+    /**
+     * Sends the reply of req back to its client, without waiting:
+     * if the client's reply queue is full (it stopped draining it), the reply
+     * is dropped and counted in dropped(), and the call on the client side
+     * times out. Returns false then.
+    */
+    bool reply(rpc_request const & req, void const * data, std::size_t size);
+
+    bool reply(rpc_request const & req, buffer const & buff) {
+        return this->reply(req, buff.data(), buff.size());
+    }
+
+    /**
+     * Replies dropped because their client's queue was full.
+    */
+    std::uint64_t dropped() const noexcept;
+
+    /**
+     * Serves at most 'batch' requests: waits for the first one (tm is in ms),
+     * then takes the ones already queued without waiting again.
+     * Each is answered with the ipc::buffer that handler(rpc_request const &) returns.
+     * Returns the number of requests served.
+    */
+    template <typename F>
+    std::size_t serve(F && handler, std::size_t batch = 1, std::uint64_t tm = invalid_value) {
+        rpc_request req;
+        std::size_t n = 0;
+        while ((n < batch) && (this->recv(&req, 1, (n == 0) ? tm : 0) == 1)) {
+            this->reply(req, handler(static_cast<rpc_request const &>(req)));
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    class rpc_server_;
+    rpc_server_* p_;
+};
+
+} // namespace ipc
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>  // std::uint64_t
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+
+namespace ipc {
+namespace sync {
+
+/*
+ * A process-shared reader-writer lock for read-mostly data in shared memory.
+ *
+ * Readers register on one of several cache-line sized slots instead of
+ * a single shared word, so concurrent readers do not bounce one line.
+ * A waiting writer blocks new readers, and all waits accept a timeout.
+ * Slots and the writer word remember the owning process,
+ * so holders that died are reclaimed instead of blocking forever.
+ *
+ * There are 64 reader slots, one per process holding a shared lock,
+ * any number of threads of a process share its slot
+ * (two threads racing to claim it may briefly take a second one).
+ * When all of them belong to other live processes,
+ * lock_shared fails at once instead of waiting for the timeout.
+*/
+class IPC_EXPORT rw_mutex {
+    rw_mutex(rw_mutex const &) = delete;
+    rw_mutex &operator=(rw_mutex const &) = delete;
+
+public:
+    rw_mutex();
+    explicit rw_mutex(char const *name);
+    ~rw_mutex();
+
+    bool valid() const noexcept;
+
+    bool open(char const *name) noexcept;
+    void close() noexcept;
+
+    bool lock(std::uint64_t tm = ipc::invalid_value) noexcept;
+    bool try_lock() noexcept;
+    bool unlock() noexcept;
+
+    bool lock_shared(std::uint64_t tm = ipc::invalid_value) noexcept;
+    bool try_lock_shared() noexcept;
+    bool unlock_shared() noexcept;
+
+private:
+    class rw_mutex_;
+    rw_mutex_* p_;
+};
+
+} // namespace sync
+} // namespace ipc
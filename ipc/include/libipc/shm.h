@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <string>
 
 #include "libipc/export.h"
 
@@ -15,6 +17,25 @@ enum : unsigned {
     open   = 0x02
 };
 
+/**
+ * Names starting with local_prefix are process-local: the memory comes from
+ * the heap of the current process, and is only shared by handles in it.
+ * Everything else (ref counting, create/open modes, remove) works the same.
+*/
+constexpr char const local_prefix[] = "inproc://";
+
+inline bool is_local(char const * name) noexcept {
+    return (name != nullptr) && (std::strncmp(name, local_prefix, sizeof(local_prefix) - 1) == 0);
+}
+
+/**
+ * Returns prefix + name, keeping local_prefix in front for a process-local name.
+*/
+inline std::string make_name(char const * prefix, char const * name) {
+    if (!is_local(name)) return std::string{prefix} + name;
+    return std::string{local_prefix} + prefix + (name + sizeof(local_prefix) - 1);
+}
+
 IPC_EXPORT id_t         acquire(char const * name, std::size_t size, unsigned mode = create | open);
 IPC_EXPORT void *       get_mem(id_t id, std::size_t * size);
 IPC_EXPORT std::int32_t release(id_t id);
@@ -0,0 +1,505 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>      // std::memcpy
+#include <functional>   // std::hash
+#include <limits>
+#include <mutex>        // std::lock_guard
+#include <new>          // placement-new
+#include <type_traits>
+#include <utility>
+
+#include "libipc/def.h"
+#include "libipc/shm.h"
+#include "libipc/rw_lock.h"
+#include "libipc/offset_ptr.h"
+
+/*
+ * Containers that live inside a shared memory segment.
+ *
+ * All of them follow the rule used by every other shm structure in libipc:
+ * a zero-filled block of memory is a valid, empty container,
+ * so nothing has to be constructed after shm::handle creates the segment.
+ * Element types must be trivially copyable (or hold offset_ptr links), and nothing stores raw pointers,
+ * so the segment may be mapped at a different address in every process.
+*/
+
+namespace ipc {
+
+////////////////////////////////////////////////////////////////
+/// A segment holding a Root object followed by a bump allocated heap.
+////////////////////////////////////////////////////////////////
+
+class shm_heap {
+protected:
+    struct head_t {
+        alignas(ipc::cache_line_size) std::atomic<std::size_t> top_; // bytes used in the heap
+    };
+
+    head_t *      head_ = nullptr;
+    ipc::byte_t * heap_ = nullptr;
+    std::size_t   cap_  = 0;
+
+public:
+    /**
+     * Allocates from the segment heap. Memory is never returned,
+     * use shm_pool for fixed-size objects that come and go.
+     * Returns nullptr if the segment is full.
+    */
+    void * allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) noexcept {
+        if (heap_ == nullptr) return nullptr;
+        auto & top = head_->top_;
+        auto cur = top.load(std::memory_order_relaxed);
+        for (;;) {
+            auto beg = ipc::make_align(align, cur);
+            if ((beg > cap_) || (size > cap_ - beg)) return nullptr;
+            if (top.compare_exchange_weak(cur, beg + size, std::memory_order_relaxed)) {
+                return heap_ + beg;
+            }
+        }
+    }
+
+    std::size_t used() const noexcept {
+        return (heap_ == nullptr) ? 0 : head_->top_.load(std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const noexcept {
+        return cap_;
+    }
+};
+
+template <typename Root>
+class shm_segment : public shm_heap {
+    static_assert(std::is_trivially_destructible<Root>::value,
+                  "shm_segment<Root> requires a trivially destructible Root.");
+
+    enum : std::size_t {
+        root_offset = ipc::make_align(ipc::cache_line_size, sizeof(head_t)),
+        heap_offset = root_offset + ipc::make_align(ipc::cache_line_size, sizeof(Root))
+    };
+
+    shm::handle shm_;
+
+public:
+    shm_segment() = default;
+
+    shm_segment(char const * name, std::size_t size) {
+        open(name, size);
+    }
+
+    bool valid() const noexcept {
+        return shm_.valid();
+    }
+
+    /**
+     * size is the total size of the segment, including Root.
+    */
+    bool open(char const * name, std::size_t size) noexcept {
+        close();
+        if (size <= heap_offset) return false;
+        if (!shm_.acquire(name, size)) return false;
+        head_ = static_cast<head_t *>(shm_.get());
+        heap_ = static_cast<ipc::byte_t *>(shm_.get()) + heap_offset;
+        cap_  = size - heap_offset;
+        return true;
+    }
+
+    void close() noexcept {
+        shm_.release();
+        head_ = nullptr;
+        heap_ = nullptr;
+        cap_  = 0;
+    }
+
+    Root * root() const noexcept {
+        if (!valid()) return nullptr;
+        return reinterpret_cast<Root *>(static_cast<ipc::byte_t *>(shm_.get()) + root_offset);
+    }
+
+    Root * operator->() const noexcept { return root(); }
+    Root & operator* () const noexcept { return *root(); }
+};
+
+////////////////////////////////////////////////////////////////
+/// A fixed-capacity pool with a lock-free free list.
+////////////////////////////////////////////////////////////////
+
+template <typename T, std::size_t N>
+class shm_pool {
+    static_assert(std::is_trivially_destructible<T>::value, "shm_pool<T> requires a trivially destructible T.");
+    static_assert(N < (std::numeric_limits<std::uint32_t>::max)(), "shm_pool<T, N>: N is too large.");
+
+    // Free list head: high 32 bits are an ABA tag, low 32 bits are (index + 1).
+    alignas(ipc::cache_line_size) std::atomic<std::uint64_t> free_;
+    alignas(ipc::cache_line_size) std::atomic<std::uint32_t> cursor_; // slots never handed out yet
+    std::atomic<std::uint32_t> next_[N];
+    alignas(T) ipc::byte_t data_[N][sizeof(T)];
+
+public:
+    constexpr static std::size_t capacity() noexcept { return N; }
+
+    T * at(std::size_t i) noexcept {
+        return reinterpret_cast<T *>(data_[i]);
+    }
+
+    std::size_t index_of(T const * p) const noexcept {
+        return static_cast<std::size_t>(reinterpret_cast<ipc::byte_t const (*)[sizeof(T)]>(p) - data_);
+    }
+
+    /**
+     * Returns uninitialized storage for one T, or nullptr if exhausted.
+    */
+    T * allocate() noexcept {
+        auto cur = free_.load(std::memory_order_acquire);
+        while (static_cast<std::uint32_t>(cur) != 0) {
+            auto idx = static_cast<std::uint32_t>(cur) - 1;
+            std::uint64_t nxt = ((cur >> 32) + 1) << 32 | next_[idx].load(std::memory_order_relaxed);
+            if (free_.compare_exchange_weak(cur, nxt, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return at(idx);
+            }
+        }
+        auto idx = cursor_.load(std::memory_order_relaxed);
+        do {
+            if (idx >= N) return nullptr;
+        } while (!cursor_.compare_exchange_weak(idx, idx + 1, std::memory_order_relaxed));
+        return at(idx);
+    }
+
+    void deallocate(T * p) noexcept {
+        if (p == nullptr) return;
+        auto idx = static_cast<std::uint32_t>(index_of(p));
+        auto cur = free_.load(std::memory_order_relaxed);
+        for (;;) {
+            next_[idx].store(static_cast<std::uint32_t>(cur), std::memory_order_relaxed);
+            std::uint64_t nxt = ((cur >> 32) + 1) << 32 | (idx + 1);
+            if (free_.compare_exchange_weak(cur, nxt, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    template <typename... A>
+    T * construct(A &&... args) {
+        auto p = allocate();
+        if (p == nullptr) return nullptr;
+        return ::new (p) T(std::forward<A>(args)...);
+    }
+};
+
+////////////////////////////////////////////////////////////////
+/// A fixed-capacity open-addressing hash map.
+////////////////////////////////////////////////////////////////
+
+/*
+ * Each bucket has its own control word, which acts as a tiny seqlock:
+ * writers lock one bucket at a time, readers never write anything
+ * and retry a bucket if it changed while they were copying it.
+ * A key is live in at most one bucket. Erased buckets are tombstones:
+ * an insert reuses the first one on its probe path once it has checked
+ * that the key is not stored further along, so erase/insert churn over
+ * distinct keys does not use up the table.
+*/
+template <typename K, typename V, std::size_t N, typename Hash = std::hash<K>>
+class shm_hash_map {
+    static_assert(std::is_trivially_copyable<K>::value, "shm_hash_map requires a trivially copyable key.");
+    static_assert(std::is_trivially_copyable<V>::value, "shm_hash_map requires a trivially copyable value.");
+    static_assert((N != 0) && ((N & (N - 1)) == 0), "shm_hash_map<K, V, N>: N must be a power of 2.");
+
+    enum : std::uint32_t {
+        st_empty  = 0,
+        st_locked = 1,
+        st_full   = 2,
+        st_erased = 3,
+        st_mask   = 3,
+        ver_unit  = 4
+    };
+
+    struct bucket_t {
+        std::atomic<std::uint32_t> ctl_; // (version << 2) | state
+        K key_;
+        V val_;
+    };
+
+    alignas(ipc::cache_line_size) std::atomic<std::size_t> size_;
+    alignas(ipc::cache_line_size) bucket_t buckets_[N];
+
+    static std::size_t home_of(K const & key) noexcept {
+        return Hash{}(key) & (N - 1);
+    }
+
+    static bool same_key(K const & a, K const & b) noexcept {
+        return std::memcmp(&a, &b, sizeof(K)) == 0;
+    }
+
+    /// Locks a bucket that is currently in state `st`. Returns the locked control word.
+    static bool try_lock(bucket_t & b, std::uint32_t & ctl, std::uint32_t st) noexcept {
+        if ((ctl & st_mask) != st) return false;
+        return b.ctl_.compare_exchange_strong(ctl, (ctl & ~st_mask) | st_locked, std::memory_order_acquire);
+    }
+
+    static void unlock(bucket_t & b, std::uint32_t ctl, std::uint32_t st) noexcept {
+        b.ctl_.store(((ctl & ~st_mask) + ver_unit) | st, std::memory_order_release);
+    }
+
+    /// Waits until the bucket is stable and returns its control word.
+    static std::uint32_t stable(bucket_t const & b) noexcept {
+        std::uint32_t ctl;
+        for (unsigned k = 0; ((ctl = b.ctl_.load(std::memory_order_acquire)) & st_mask) == st_locked; ipc::yield(k)) ;
+        return ctl;
+    }
+
+    /// Reads the key of a full/erased bucket without locking it.
+    static bool read_key(bucket_t const & b, std::uint32_t ctl, K & key) noexcept {
+        std::memcpy(&key, &b.key_, sizeof(K));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return b.ctl_.load(std::memory_order_relaxed) == ctl;
+    }
+
+    /// Locks the tombstone at probe step `i` of `key` for reuse, after making sure
+    /// no other bucket further along the probe path holds `key`.
+    /// Returns false if the path changed under us and the caller must start over.
+    bool claim_erased(K const & key, std::size_t i, std::size_t idx, std::uint32_t & ctl) noexcept {
+        auto & t = buckets_[idx];
+        ctl = t.ctl_.load(std::memory_order_acquire);
+        if (!try_lock(t, ctl, st_erased)) return false;
+        for (std::size_t j = i + 1, nxt = (idx + 1) & (N - 1); j < N; ++j, nxt = (nxt + 1) & (N - 1)) {
+            auto & b = buckets_[nxt];
+            auto bc  = b.ctl_.load(std::memory_order_acquire);
+            auto st  = bc & st_mask;
+            if (st == st_empty) break;
+            K cur;
+            if ((st == st_locked) || !read_key(b, bc, cur) ||
+                ((st == st_full) && same_key(cur, key))) {
+                // Another writer is busy here, or the key turned up: leave the tombstone as it was.
+                unlock(t, ctl, st_erased);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename F>
+    bool upsert(K const & key, F && write) noexcept {
+        for (unsigned k = 0;; ipc::yield(k)) {
+            std::size_t tomb_i = N, tomb_idx = 0;
+            bool absent = false;
+            for (std::size_t i = 0, idx = home_of(key); (i < N) && !absent; ++i, idx = (idx + 1) & (N - 1)) {
+                auto & b = buckets_[idx];
+                for (;;) {
+                    auto ctl = stable(b);
+                    auto st  = ctl & st_mask;
+                    if (st == st_empty) {
+                        if (tomb_i != N) { // the key is absent, reuse the first tombstone
+                            absent = true;
+                            break;
+                        }
+                        if (!try_lock(b, ctl, st_empty)) continue;
+                        std::memcpy(&b.key_, &key, sizeof(K));
+                        write(b.val_, false);
+                        unlock(b, ctl, st_full);
+                        size_.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                    K cur;
+                    if (!read_key(b, ctl, cur)) continue;
+                    if (!same_key(cur, key)) {
+                        if ((st == st_erased) && (tomb_i == N)) {
+                            tomb_i   = i;
+                            tomb_idx = idx;
+                        }
+                        break; // probe the next bucket
+                    }
+                    if (!try_lock(b, ctl, st)) continue;
+                    bool exists = (st == st_full);
+                    bool done   = write(b.val_, exists);
+                    unlock(b, ctl, (done || exists) ? st_full : st_erased);
+                    if (done && !exists) size_.fetch_add(1, std::memory_order_relaxed);
+                    return done;
+                }
+            }
+            if (tomb_i == N) return false; // full
+            std::uint32_t ctl;
+            if (!claim_erased(key, tomb_i, tomb_idx, ctl)) continue;
+            auto & t = buckets_[tomb_idx];
+            std::memcpy(&t.key_, &key, sizeof(K));
+            bool done = write(t.val_, false);
+            unlock(t, ctl, done ? st_full : st_erased);
+            if (done) size_.fetch_add(1, std::memory_order_relaxed);
+            return done;
+        }
+    }
+
+public:
+    constexpr static std::size_t capacity() noexcept { return N; }
+
+    std::size_t size() const noexcept {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts a new key. Returns false if the key exists or the map is full.
+    */
+    bool insert(K const & key, V const & val) noexcept {
+        return upsert(key, [&val](V & dst, bool exists) {
+            if (exists) return false;
+            std::memcpy(&dst, &val, sizeof(V));
+            return true;
+        });
+    }
+
+    /**
+     * Inserts or overwrites. Returns false only if the map is full.
+    */
+    bool assign(K const & key, V const & val) noexcept {
+        return upsert(key, [&val](V & dst, bool) {
+            std::memcpy(&dst, &val, sizeof(V));
+            return true;
+        });
+    }
+
+    /**
+     * Lock-free lookup. Copies the value out if found.
+    */
+    bool find(K const & key, V & val) const noexcept {
+        for (std::size_t i = 0, idx = home_of(key); i < N; ++i, idx = (idx + 1) & (N - 1)) {
+            auto & b = buckets_[idx];
+            for (;;) {
+                auto ctl = stable(b);
+                auto st  = ctl & st_mask;
+                if (st == st_empty) return false;
+                K cur;
+                std::memcpy(&cur, &b.key_, sizeof(K));
+                std::memcpy(&val, &b.val_, sizeof(V));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (b.ctl_.load(std::memory_order_relaxed) != ctl) continue; // raced with a writer
+                if (!same_key(cur, key)) break;
+                return st == st_full;
+            }
+        }
+        return false;
+    }
+
+    bool contains(K const & key) const noexcept {
+        V val;
+        return find(key, val);
+    }
+
+    bool erase(K const & key) noexcept {
+        for (std::size_t i = 0, idx = home_of(key); i < N; ++i, idx = (idx + 1) & (N - 1)) {
+            auto & b = buckets_[idx];
+            for (;;) {
+                auto ctl = stable(b);
+                auto st  = ctl & st_mask;
+                if (st == st_empty) return false;
+                K cur;
+                if (!read_key(b, ctl, cur)) continue;
+                if (!same_key(cur, key)) break;
+                if (st == st_erased) return false;
+                if (!try_lock(b, ctl, st_full)) continue;
+                unlock(b, ctl, st_erased);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+////////////////////////////////////////////////////////////////
+/// An append-only vector whose elements never move.
+////////////////////////////////////////////////////////////////
+
+/*
+ * Elements are stored in chunks of geometrically growing size, allocated
+ * from the segment heap on demand. Existing elements are never relocated,
+ * so readers index into the vector without any lock while a writer appends.
+ * Writers are serialized by a spin lock.
+*/
+template <typename T, std::size_t FirstChunk = 64>
+class shm_vector {
+    static_assert(std::is_trivially_copyable<T>::value, "shm_vector<T> requires a trivially copyable T.");
+    static_assert((FirstChunk != 0) && ((FirstChunk & (FirstChunk - 1)) == 0),
+                  "shm_vector<T, FirstChunk>: FirstChunk must be a power of 2.");
+
+    enum : std::size_t {
+        chunk_max = 32
+    };
+
+    alignas(ipc::cache_line_size) std::atomic<std::size_t> size_;
+    ipc::spin_lock lc_;
+    // Offsets of the chunks from `this`, 0 if not allocated yet.
+    std::atomic<std::ptrdiff_t> chunks_[chunk_max];
+
+    // chunk c holds FirstChunk << c elements, starting at index FirstChunk * (2^c - 1)
+    static std::size_t chunk_of(std::size_t i, std::size_t & pos) noexcept {
+        std::size_t n = i / FirstChunk + 1, c = 0;
+        while (n >>= 1) ++c;
+        pos = i - FirstChunk * ((std::size_t(1) << c) - 1);
+        return c;
+    }
+
+    T * chunk_ptr(std::size_t c) const noexcept {
+        auto off = chunks_[c].load(std::memory_order_acquire);
+        if (off == 0) return nullptr;
+        return reinterpret_cast<T *>(reinterpret_cast<std::intptr_t>(this) + off);
+    }
+
+public:
+    std::size_t size() const noexcept {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    /**
+     * Index must be less than size().
+    */
+    T const & operator[](std::size_t i) const noexcept {
+        std::size_t pos;
+        auto c = chunk_of(i, pos);
+        return chunk_ptr(c)[pos];
+    }
+
+    T & operator[](std::size_t i) noexcept {
+        std::size_t pos;
+        auto c = chunk_of(i, pos);
+        return chunk_ptr(c)[pos];
+    }
+
+    /**
+     * Appends a copy of val, allocating a new chunk from heap if needed.
+     * Returns the index of the new element, or invalid_value if heap is full.
+    */
+    std::size_t push_back(shm_heap & heap, T const & val) noexcept {
+        std::lock_guard<ipc::spin_lock> guard {lc_};
+        auto i = size_.load(std::memory_order_relaxed);
+        std::size_t pos;
+        auto c = chunk_of(i, pos);
+        if (c >= chunk_max) return invalid_value;
+        auto p = chunk_ptr(c);
+        if (p == nullptr) {
+            p = static_cast<T *>(heap.allocate(sizeof(T) * (FirstChunk << c), alignof(T)));
+            if (p == nullptr) return invalid_value;
+            chunks_[c].store(reinterpret_cast<std::intptr_t>(p) - reinterpret_cast<std::intptr_t>(this),
+                             std::memory_order_release);
+        }
+        std::memcpy(p + pos, &val, sizeof(T));
+        size_.store(i + 1, std::memory_order_release);
+        return i;
+    }
+
+    template <typename F>
+    void for_each(F && f) const {
+        for (std::size_t i = 0, n = size(); i < n; ++i) f((*this)[i]);
+    }
+};
+
+} // namespace ipc
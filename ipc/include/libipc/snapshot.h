@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+
+namespace ipc {
+
+/*
+ * A "latest value wins" slot in shared memory.
+ *
+ * The writer publishes a fixed-size record under a sequence lock:
+ * stores never block, readers never take a lock, and a reader simply
+ * retries when it raced with a writer. Only the most recent value is kept.
+ *
+ * A writer that dies while copying leaves a torn value behind: readers
+ * notice its pid is gone and load() fails instead of spinning, until the
+ * next store() takes over from the dead writer and publishes a whole value.
+ *
+ * Readers may also block until a newer version is published.
+ * On Linux this is a futex wait on the sequence word, and the writer
+ * only enters the kernel when somebody is actually waiting.
+*/
+class IPC_EXPORT latest_value {
+    latest_value(latest_value const &) = delete;
+    latest_value &operator=(latest_value const &) = delete;
+
+public:
+    latest_value();
+    latest_value(char const * name, std::size_t size);
+    ~latest_value();
+
+    bool valid() const noexcept;
+    std::size_t size() const noexcept;
+
+    bool open(char const * name, std::size_t size) noexcept;
+    void close() noexcept;
+
+    /**
+     * Publishes size() bytes from data.
+     * Concurrent writers are serialized by a writer word holding their pid.
+    */
+    void store(void const * data) noexcept;
+
+    /**
+     * Copies the latest value into out (size() bytes).
+     * Returns false if nothing has been published yet, or if the writer
+     * died while storing the latest value (the next store() repairs it).
+     * If ver is not null, it receives the version of the copied value.
+    */
+    bool load(void * out, std::uint32_t * ver = nullptr) const noexcept;
+
+    /**
+     * Returns the current version, 0 means nothing has been published.
+    */
+    std::uint32_t version() const noexcept;
+
+    /**
+     * Waits until the version differs from ver, or until timeout (ms).
+     * Returns false on timeout.
+    */
+    bool wait(std::uint32_t ver, std::uint64_t tm = invalid_value) const noexcept;
+
+private:
+    class latest_value_;
+    latest_value_* p_;
+};
+
+template <typename T>
+class snapshot {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshot<T> requires a trivially copyable T.");
+
+    latest_value lv_;
+
+public:
+    snapshot() = default;
+
+    explicit snapshot(char const * name)
+        : lv_(name, sizeof(T)) {}
+
+    bool valid() const noexcept {
+        return lv_.valid();
+    }
+
+    bool open(char const * name) noexcept {
+        return lv_.open(name, sizeof(T));
+    }
+
+    void close() noexcept {
+        lv_.close();
+    }
+
+    void store(T const & val) noexcept {
+        lv_.store(&val);
+    }
+
+    bool load(T & val, std::uint32_t * ver = nullptr) const noexcept {
+        return lv_.load(&val, ver);
+    }
+
+    T load() const noexcept {
+        T val {};
+        lv_.load(&val);
+        return val;
+    }
+
+    std::uint32_t version() const noexcept {
+        return lv_.version();
+    }
+
+    bool wait(std::uint32_t ver, std::uint64_t tm = invalid_value) const noexcept {
+        return lv_.wait(ver, tm);
+    }
+};
+
+} // namespace ipc
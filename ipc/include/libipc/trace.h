@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cinttypes>    // PRIu64, ...
+#include <type_traits>
+
+#include "libipc/export.h"
+
+namespace ipc {
+namespace trace {
+
+/*
+ * A binary trace of hot-path events.
+ *
+ * Every process that emits an event gets its own shm ring named
+ * "__IPC_TRACE__<pid>", made of fixed-size records. Writing a record is
+ * a fetch_add and a few plain stores, it never locks and never blocks.
+ * The ipc_trace tool decodes the rings, using the table below.
+*/
+
+#define LIBIPC_TRACE_EVENTS_(X)                                                                                   \
+    X(send_invalid,        error, "fail: send(0x%" PRIx64 ", %" PRIu64 ")")                                        \
+    X(send_no_queue,       error, "fail: send, queue_of(h) == nullptr")                                            \
+    X(send_no_elems,       error, "fail: send, queue_of(h)->elems() == nullptr")                                   \
+    X(send_not_ready,      error, "fail: send, que->ready_sending() == false")                                     \
+    X(send_no_receiver,    error, "fail: send, there is no receiver on this connection.")                          \
+    X(send_no_acc,         error, "fail: send, info_of(h)->acc() == nullptr")                                      \
+    X(send_force_push,     log,   "force_push: msg_id = %" PRIu64 ", remain = %" PRId64 ", size = %" PRIu64)       \
+    X(queue_force_push,    log,   "force_push: k = %" PRIu64 ", cc = %" PRIu64 ", rem_cc = %" PRIu64)              \
+    X(recv_no_queue,       error, "fail: recv, queue_of(h) == nullptr")                                            \
+    X(recv_bad_size,       error, "fail: recv, r_size = %" PRId64)                                                 \
+    X(recv_alloc_fail,     log,   "fail: ipc::mem::alloc<recycle_t>.")                                             \
+    X(recv_no_storage,     log,   "fail: shm::handle for large message. msg_id: %" PRIu64 ", buf_id: %" PRId64     \
+                                  ", size: %" PRIu64)                                                              \
+    X(storage_find_bad,    error, "[find_storage] id is invalid: id = %" PRId64 ", size = %" PRIu64)               \
+    X(storage_release_bad, error, "[release_storage] id is invalid: id = %" PRId64 ", size = %" PRIu64)            \
+    X(storage_recycle_bad, error, "[recycle_storage] id is invalid: id = %" PRId64 ", size = %" PRIu64)            \
+    X(clear_bad_size,      error, "[clear_message] invalid msg size: %" PRId64)
+
+enum class event : std::uint32_t {
+    none,
+#define LIBIPC_TRACE_ENUM_(NAME, LEVEL, FMT) NAME,
+    LIBIPC_TRACE_EVENTS_(LIBIPC_TRACE_ENUM_)
+#undef  LIBIPC_TRACE_ENUM_
+    count
+};
+
+enum class level : std::uint32_t {
+    log,
+    error
+};
+
+struct event_info {
+    char const * name;
+    level        lev;
+    char const * fmt;   // takes up to 4 std::uint64_t arguments
+};
+
+inline event_info const & info_of(event ev) noexcept {
+    static event_info const table[] = {
+        { "none", level::log, "" },
+#define LIBIPC_TRACE_INFO_(NAME, LEVEL, FMT) { #NAME, level::LEVEL, FMT },
+        LIBIPC_TRACE_EVENTS_(LIBIPC_TRACE_INFO_)
+#undef  LIBIPC_TRACE_INFO_
+    };
+    auto i = static_cast<std::size_t>(ev);
+    return table[(i < static_cast<std::size_t>(event::count)) ? i : 0];
+}
+
+enum : std::size_t {
+    args_max     = 4,
+    record_count = 4096     // must be a power of 2
+};
+
+struct alignas(64) record {
+    std::atomic<std::uint64_t> seq_;    // index + 1 once written, 0 while (re)writing
+    std::uint64_t ts_;                  // steady clock, ns
+    std::uint32_t event_;
+    std::uint32_t tid_;
+    std::uint64_t args_[args_max];
+};
+
+struct ring {
+    alignas(64) std::atomic<std::uint64_t> cursor_;
+    record records_[record_count];
+};
+
+constexpr char const ring_prefix[] = "__IPC_TRACE__";
+
+/**
+ * Appends a record to the trace ring of this process.
+*/
+IPC_EXPORT void emit(event ev, std::uint64_t a0 = 0, std::uint64_t a1 = 0,
+                               std::uint64_t a2 = 0, std::uint64_t a3 = 0) noexcept;
+
+/**
+ * Like emit, and also prints the event as text,
+ * at most a few lines per second for each event id.
+*/
+IPC_EXPORT void report(event ev, std::uint64_t a0 = 0, std::uint64_t a1 = 0,
+                                 std::uint64_t a2 = 0, std::uint64_t a3 = 0) noexcept;
+
+template <typename T>
+std::uint64_t to_arg(T * p) noexcept {
+    return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p));
+}
+
+template <typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+std::uint64_t to_arg(T v) noexcept {
+    // Signed values are stored in two's complement and printed with PRId64.
+    return static_cast<std::uint64_t>(static_cast<std::conditional_t<std::is_signed<T>::value,
+                                                                     std::int64_t, std::uint64_t>>(v));
+}
+
+template <typename... A>
+void report(event ev, A... args) noexcept {
+    static_assert(sizeof...(A) <= args_max, "Too many trace arguments.");
+    report(ev, to_arg(args)...);
+}
+
+} // namespace trace
+} // namespace ipc
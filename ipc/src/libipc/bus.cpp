@@ -0,0 +1,424 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "libipc/bus.h"
+#include "libipc/ipc.h"
+#include "libipc/shm.h"
+#include "libipc/shm_container.h"
+#include "libipc/rw_lock.h"
+#include "libipc/waiter.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/pimpl.h"
+
+namespace {
+
+constexpr char const dir_prefix[]  = "__BUS_DIR__";
+constexpr char const bell_prefix[] = "__BUS_BELL__";
+
+constexpr std::uint64_t bell_slice = 100; // ms
+
+std::string ring_name(char const * name, std::size_t k) {
+    return ipc::shm::make_name(("__BUS" + std::to_string(k) + "__").c_str(), name);
+}
+
+/* Zero-padded, so that it can be hashed and compared as raw bytes. */
+struct topic_key {
+    char str_[ipc::bus::max_topic_name + 1];
+};
+
+struct key_hash {
+    std::size_t operator()(topic_key const & key) const noexcept {
+        std::size_t h = 14695981039346656037ull; // FNV-1a
+        for (char const * s = key.str_; *s != '\0'; ++s) {
+            h = (h ^ static_cast<unsigned char>(*s)) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+/*
+ * The directory segment of a bus.
+ * Topic ids are handed out in order and never taken back,
+ * so a receiver only has to look at the ids above the last one it has seen.
+ *
+ * A receiver listening on several rings sleeps on the bell: it counts itself
+ * in sleepers_, and publishers bump bell_ and wake it up while it is non-zero.
+*/
+struct directory_t {
+    ipc::spin_lock lock_;                       // serializes registrations
+    std::atomic<std::uint32_t> rings_;          // set once, by the first connector
+    std::atomic<std::uint32_t> sleepers_;
+    std::atomic<std::uint32_t> bell_;
+    std::atomic<std::uint32_t> count_;          // ids [1, count_] are registered
+    topic_key names_[ipc::bus::max_topics];     // by id - 1
+    ipc::shm_hash_map<topic_key, ipc::topic_t, 2 * ipc::bus::max_topics, key_hash> ids_;
+};
+
+bool make_key(char const * name, topic_key & key) noexcept {
+    if ((name == nullptr) || (name[0] == '\0')) return false;
+    auto len = std::strlen(name);
+    if ((len > ipc::bus::max_topic_name) || (std::strpbrk(name, "+#") != nullptr)) return false;
+    std::memset(&key, 0, sizeof(key));
+    std::memcpy(key.str_, name, len);
+    return true;
+}
+
+bool is_pattern(char const * pattern) noexcept {
+    return std::strpbrk(pattern, "+#") != nullptr;
+}
+
+/* MQTT-like matching: '+' is one level, '#' all the remaining ones. */
+bool match(char const * p, char const * n) noexcept {
+    for (;;) {
+        if (*p == '#') return true;
+        if (*p == '+') {
+            ++p;
+            while ((*n != '\0') && (*n != '/')) ++n;
+            continue;
+        }
+        if (*p != *n) return false;
+        if (*p == '\0') return true;
+        ++p; ++n;
+    }
+}
+
+} // internal-linkage
+
+namespace ipc {
+
+////////////////////////////////////////////////////////////////
+/// class bus implementation
+////////////////////////////////////////////////////////////////
+
+class bus::bus_ : public ipc::pimpl<bus_> {
+public:
+    std::vector<ipc::channel>     rings_;
+    std::vector<std::uint32_t>    wanted_;  // by ring, the known topics subscribed to
+    ipc::shm_segment<directory_t> dir_;
+    ipc::detail::waiter           bell_;
+    unsigned                      mode_ = 0;
+    std::size_t                   next_ = 0; // the ring to look at first
+
+    std::vector<std::string>      patterns_; // including plain topic names
+    std::size_t                   wildcards_ = 0;
+    std::uint32_t                 known_     = 0; // ids [1, known_] have been matched
+
+    bool receiving() const noexcept {
+        return (mode_ & ipc::receiver) != 0;
+    }
+
+    std::size_t ring_of(topic_t id) const noexcept {
+        return static_cast<std::size_t>(id - 1) % rings_.size();
+    }
+
+    ipc::channel & chan_of(topic_t id) noexcept {
+        return rings_[ring_of(id)];
+    }
+
+    bool listening(std::size_t r) const noexcept {
+        return (wildcards_ != 0) || (wanted_[r] != 0);
+    }
+
+    bool wanted(topic_t id) const noexcept {
+        auto name = dir_->names_[id - 1].str_;
+        for (auto const & p : patterns_) {
+            if (match(p.c_str(), name)) return true;
+        }
+        return false;
+    }
+
+    void set(topic_t id, bool on) {
+        if (on) chan_of(id).subscribe(id);
+        else    chan_of(id).unsubscribe(id);
+    }
+
+    /* Ids not registered yet may match a wildcard: let them through until they are known. */
+    void set_unknown() {
+        for (std::size_t id = known_ + 1; id <= bus::max_topics; ++id) {
+            set(static_cast<topic_t>(id), wildcards_ != 0);
+        }
+    }
+
+    /* Matches the topics registered since the last time. */
+    void refresh() {
+        auto count = dir_->count_.load(std::memory_order_acquire);
+        for (; known_ < count; ++known_) {
+            auto id = static_cast<topic_t>(known_ + 1);
+            bool on = wanted(id);
+            if (on) ++wanted_[ring_of(id)];
+            set(id, on);
+        }
+    }
+
+    /* Receives on the rings that may carry a subscribed topic, and only on those. */
+    void listen() {
+        for (std::size_t r = 0; r < rings_.size(); ++r) {
+            auto mode = listening(r) ? mode_ : (mode_ & ~static_cast<unsigned>(ipc::receiver));
+            if (rings_[r].mode() != mode) rings_[r].reconnect(mode);
+        }
+    }
+
+    void rebuild() {
+        auto count = known_;
+        known_ = 0;
+        std::fill(wanted_.begin(), wanted_.end(), 0);
+        for (std::uint32_t i = 1; i <= count; ++i) set(static_cast<topic_t>(i), false);
+        refresh();
+        set_unknown();
+        listen();
+    }
+
+    /* Rings the bell if some receiver sleeps on it. */
+    void ring_bell() {
+        auto & dir = *dir_;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (dir.sleepers_.load(std::memory_order_relaxed) == 0) return;
+        dir.bell_.fetch_add(1, std::memory_order_relaxed);
+        bell_.broadcast();
+    }
+
+    /* Takes a message from the first listened ring having one, in turn. */
+    buffer poll(topic_t * id) {
+        for (std::size_t i = 0; i < rings_.size(); ++i) {
+            auto r = (next_ + i) % rings_.size();
+            if (!listening(r)) continue;
+            auto buf = rings_[r].recv(0, id);
+            if (!buf.empty()) {
+                next_ = r + 1;
+                return buf;
+            }
+        }
+        return {};
+    }
+
+    buffer recv(std::uint64_t tm, topic_t * id) {
+        std::size_t count = 0, last = 0;
+        for (std::size_t r = 0; r < rings_.size(); ++r) {
+            if (listening(r)) ++count, last = r;
+        }
+        if (count == 1) return rings_[last].recv(tm, id);
+        auto buf = poll(id);
+        if (!buf.empty() || (tm == 0)) return buf;
+        auto & dir = *dir_;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(tm);
+        for (;;) {
+            std::uint64_t slice = bell_slice; // in case a publisher died before ringing
+            if (tm != invalid_value) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) return {};
+                slice = (std::min)(slice, static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1));
+            }
+            dir.sleepers_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto seq = dir.bell_.load(std::memory_order_relaxed);
+            buf = poll(id);
+            if (buf.empty()) {
+                bell_.wait_if([&dir, seq] {
+                    return dir.bell_.load(std::memory_order_relaxed) == seq;
+                }, slice);
+                buf = poll(id);
+            }
+            dir.sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            if (!buf.empty()) return buf;
+        }
+    }
+};
+
+bus::bus()
+    : p_(p_->make()) {
+}
+
+bus::bus(char const * name, unsigned mode, std::size_t rings)
+    : bus() {
+    connect(name, mode, rings);
+}
+
+bus::~bus() {
+    disconnect();
+    p_->clear();
+}
+
+bool bus::valid() const noexcept {
+    return impl(p_)->dir_.valid() && !impl(p_)->rings_.empty();
+}
+
+std::size_t bus::rings() const noexcept {
+    return impl(p_)->rings_.size();
+}
+
+bool bus::connect(char const * name, unsigned mode, std::size_t rings) {
+    disconnect();
+    if ((name == nullptr) || (name[0] == '\0')) {
+        ipc::error("fail bus::connect: invalid name.\n");
+        return false;
+    }
+    if ((rings == 0) || (rings > bus::max_rings)) {
+        ipc::error("fail bus::connect: invalid number of rings: %zd\n", rings);
+        return false;
+    }
+    auto p = impl(p_);
+    if (!p->dir_.open(ipc::shm::make_name(dir_prefix, name).c_str(), sizeof(directory_t) + 256)) {
+        ipc::error("fail bus::connect: cannot open the directory of %s\n", name);
+        return false;
+    }
+    std::uint32_t count = 0;
+    if (!p->dir_->rings_.compare_exchange_strong(count, static_cast<std::uint32_t>(rings),
+                                                 std::memory_order_acq_rel)) {
+        rings = count; // set by the first one
+    }
+    if (!p->bell_.open(ipc::shm::make_name(bell_prefix, name).c_str())) {
+        ipc::error("fail bus::connect: cannot open the bell of %s\n", name);
+        disconnect();
+        return false;
+    }
+    p->mode_ = mode;
+    p->rings_.resize(rings);
+    p->wanted_.assign(rings, 0);
+    for (std::size_t r = 0; r < rings; ++r) {
+        auto & chan = p->rings_[r];
+        // Nothing is received before the first subscription to a topic of the ring.
+        if (!chan.connect(ring_name(name, r).c_str(), mode & ~static_cast<unsigned>(ipc::receiver))) {
+            ipc::error("fail bus::connect: %s, ring %zd\n", name, r);
+            disconnect();
+            return false;
+        }
+        // No topic is ever 0 on a bus: subscribing to it alone filters everything out.
+        chan.subscribe(0);
+    }
+    if (p->receiving()) {
+        p->known_ = p->dir_->count_.load(std::memory_order_acquire);
+    }
+    return true;
+}
+
+void bus::disconnect() noexcept {
+    auto p = impl(p_);
+    p->rings_.clear();
+    p->wanted_.clear();
+    p->bell_.close();
+    p->dir_.close();
+    p->patterns_.clear();
+    p->wildcards_ = 0;
+    p->known_     = 0;
+    p->mode_      = 0;
+    p->next_      = 0;
+}
+
+topic_t bus::topic(char const * name) {
+    auto p = impl(p_);
+    topic_key key;
+    if (!p->dir_.valid() || !make_key(name, key)) return 0;
+    auto & dir = *(p->dir_);
+    topic_t id = 0;
+    if (dir.ids_.find(key, id)) return id;
+    std::lock_guard<ipc::spin_lock> guard {dir.lock_};
+    if (dir.ids_.find(key, id)) return id; // registered meanwhile
+    auto count = dir.count_.load(std::memory_order_relaxed);
+    if (count >= bus::max_topics) {
+        ipc::error("fail bus::topic: the directory is full, cannot add %s\n", name);
+        return 0;
+    }
+    id = static_cast<topic_t>(count + 1);
+    dir.names_[count] = key;
+    if (!dir.ids_.insert(key, id)) return 0;
+    dir.count_.store(count + 1, std::memory_order_release);
+    return id;
+}
+
+char const * bus::topic_name(topic_t topic) const {
+    auto p = impl(p_);
+    if (!p->dir_.valid() || (topic == 0) ||
+        (topic > p->dir_->count_.load(std::memory_order_acquire))) {
+        return nullptr;
+    }
+    return p->dir_->names_[topic - 1].str_;
+}
+
+bool bus::publish(topic_t topic, void const * data, std::size_t size, std::uint64_t tm) {
+    auto p = impl(p_);
+    if ((topic == 0) || p->rings_.empty()) return false;
+    auto & chan = p->chan_of(topic);
+    if (chan.recv_count() == 0) return true; // no one to deliver to
+    if (!chan.send(topic, data, size, tm)) return false;
+    p->ring_bell();
+    return true;
+}
+
+bool bus::publish(char const * topic, void const * data, std::size_t size, std::uint64_t tm) {
+    return this->publish(this->topic(topic), data, size, tm);
+}
+
+bool bus::subscribe(char const * pattern) {
+    auto p = impl(p_);
+    if (!p->receiving() || (pattern == nullptr) || (pattern[0] == '\0') ||
+        (std::strlen(pattern) > bus::max_topic_name)) {
+        return false;
+    }
+    p->refresh();
+    if (is_pattern(pattern)) {
+        p->patterns_.emplace_back(pattern);
+        if (++(p->wildcards_) == 1) p->set_unknown();
+        // the topics already known
+        for (std::uint32_t i = 1; i <= p->known_; ++i) {
+            auto id = static_cast<topic_t>(i);
+            if (!match(pattern, p->dir_->names_[i - 1].str_)) continue;
+            ++(p->wanted_[p->ring_of(id)]);
+            p->set(id, true);
+        }
+        p->listen();
+        return true;
+    }
+    auto id = this->topic(pattern);
+    if (id == 0) return false;
+    p->patterns_.emplace_back(pattern);
+    p->refresh();  // the topic may be a new one
+    ++(p->wanted_[p->ring_of(id)]);
+    p->set(id, true);
+    p->listen();
+    return true;
+}
+
+void bus::unsubscribe(char const * pattern) {
+    auto p = impl(p_);
+    if (!p->receiving() || (pattern == nullptr)) return;
+    for (auto it = p->patterns_.begin(); it != p->patterns_.end(); ++it) {
+        if (*it == pattern) {
+            if (is_pattern(pattern)) --(p->wildcards_);
+            p->patterns_.erase(it);
+            p->rebuild();
+            return;
+        }
+    }
+}
+
+buffer bus::recv(std::uint64_t tm, topic_t * topic) {
+    auto p = impl(p_);
+    if (!p->receiving() || p->rings_.empty()) return {};
+    for (;;) {
+        p->refresh();
+        topic_t id = 0;
+        auto buf = p->recv(tm, &id);
+        if (buf.empty()) return {};
+        if (id > p->known_) {
+            // newer than what the filter knew: let through by a wildcard, check it now
+            p->refresh();
+            if ((id > p->known_) || !p->wanted(id)) continue;
+        }
+        if (topic != nullptr) *topic = id;
+        return buf;
+    }
+}
+
+buffer bus::try_recv(topic_t * topic) {
+    return this->recv(0, topic);
+}
+
+} // namespace ipc
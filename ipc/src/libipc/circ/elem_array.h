@@ -120,6 +120,16 @@ public:
         return head_.cursor();
     }
 
+    /* Read-only views of the ring, for inspection tools. */
+
+    policy_t const & head() const noexcept {
+        return head_;
+    }
+
+    elem_t const * block() const noexcept {
+        return block_;
+    }
+
     template <typename Q, typename F>
     bool push(Q* que, F&& f) {
         return head_.push(que, std::forward<F>(f), block_);
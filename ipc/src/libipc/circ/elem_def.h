@@ -9,6 +9,7 @@
 #include "libipc/rw_lock.h"
 
 #include "libipc/platform/detail.h"
+#include "libipc/utility/utility.h"
 
 namespace ipc {
 namespace circ {
@@ -23,6 +24,37 @@ constexpr u1_t index_of(u2_t c) noexcept {
     return static_cast<u1_t>(c);
 }
 
+/**
+ * Element layout policies.
+ *
+ * An element is the payload followed by the producer-consumer control words
+ * (read counter, commit flag). With 'packed' adjacent elements share cache lines,
+ * so a reader releasing slot i contends with the writer filling slot i + 1.
+*/
+namespace layout {
+
+/// Elements are laid out back to back (the default, and the shm layout of channels).
+struct packed {
+    enum : std::size_t { elem_align = 1, ctrl_align = 1 };
+};
+
+/// Every element starts on a cache line and fills whole cache lines.
+struct cache_line {
+    enum : std::size_t { elem_align = ipc::cache_line_size, ctrl_align = 1 };
+};
+
+/// Like cache_line, and the control words get a cache line of their own.
+struct split_ctrl {
+    enum : std::size_t { elem_align = ipc::cache_line_size, ctrl_align = ipc::cache_line_size };
+};
+
+} // namespace layout
+
+/// Alignment to request for a member: never weaker than its natural alignment.
+constexpr std::size_t align_for(std::size_t layout_align, std::size_t natural) noexcept {
+    return (layout_align > natural) ? layout_align : natural;
+}
+
 class conn_head_base {
 protected:
     std::atomic<cc_t> cc_{0}; // connections
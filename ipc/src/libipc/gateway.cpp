@@ -0,0 +1,659 @@
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "libipc/gateway.h"
+#include "libipc/ipc.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/pimpl.h"
+#include "libipc/platform/detail.h"
+
+#if !defined(IPC_OS_WINDOWS_)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+namespace {
+
+constexpr char const tcp_scheme[]  = "tcp://";
+constexpr char const unix_scheme[] = "unix://";
+
+enum : std::size_t {
+    head_size  = 4,
+    read_chunk = 64 * 1024
+};
+
+enum : std::uint64_t {
+    wait_slice = 100    /* ms, how long run() and a stalled re-send wait at a time */
+};
+
+bool starts_with(char const * str, char const * prefix) noexcept {
+    return std::strncmp(str, prefix, std::strlen(prefix)) == 0;
+}
+
+void put_size(ipc::byte_t * p, std::uint32_t size) noexcept {
+    p[0] = static_cast<ipc::byte_t>(size);
+    p[1] = static_cast<ipc::byte_t>(size >> 8);
+    p[2] = static_cast<ipc::byte_t>(size >> 16);
+    p[3] = static_cast<ipc::byte_t>(size >> 24);
+}
+
+std::uint32_t get_size(ipc::byte_t const * p) noexcept {
+    return  static_cast<std::uint32_t>(p[0])
+         | (static_cast<std::uint32_t>(p[1]) << 8)
+         | (static_cast<std::uint32_t>(p[2]) << 16)
+         | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+struct piece_t {
+    void const * data;
+    std::size_t  size;
+};
+
+#if !defined(IPC_OS_WINDOWS_)
+
+int poll_timeout(std::uint64_t tm) noexcept {
+    return (tm == ipc::invalid_value) ? -1 : static_cast<int>((std::min)(tm, std::uint64_t(INT_MAX)));
+}
+
+/* Splits "host:port", the host may be a bracketed IPv6 address. */
+bool split_host_port(std::string const & addr, std::string & host, std::string & port) {
+    auto colon = addr.rfind(':');
+    if (colon == std::string::npos) return false;
+    host = addr.substr(0, colon);
+    port = addr.substr(colon + 1);
+    if ((host.size() >= 2) && (host.front() == '[') && (host.back() == ']')) {
+        host = host.substr(1, host.size() - 2);
+    }
+    return !port.empty();
+}
+
+addrinfo *resolve(char const * endpoint, bool passive) {
+    std::string host, port;
+    if (!split_host_port(endpoint + sizeof(tcp_scheme) - 1, host, port)) {
+        ipc::error("fail gateway: bad endpoint: %s\n", endpoint);
+        return nullptr;
+    }
+    addrinfo hints {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = passive ? AI_PASSIVE : 0;
+    addrinfo *res = nullptr;
+    int err = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res);
+    if (err != 0) {
+        ipc::error("fail gateway: getaddrinfo(%s): %s\n", endpoint, ::gai_strerror(err));
+        return nullptr;
+    }
+    return res;
+}
+
+bool unix_addr(char const * endpoint, sockaddr_un & addr) {
+    char const * path = endpoint + sizeof(unix_scheme) - 1;
+    if ((path[0] == '\0') || (std::strlen(path) >= sizeof(addr.sun_path))) {
+        ipc::error("fail gateway: bad endpoint: %s\n", endpoint);
+        return false;
+    }
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path);
+    return true;
+}
+
+void set_options(int fd, int family) noexcept {
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#if defined(SO_NOSIGPIPE)
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (family != AF_UNIX) {
+        int on = 1; // batches are coalesced by the gateway itself
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+}
+
+int sock_connect(char const * endpoint) {
+    if (starts_with(endpoint, unix_scheme)) {
+        sockaddr_un addr;
+        if (!unix_addr(endpoint, addr)) return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ipc::error("fail gateway: connect(%s)[%d]\n", endpoint, errno);
+            ::close(fd);
+            return -1;
+        }
+        set_options(fd, AF_UNIX);
+        return fd;
+    }
+    if (!starts_with(endpoint, tcp_scheme)) {
+        ipc::error("fail gateway: unknown endpoint scheme: %s\n", endpoint);
+        return -1;
+    }
+    auto res = resolve(endpoint, false);
+    if (res == nullptr) return -1;
+    int fd = -1;
+    for (auto ai = res; ai != nullptr; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            set_options(fd, ai->ai_family);
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd < 0) ipc::error("fail gateway: connect(%s)[%d]\n", endpoint, errno);
+    return fd;
+}
+
+int sock_listen(char const * endpoint, std::string & bound) {
+    if (starts_with(endpoint, unix_scheme)) {
+        sockaddr_un addr;
+        if (!unix_addr(endpoint, addr)) return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        // Remove the socket file of a previous gateway only if it is stale:
+        // nobody accepts on it any more.
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe >= 0) {
+            if (::connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+                ipc::error("fail gateway: listen(%s): in use by another gateway\n", endpoint);
+                ::close(probe);
+                ::close(fd);
+                return -1;
+            }
+            if (errno == ECONNREFUSED) ::unlink(addr.sun_path);
+            ::close(probe);
+        }
+        if ((::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) ||
+            (::listen(fd, 4) != 0)) {
+            ipc::error("fail gateway: listen(%s)[%d]\n", endpoint, errno);
+            ::close(fd);
+            return -1;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        bound = endpoint;
+        return fd;
+    }
+    if (!starts_with(endpoint, tcp_scheme)) {
+        ipc::error("fail gateway: unknown endpoint scheme: %s\n", endpoint);
+        return -1;
+    }
+    auto res = resolve(endpoint, true);
+    if (res == nullptr) return -1;
+    int fd = -1;
+    for (auto ai = res; ai != nullptr; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if ((::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) && (::listen(fd, 4) == 0)) {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd < 0) {
+        ipc::error("fail gateway: listen(%s)[%d]\n", endpoint, errno);
+        return -1;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    // Report the port actually bound, for "tcp://host:0".
+    sockaddr_storage ss {};
+    socklen_t len = sizeof(ss);
+    char host[INET6_ADDRSTRLEN] {}, port[16] {};
+    if ((::getsockname(fd, reinterpret_cast<sockaddr *>(&ss), &len) == 0) &&
+        (::getnameinfo(reinterpret_cast<sockaddr *>(&ss), len, host, sizeof(host), port, sizeof(port),
+                       NI_NUMERICHOST | NI_NUMERICSERV) == 0)) {
+        bound = std::string{tcp_scheme} + ((ss.ss_family == AF_INET6) ? ("[" + std::string{host} + "]") : host)
+              + ":" + port;
+    }
+    else bound = endpoint;
+    return fd;
+}
+
+/* Returns 1 if fd is readable, 0 on timeout, -1 on error. */
+int wait_readable(int fd, std::uint64_t tm) noexcept {
+    pollfd pfd {fd, POLLIN, 0};
+    int ret = ::poll(&pfd, 1, poll_timeout(tm));
+    if (ret < 0) return (errno == EINTR) ? 0 : -1;
+    return (ret > 0) ? 1 : 0;
+}
+
+int sock_accept(int lfd, std::uint64_t tm) {
+    if (wait_readable(lfd, tm) <= 0) return -1;
+    int fd = ::accept(lfd, nullptr, nullptr);
+    if (fd < 0) return -1;
+    sockaddr_storage ss {};
+    socklen_t len = sizeof(ss);
+    ::getsockname(fd, reinterpret_cast<sockaddr *>(&ss), &len);
+    set_options(fd, ss.ss_family);
+    return fd;
+}
+
+/* Returns the number of bytes read, 0 when the peer has closed, -1 on error. */
+long sock_read(int fd, void * buf, std::size_t size) noexcept {
+    for (;;) {
+        auto n = ::read(fd, buf, size);
+        if ((n < 0) && (errno == EINTR)) continue;
+        return static_cast<long>(n);
+    }
+}
+
+/* Returns 1 if fd is writable, 0 on timeout, -1 on error. */
+int wait_writable(int fd, std::uint64_t tm) noexcept {
+    pollfd pfd {fd, POLLOUT, 0};
+    int ret = ::poll(&pfd, 1, poll_timeout(tm));
+    if (ret < 0) return (errno == EINTR) ? 0 : -1;
+    return (ret > 0) ? 1 : 0;
+}
+
+/*
+ * Writes all pieces, with as few gathering writes as the kernel allows.
+ * While the peer does not take more, waits wait_slice at a time,
+ * and gives up once quit is set.
+*/
+bool sock_write(int fd, piece_t * pieces, std::size_t count, std::atomic<bool> const & quit) noexcept {
+#if defined(IOV_MAX)
+    constexpr std::size_t iov_max = IOV_MAX;
+#else
+    constexpr std::size_t iov_max = 1024;
+#endif
+#if defined(MSG_NOSIGNAL)
+    constexpr int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+#else
+    constexpr int flags = MSG_DONTWAIT;
+#endif
+    iovec iov[64];
+    std::size_t done = 0;
+    while (done < count) {
+        std::size_t n = (std::min)({count - done, sizeof(iov) / sizeof(iov[0]), iov_max});
+        for (std::size_t i = 0; i < n; ++i) {
+            iov[i].iov_base = const_cast<void *>(pieces[done + i].data);
+            iov[i].iov_len  = pieces[done + i].size;
+        }
+        msghdr msg {};
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = n;
+        auto ret = ::sendmsg(fd, &msg, flags); // writev, without SIGPIPE
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                if (quit.load(std::memory_order_acquire)) return false;
+                if (wait_writable(fd, wait_slice) >= 0) continue;
+            }
+            ipc::error("fail gateway: sendmsg[%d]\n", errno);
+            return false;
+        }
+        // Skip what was written, and go on from the first partial piece.
+        auto left = static_cast<std::size_t>(ret);
+        while ((done < count) && (left >= pieces[done].size)) {
+            left -= pieces[done].size;
+            ++done;
+        }
+        if (left > 0) {
+            pieces[done].data  = static_cast<ipc::byte_t const *>(pieces[done].data) + left;
+            pieces[done].size -= left;
+        }
+    }
+    return true;
+}
+
+void sock_close(int & fd) noexcept {
+    if (fd < 0) return;
+    ::close(fd);
+    fd = -1;
+}
+
+#else /*IPC_OS_WINDOWS_*/
+
+int sock_connect(char const * endpoint) {
+    ipc::error("fail gateway: sockets are not supported on this platform: %s\n", endpoint);
+    return -1;
+}
+
+int sock_listen(char const * endpoint, std::string & /*bound*/) {
+    ipc::error("fail gateway: sockets are not supported on this platform: %s\n", endpoint);
+    return -1;
+}
+
+int  wait_readable(int, std::uint64_t)                  noexcept { return -1; }
+int  sock_accept(int, std::uint64_t)                            { return -1; }
+long sock_read(int, void *, std::size_t)                noexcept { return -1; }
+bool sock_write(int, piece_t *, std::size_t, std::atomic<bool> const &) noexcept { return false; }
+void sock_close(int & fd)                               noexcept { fd = -1; }
+
+#endif/*IPC_OS_WINDOWS_*/
+
+} // internal-linkage
+
+namespace ipc {
+
+////////////////////////////////////////////////////////////////
+/// class gateway_out implementation
+////////////////////////////////////////////////////////////////
+
+template <typename Flag>
+class gateway_out<Flag>::gateway_out_ : public ipc::pimpl<gateway_out_> {
+public:
+    ipc::chan_wrapper<Flag> chan_;
+    int fd_ = -1;
+    std::size_t batch_ = default_batch;
+    std::atomic<bool> quit_ {false};
+
+    std::vector<ipc::buff_t>                   buffs_;
+    std::vector<std::array<ipc::byte_t, head_size>> heads_;
+    std::vector<piece_t>                       pieces_;
+};
+
+template <typename Flag>
+gateway_out<Flag>::gateway_out()
+    : p_(p_->make()) {
+}
+
+template <typename Flag>
+gateway_out<Flag>::gateway_out(char const * channel, char const * endpoint, std::size_t batch)
+    : gateway_out() {
+    open(channel, endpoint, batch);
+}
+
+template <typename Flag>
+gateway_out<Flag>::~gateway_out() {
+    close();
+    p_->clear();
+}
+
+template <typename Flag>
+bool gateway_out<Flag>::open(char const * channel, char const * endpoint, std::size_t batch) {
+    close();
+    if ((channel == nullptr) || (endpoint == nullptr) || (batch == 0)) {
+        ipc::error("fail gateway_out::open: invalid arguments.\n");
+        return false;
+    }
+    auto p = impl(p_);
+    if (!p->chan_.connect(channel, ipc::receiver)) {
+        ipc::error("fail gateway_out::open: channel %s\n", channel);
+        return false;
+    }
+    p->fd_ = sock_connect(endpoint);
+    if (p->fd_ < 0) {
+        p->chan_.disconnect();
+        return false;
+    }
+    p->batch_ = batch;
+    p->buffs_ .reserve(batch);
+    p->heads_ .resize (batch);
+    p->pieces_.reserve(batch * 2);
+    return true;
+}
+
+template <typename Flag>
+void gateway_out<Flag>::close() noexcept {
+    auto p = impl(p_);
+    p->chan_.disconnect();
+    sock_close(p->fd_);
+}
+
+template <typename Flag>
+bool gateway_out<Flag>::valid() const noexcept {
+    return impl(p_)->fd_ >= 0;
+}
+
+template <typename Flag>
+std::size_t gateway_out<Flag>::pump(std::uint64_t tm) {
+    if (!valid()) return 0;
+    auto p = impl(p_);
+    auto buff = p->chan_.recv(tm);
+    // Whatever is queued behind the first message goes out in the same write.
+    while (!buff.empty()) {
+        p->buffs_.push_back(std::move(buff));
+        if (p->buffs_.size() == p->batch_) break;
+        buff = p->chan_.try_recv();
+    }
+    std::size_t n = p->buffs_.size();
+    if (n == 0) return 0;
+    p->pieces_.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+        auto & b = p->buffs_[i];
+        put_size(p->heads_[i].data(), static_cast<std::uint32_t>(b.size()));
+        p->pieces_.push_back({p->heads_[i].data(), head_size});
+        p->pieces_.push_back({b.data(), b.size()});
+    }
+    bool ok = sock_write(p->fd_, p->pieces_.data(), p->pieces_.size(), p->quit_);
+    p->buffs_.clear();
+    if (!ok) {
+        close();
+        return 0;
+    }
+    return n;
+}
+
+template <typename Flag>
+bool gateway_out<Flag>::run() {
+    auto p = impl(p_);
+    while (!p->quit_.load(std::memory_order_acquire)) {
+        pump(wait_slice);
+        if (!valid()) break;
+    }
+    // Stopping in the middle of a write to a stalled peer also closes the socket.
+    return p->quit_.exchange(false, std::memory_order_acq_rel);
+}
+
+template <typename Flag>
+void gateway_out<Flag>::stop() noexcept {
+    impl(p_)->quit_.store(true, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////
+/// class gateway_in implementation
+////////////////////////////////////////////////////////////////
+
+template <typename Flag>
+class gateway_in<Flag>::gateway_in_ : public ipc::pimpl<gateway_in_> {
+public:
+    ipc::chan_wrapper<Flag> chan_;
+    int lfd_ = -1;  // listening
+    int fd_  = -1;  // current peer
+    std::string endpoint_;
+    std::atomic<bool> quit_ {false};
+    std::size_t max_size_ = 0;
+
+    std::vector<ipc::byte_t> buf_;
+    std::size_t head_ = 0, tail_ = 0; // unparsed bytes are [head_, tail_)
+    bool stalled_ = false;            // the message at head_ could not be re-sent yet
+
+    /*
+     * Re-sends one message, waiting while the local receivers lag.
+     * Gives up on stop(), or after a wait_slice with no receiver at all.
+    */
+    bool deliver(void const * data, std::size_t size) {
+        while (!chan_.try_send(data, size, wait_slice)) {
+            if (quit_.load(std::memory_order_acquire)) return false;
+            if ((chan_.recv_count() == 0) && !chan_.wait_for_recv(1, wait_slice)) return false;
+        }
+        return true;
+    }
+
+    /*
+     * Re-sends the complete messages at the front of buf_, up to one that could
+     * not be sent, which stays there with everything behind it.
+     * Returns the number of messages re-sent.
+    */
+    std::size_t flush() {
+        std::size_t count = 0;
+        stalled_ = false;
+        for (;;) {
+            auto avail = tail_ - head_;
+            if (avail < head_size) break;
+            std::size_t size = get_size(buf_.data() + head_);
+            if ((size == 0) || (size > max_size_)) {
+                // Channels carry no empty message, and the length would size our buffer.
+                ipc::error("fail gateway_in: bad message size %zd (max %zd), peer dropped\n", size, max_size_);
+                sock_close(fd_);
+                head_ = tail_ = 0;
+                buf_.resize(read_chunk);
+                buf_.shrink_to_fit();
+                return count;
+            }
+            if (avail < head_size + size) {
+                if (head_size + size > buf_.size()) buf_.resize(head_size + size);
+                break;
+            }
+            if (!deliver(buf_.data() + head_ + head_size, size)) {
+                stalled_ = true;
+                break;
+            }
+            head_ += head_size + size;
+            ++count;
+        }
+        // keep what is left, at the front of the buffer
+        if (head_ > 0) {
+            std::memmove(buf_.data(), buf_.data() + head_, tail_ - head_);
+            tail_ -= head_;
+            head_  = 0;
+        }
+        return count;
+    }
+
+    /* The peer has gone: drops its partial message, keeps the complete ones not re-sent yet. */
+    void drop_partial() noexcept {
+        auto end = head_;
+        while (end + head_size <= tail_) {
+            auto next = end + head_size + get_size(buf_.data() + end);
+            if (next > tail_) break;
+            end = next;
+        }
+        tail_ = end;
+    }
+};
+
+template <typename Flag>
+gateway_in<Flag>::gateway_in()
+    : p_(p_->make()) {
+}
+
+template <typename Flag>
+gateway_in<Flag>::gateway_in(char const * endpoint, char const * channel, std::size_t max_size)
+    : gateway_in() {
+    open(endpoint, channel, max_size);
+}
+
+template <typename Flag>
+gateway_in<Flag>::~gateway_in() {
+    close();
+    p_->clear();
+}
+
+template <typename Flag>
+bool gateway_in<Flag>::open(char const * endpoint, char const * channel, std::size_t max_size) {
+    close();
+    if ((channel == nullptr) || (endpoint == nullptr) || (max_size == 0)) {
+        ipc::error("fail gateway_in::open: invalid arguments.\n");
+        return false;
+    }
+    auto p = impl(p_);
+    if (!p->chan_.connect(channel, ipc::sender)) {
+        ipc::error("fail gateway_in::open: channel %s\n", channel);
+        return false;
+    }
+    p->lfd_ = sock_listen(endpoint, p->endpoint_);
+    if (p->lfd_ < 0) {
+        p->chan_.disconnect();
+        return false;
+    }
+    p->buf_.resize(read_chunk);
+    p->head_ = p->tail_ = 0;
+    p->stalled_ = false;
+    p->max_size_ = max_size;
+    return true;
+}
+
+template <typename Flag>
+void gateway_in<Flag>::close() noexcept {
+    auto p = impl(p_);
+    p->chan_.disconnect();
+    sock_close(p->fd_);
+    sock_close(p->lfd_);
+    p->endpoint_.clear();
+}
+
+template <typename Flag>
+bool gateway_in<Flag>::valid() const noexcept {
+    return impl(p_)->lfd_ >= 0;
+}
+
+template <typename Flag>
+std::string gateway_in<Flag>::endpoint() const {
+    return impl(p_)->endpoint_;
+}
+
+template <typename Flag>
+std::size_t gateway_in<Flag>::pump(std::uint64_t tm) {
+    if (!valid()) return 0;
+    auto p = impl(p_);
+    std::size_t count = 0;
+    if (p->stalled_) {
+        // What could not be re-sent last time goes first, the socket waits meanwhile.
+        count = p->flush();
+        if (p->stalled_) return count;
+        if (count > 0) tm = 0; // done something already, do not wait for more
+    }
+    if (p->fd_ < 0) {
+        p->fd_ = sock_accept(p->lfd_, tm);
+        return count;
+    }
+    if (wait_readable(p->fd_, tm) <= 0) return count;
+    if (p->tail_ == p->buf_.size()) {
+        // only a partial message at the front: make room behind it
+        p->buf_.resize(p->buf_.size() * 2);
+    }
+    auto n = sock_read(p->fd_, p->buf_.data() + p->tail_, p->buf_.size() - p->tail_);
+    if (n <= 0) {
+        sock_close(p->fd_);
+        p->drop_partial();
+        return count;
+    }
+    p->tail_ += static_cast<std::size_t>(n);
+    return count + p->flush();
+}
+
+template <typename Flag>
+bool gateway_in<Flag>::run() {
+    auto p = impl(p_);
+    while (!p->quit_.load(std::memory_order_acquire)) {
+        pump(wait_slice);
+        if (!valid()) return false;
+    }
+    p->quit_.store(false, std::memory_order_release);
+    return true;
+}
+
+template <typename Flag>
+void gateway_in<Flag>::stop() noexcept {
+    impl(p_)->quit_.store(true, std::memory_order_release);
+}
+
+template class gateway_out<ipc::wr<relat::single, relat::multi, trans::broadcast>>;
+template class gateway_out<ipc::wr<relat::multi , relat::multi, trans::broadcast>>;
+template class gateway_in <ipc::wr<relat::single, relat::multi, trans::broadcast>>;
+template class gateway_in <ipc::wr<relat::multi , relat::multi, trans::broadcast>>;
+
+} // namespace ipc
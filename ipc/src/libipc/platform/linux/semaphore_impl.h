@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+
+#include <time.h>
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/utility.h"
+#include "libipc/rw_lock.h"
+#include "libipc/shm.h"
+#include "libipc/platform/posix/process.h"
+
+#include "a0/err_macro.h"
+#include "a0/ftx.h"
+
+namespace ipc {
+namespace detail {
+namespace sync {
+
+/*
+ * A counting semaphore on a futex word in a shm segment.
+ *
+ * There is no owner, so a dead process cannot leave it locked.
+ * The only thing one can take away is a wake-up (a poster dying between
+ * the increment and the FUTEX_WAKE), so sleeping waiters re-check the
+ * count every wait_slice ms. A waiter dying while counted in waiters_
+ * only costs posters an extra wake syscall.
+ *
+ * The segment starts zero-filled. Openers race on init_, the winner
+ * leaves its pid there while it stores the initial count and the others
+ * wait until it is ready, like sem_open(O_CREAT) does.
+ * If the winner died before that, a waiter takes its place.
+*/
+class semaphore {
+public:
+    struct sem_data {
+        alignas(cache_line_size) std::atomic<std::uint32_t> count_;
+        std::atomic<std::uint32_t> waiters_;
+        std::atomic<std::uint32_t> init_;
+    };
+
+private:
+    enum : unsigned {
+        spin_count = 32,    /* ipc::yield stays below sleeping */
+        wait_slice = 200,   /* ms */
+        init_wait  = 1000   /* ms */
+    };
+
+    enum : std::uint32_t {
+        uninit       = 0,
+        ready        = 2,
+        initializing = 0x80000000u  /* | the pid of the initializing opener */
+    };
+
+    ipc::shm::handle shm_;
+    sem_data *h_ = nullptr;
+
+    static a0_ftx_t *ftx_of(std::atomic<std::uint32_t> &word) noexcept {
+        static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(a0_ftx_t), "Unexpected atomic size.");
+        return reinterpret_cast<a0_ftx_t *>(&word);
+    }
+
+    void init(std::uint32_t count) noexcept {
+        h_->count_  .store(count, std::memory_order_relaxed);
+        h_->waiters_.store(0    , std::memory_order_relaxed);
+        h_->init_   .store(ready, std::memory_order_release);
+    }
+
+    bool try_take() noexcept {
+        auto c = h_->count_.load(std::memory_order_relaxed);
+        while (c > 0) {
+            if (h_->count_.compare_exchange_weak(c, c - 1, std::memory_order_acquire,
+                                                           std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static timespec deadline_of(std::uint64_t tm /*ms*/) noexcept {
+        timespec ts {};
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec  += static_cast<time_t>(tm / 1000);
+        ts.tv_nsec += static_cast<long>((tm % 1000) * 1000000);
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec  += 1;
+            ts.tv_nsec -= 1000000000;
+        }
+        return ts;
+    }
+
+    static bool before(timespec const &a, timespec const &b) noexcept {
+        return (a.tv_sec < b.tv_sec) || ((a.tv_sec == b.tv_sec) && (a.tv_nsec < b.tv_nsec));
+    }
+
+public:
+    semaphore() = default;
+    ~semaphore() noexcept = default;
+
+    sem_data *native() const noexcept {
+        return h_;
+    }
+
+    bool valid() const noexcept {
+        return h_ != nullptr;
+    }
+
+    bool open(char const *name, std::uint32_t count) noexcept {
+        close();
+        if (!shm_.acquire(name, sizeof(sem_data))) {
+            ipc::error("[open_semaphore] fail shm.acquire: %s\n", name);
+            return false;
+        }
+        h_ = static_cast<sem_data *>(shm_.get());
+        // Same as sem_open(O_CREAT): only the first opener sets the initial count.
+        auto self = initializing | curr_pid();
+        std::uint32_t state = uninit;
+        if (h_->init_.compare_exchange_strong(state, self, std::memory_order_acquire)) {
+            init(count);
+            return true;
+        }
+        auto deadline = deadline_of(init_wait);
+        for (unsigned k = 0; (state = h_->init_.load(std::memory_order_acquire)) != ready;) {
+            // Only the stores of init can be pending, so this takes long only if the opener died.
+            if ((k >= spin_count) && (state & initializing) && !pid_alive(state & ~initializing) &&
+                h_->init_.compare_exchange_strong(state, self, std::memory_order_acquire)) {
+                ipc::error("[open_semaphore] initializer (pid = %u) is dead, initialization taken over: %s\n",
+                           state & ~initializing, name);
+                init(count);
+                return true;
+            }
+            if (!before(deadline_of(0), deadline)) {
+                ipc::error("[open_semaphore] initialization did not complete: %s\n", name);
+                close();
+                return false;
+            }
+            ipc::sleep(k);
+        }
+        return true;
+    }
+
+    void close() noexcept {
+        if (!valid()) return;
+        shm_.release();
+        h_ = nullptr;
+    }
+
+    bool wait(std::uint64_t tm) noexcept {
+        if (!valid()) return false;
+        for (unsigned k = 0; k < spin_count;) {
+            if (try_take()) return true;
+            if (tm == 0) return false;
+            ipc::yield(k);
+        }
+        auto deadline = deadline_of((tm == invalid_value) ? 0 : tm);
+        bool ret = false;
+        h_->waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (;;) {
+            if (try_take()) {
+                ret = true;
+                break;
+            }
+            auto slice = deadline_of(wait_slice);
+            if ((tm != invalid_value) && before(deadline, slice)) {
+                slice = deadline;
+            }
+            int eno = A0_SYSERR(a0_futex(ftx_of(h_->count_), FUTEX_WAIT_BITSET, 0,
+                                         reinterpret_cast<uintptr_t>(&slice), nullptr, FUTEX_BITSET_MATCH_ANY));
+            if ((eno != 0) && (eno != EAGAIN) && (eno != EINTR) && (eno != ETIMEDOUT)) {
+                ipc::error("fail semaphore wait[%d]: %s\n", eno, shm_.name());
+                break;
+            }
+            if ((tm != invalid_value) && !before(deadline_of(0), deadline)) {
+                ret = try_take();
+                break;
+            }
+        }
+        h_->waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return ret;
+    }
+
+    bool post(std::uint32_t count) noexcept {
+        if (!valid()) return false;
+        if (count == 0) return true;
+        h_->count_.fetch_add(count, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto waiters = h_->waiters_.load(std::memory_order_relaxed);
+        if (waiters == 0) return true;
+        // One syscall for the whole batch.
+        int n = static_cast<int>((std::min)({count, waiters, static_cast<std::uint32_t>(INT_MAX)}));
+        int eno = A0_SYSERR(a0_ftx_wake(ftx_of(h_->count_), n));
+        if (eno != 0) {
+            ipc::error("fail semaphore post[%d]: %s\n", eno, shm_.name());
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace sync
+} // namespace detail
+} // namespace ipc
@@ -7,3 +7,43 @@
 #else/*IPC_OS*/
 #   error "Unsupported platform."
 #endif
+
+#include "libipc/platform/shm_local.h"
+
+namespace ipc {
+namespace shm {
+
+id_t acquire(char const * name, std::size_t size, unsigned mode) {
+    return is_local(name) ? local::acquire(name, size, mode)
+                          : sys  ::acquire(name, size, mode);
+}
+
+std::int32_t get_ref(id_t id) {
+    return local::is_local(id) ? local::get_ref(id) : sys::get_ref(id);
+}
+
+void sub_ref(id_t id) {
+    if (local::is_local(id)) local::sub_ref(id);
+    else                     sys  ::sub_ref(id);
+}
+
+void * get_mem(id_t id, std::size_t * size) {
+    return local::is_local(id) ? local::get_mem(id, size) : sys::get_mem(id, size);
+}
+
+std::int32_t release(id_t id) {
+    return local::is_local(id) ? local::release(id) : sys::release(id);
+}
+
+void remove(id_t id) {
+    if (local::is_local(id)) local::remove(id);
+    else                     sys  ::remove(id);
+}
+
+void remove(char const * name) {
+    if (is_local(name)) local::remove(name);
+    else                sys  ::remove(name);
+}
+
+} // namespace shm
+} // namespace ipc
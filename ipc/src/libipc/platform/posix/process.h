@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace ipc {
+namespace detail {
+
+inline std::uint32_t &pid_cache() noexcept {
+    // getpid is a real syscall on recent glibc, so cache it and refresh after fork.
+    static std::uint32_t pid = [] {
+        ::pthread_atfork(nullptr, nullptr, [] {
+            pid_cache() = static_cast<std::uint32_t>(::getpid());
+        });
+        return static_cast<std::uint32_t>(::getpid());
+    }();
+    return pid;
+}
+
+inline std::uint32_t curr_pid() noexcept {
+    return pid_cache();
+}
+
+/**
+ * Returns false only if the process certainly no longer exists.
+ * A process we are not allowed to signal is still alive.
+*/
+inline bool pid_alive(std::uint32_t pid) noexcept {
+    if (pid == 0) return false;
+    if (::kill(static_cast<pid_t>(pid), 0) == 0) return true;
+    return errno != ESRCH;
+}
+
+} // namespace detail
+} // namespace ipc
@@ -43,6 +43,7 @@ inline auto& acc_of(void* mem, std::size_t size) {
 
 namespace ipc {
 namespace shm {
+namespace sys {
 
 id_t acquire(char const * name, std::size_t size, unsigned mode) {
     if (name == nullptr || name[0] == '\0') {
@@ -193,5 +194,6 @@ void remove(char const * name) {
     ::shm_unlink((ipc::string{"__IPC_SHM__"} + name).c_str());
 }
 
+} // namespace sys
 } // namespace shm
 } // namespace ipc
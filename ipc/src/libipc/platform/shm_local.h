@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+
+#include "libipc/shm.h"
+#include "libipc/def.h"
+#include "libipc/pool_alloc.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/utility.h"
+#include "libipc/memory/resource.h"
+#include "libipc/platform/detail.h"
+
+namespace ipc {
+namespace shm {
+namespace local {
+
+/*
+ * Process-local "shared memory", for names starting with local_prefix.
+ *
+ * A segment is a zero-filled heap block, found by name in a registry.
+ * As with shm_unlink, removing a name only detaches it from the registry:
+ * the block is freed when the last handle releases it.
+*/
+
+struct segment_t {
+    void*       mem_  = nullptr;
+    std::size_t size_ = 0;
+    ipc::string name_;
+    // All guarded by registry().lock_.
+    std::int32_t ref_     = 0;  // mapped handles, what get_ref reports
+    std::int32_t pending_ = 0;  // acquired, not mapped yet
+    bool         named_   = true;
+};
+
+struct id_info_t {
+    segment_t* seg_  = nullptr;
+    bool       mapped_ = false;
+};
+
+struct registry_t {
+    std::mutex lock_;
+    ipc::map<ipc::string, segment_t*> segs_;
+};
+
+inline registry_t &registry() {
+    static registry_t *reg = new registry_t; // never destroyed, segments may outlive statics
+    return *reg;
+}
+
+inline void free_segment(segment_t *seg) {
+    ::operator delete(seg->mem_, std::align_val_t{cache_line_size});
+    mem::free(seg);
+}
+
+/* Local ids are tagged in their lowest bit, platform ids are never odd. */
+
+inline bool is_local(id_t id) noexcept {
+    return (reinterpret_cast<std::uintptr_t>(id) & 1u) != 0;
+}
+
+inline id_t to_id(id_info_t *ii) noexcept {
+    return reinterpret_cast<id_t>(reinterpret_cast<std::uintptr_t>(ii) | 1u);
+}
+
+inline id_info_t *info_of(id_t id) noexcept {
+    return reinterpret_cast<id_info_t *>(reinterpret_cast<std::uintptr_t>(id) & ~std::uintptr_t(1));
+}
+
+inline id_t acquire(char const * name, std::size_t size, unsigned mode) {
+    auto &reg = registry();
+    IPC_UNUSED_ std::lock_guard<std::mutex> guard {reg.lock_};
+    auto it = reg.segs_.find(name);
+    if (it == reg.segs_.end()) {
+        if (mode == open) {
+            ipc::error("fail acquire: local memory does not exist: %s\n", name);
+            return nullptr;
+        }
+        if (size == 0) {
+            ipc::error("fail acquire: local memory size is 0: %s\n", name);
+            return nullptr;
+        }
+        auto seg = mem::alloc<segment_t>();
+        seg->name_ = name;
+        seg->size_ = ipc::make_align(cache_line_size, size);
+        seg->mem_  = ::operator new(seg->size_, std::align_val_t{cache_line_size});
+        std::memset(seg->mem_, 0, seg->size_);
+        it = reg.segs_.emplace(name, seg).first;
+    }
+    else if (mode == create) {
+        ipc::error("fail acquire: local memory already exists: %s\n", name);
+        return nullptr;
+    }
+    auto ii = mem::alloc<id_info_t>();
+    ii->seg_ = it->second;
+    ++(ii->seg_->pending_);
+    return to_id(ii);
+}
+
+inline std::int32_t get_ref(id_t id) {
+    auto ii = info_of(id);
+    IPC_UNUSED_ std::lock_guard<std::mutex> guard {registry().lock_};
+    return ii->mapped_ ? ii->seg_->ref_ : 0;
+}
+
+inline void sub_ref(id_t id) {
+    auto ii = info_of(id);
+    IPC_UNUSED_ std::lock_guard<std::mutex> guard {registry().lock_};
+    if (!ii->mapped_) {
+        ipc::error("fail sub_ref: invalid id (not mapped)\n");
+        return;
+    }
+    --(ii->seg_->ref_);
+}
+
+inline void * get_mem(id_t id, std::size_t * size) {
+    auto ii = info_of(id);
+    IPC_UNUSED_ std::lock_guard<std::mutex> guard {registry().lock_};
+    if (!ii->mapped_) {
+        ii->mapped_ = true;
+        --(ii->seg_->pending_);
+        ++(ii->seg_->ref_);
+    }
+    if (size != nullptr) *size = ii->seg_->size_;
+    return ii->seg_->mem_;
+}
+
+inline void detach_name(registry_t &reg, segment_t *seg) {
+    if (!seg->named_) return;
+    seg->named_ = false;
+    reg.segs_.erase(seg->name_);
+}
+
+inline std::int32_t release(id_t id) {
+    auto ii  = info_of(id);
+    auto seg = ii->seg_;
+    auto &reg = registry();
+    std::int32_t ret = -1;
+    {
+        IPC_UNUSED_ std::lock_guard<std::mutex> guard {reg.lock_};
+        if (ii->mapped_) {
+            ret = seg->ref_--;
+        }
+        else {
+            ipc::error("fail release: invalid id (not mapped)\n");
+            --(seg->pending_);
+        }
+        if (seg->ref_ > 0) {
+            seg = nullptr;
+        }
+        else {
+            detach_name(reg, seg);  // like shm_unlink on the last release
+            if (seg->pending_ > 0) seg = nullptr;
+        }
+    }
+    if (seg != nullptr) free_segment(seg);
+    mem::free(ii);
+    return ret;
+}
+
+inline void remove(id_t id) {
+    auto seg = info_of(id)->seg_;
+    {
+        IPC_UNUSED_ std::lock_guard<std::mutex> guard {registry().lock_};
+        detach_name(registry(), seg);
+    }
+    release(id);
+}
+
+inline void remove(char const * name) {
+    auto &reg = registry();
+    segment_t *seg = nullptr;
+    {
+        IPC_UNUSED_ std::lock_guard<std::mutex> guard {reg.lock_};
+        auto it = reg.segs_.find(name);
+        if (it == reg.segs_.end()) return;
+        seg = it->second;
+        detach_name(reg, seg);
+        if ((seg->ref_ > 0) || (seg->pending_ > 0)) return; // freed by the last release
+    }
+    free_segment(seg);
+}
+
+} // namespace local
+} // namespace shm
+} // namespace ipc
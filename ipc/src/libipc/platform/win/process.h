@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Windows.h>
+
+namespace ipc {
+namespace detail {
+
+inline std::uint32_t curr_pid() noexcept {
+    return static_cast<std::uint32_t>(::GetCurrentProcessId());
+}
+
+/**
+ * Returns false only if the process certainly no longer exists.
+ * A process we are not allowed to open is still alive.
+*/
+inline bool pid_alive(std::uint32_t pid) noexcept {
+    if (pid == 0) return false;
+    HANDLE h = ::OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+    if (h == NULL) {
+        return ::GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+    DWORD r = ::WaitForSingleObject(h, 0);
+    ::CloseHandle(h);
+    return r == WAIT_TIMEOUT;
+}
+
+} // namespace detail
+} // namespace ipc
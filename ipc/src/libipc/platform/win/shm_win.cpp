@@ -26,6 +26,7 @@ struct id_info_t {
 
 namespace ipc {
 namespace shm {
+namespace sys {
 
 id_t acquire(char const * name, std::size_t size, unsigned mode) {
     if (name == nullptr || name[0] == '\0') {
@@ -131,5 +132,6 @@ void remove(char const * name) {
     // Do Nothing.
 }
 
+} // namespace sys
 } // namespace shm
 } // namespace ipc
@@ -10,16 +10,25 @@
 namespace ipc {
 namespace policy {
 
-template <template <typename, std::size_t...> class Elems, typename Flag>
+template <template <typename, std::size_t...> class Elems, typename Flag,
+          typename Layout = circ::layout::packed>
 struct choose;
 
 template <typename Flag>
-struct choose<circ::elem_array, Flag> {
+struct choose<circ::elem_array, Flag, circ::layout::packed> {
     using flag_t = Flag;
 
     template <std::size_t DataSize, std::size_t AlignSize>
     using elems_t = circ::elem_array<ipc::prod_cons_impl<flag_t>, DataSize, AlignSize>;
 };
 
+template <typename Flag, typename Layout>
+struct choose<circ::elem_array, Flag, Layout> {
+    using flag_t = Flag;
+
+    template <std::size_t DataSize, std::size_t AlignSize>
+    using elems_t = circ::elem_array<ipc::prod_cons_layout<flag_t, Layout>, DataSize, AlignSize>;
+};
+
 } // namespace policy
 } // namespace ipc
@@ -7,10 +7,10 @@
 #include <cstdint>
 
 #include "libipc/def.h"
+#include "libipc/trace.h"
 
 #include "libipc/platform/detail.h"
 #include "libipc/circ/elem_def.h"
-#include "libipc/utility/log.h"
 #include "libipc/utility/utility.h"
 
 namespace ipc {
@@ -25,8 +25,9 @@ struct prod_cons_impl;
 template <>
 struct prod_cons_impl<wr<relat::single, relat::single, trans::unicast>> {
 
-    template <std::size_t DataSize, std::size_t AlignSize>
+    template <std::size_t DataSize, std::size_t AlignSize, typename Layout = circ::layout::packed>
     struct elem_t {
+        alignas(circ::align_for(Layout::elem_align, AlignSize))
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
     };
 
@@ -81,10 +82,9 @@ struct prod_cons_impl<wr<relat::single, relat::multi , trans::unicast>>
         return false;
     }
 
-    template <typename W, typename F, typename R, 
-              template <std::size_t, std::size_t> class E, std::size_t DS, std::size_t AS>
-    bool pop(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, R&& out, E<DS, AS>* elems) {
-        byte_t buff[DS];
+    template <typename W, typename F, typename R, typename E>
+    bool pop(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, R&& out, E* elems) {
+        byte_t buff[sizeof(E::data_)];
         for (unsigned k = 0;;) {
             auto cur_rd = rd_.load(std::memory_order_relaxed);
             if (circ::index_of(cur_rd) ==
@@ -108,9 +108,11 @@ struct prod_cons_impl<wr<relat::multi , relat::multi, trans::unicast>>
 
     using flag_t = std::uint64_t;
 
-    template <std::size_t DataSize, std::size_t AlignSize>
+    template <std::size_t DataSize, std::size_t AlignSize, typename Layout = circ::layout::packed>
     struct elem_t {
+        alignas(circ::align_for(Layout::elem_align, AlignSize))
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
+        alignas(circ::align_for(Layout::ctrl_align, alignof(std::atomic<flag_t>)))
         std::atomic<flag_t> f_ct_ { 0 }; // commit flag
     };
 
@@ -159,10 +161,9 @@ struct prod_cons_impl<wr<relat::multi , relat::multi, trans::unicast>>
         return false;
     }
 
-    template <typename W, typename F, typename R, 
-              template <std::size_t, std::size_t> class E, std::size_t DS, std::size_t AS>
-    bool pop(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, R&& out, E<DS, AS>* elems) {
-        byte_t buff[DS];
+    template <typename W, typename F, typename R, typename E>
+    bool pop(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, R&& out, E* elems) {
+        byte_t buff[sizeof(E::data_)];
         for (unsigned k = 0;;) {
             auto cur_rd = rd_.load(std::memory_order_relaxed);
             auto cur_wt = wt_.load(std::memory_order_acquire);
@@ -202,9 +203,11 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
         ep_incr = 0x0000000100000000ull
     };
 
-    template <std::size_t DataSize, std::size_t AlignSize>
+    template <std::size_t DataSize, std::size_t AlignSize, typename Layout = circ::layout::packed>
     struct elem_t {
+        alignas(circ::align_for(Layout::elem_align, AlignSize))
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
+        alignas(circ::align_for(Layout::ctrl_align, alignof(std::atomic<rc_t>)))
         std::atomic<rc_t> rc_ { 0 }; // read-counter
     };
 
@@ -252,7 +255,7 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & ep_mask;
             if (cc & rem_cc) {
-                ipc::log("force_push: k = %u, cc = %u, rem_cc = %u\n", k, cc, rem_cc);
+                ipc::trace::report(ipc::trace::event::queue_force_push, k, cc, rem_cc);
                 cc = wrapper->elems()->disconnect_receiver(rem_cc); // disconnect all invalid readers
                 if (cc == 0) return false; // no reader
             }
@@ -303,9 +306,11 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
         ic_incr = 0x0000000100000000ull
     };
 
-    template <std::size_t DataSize, std::size_t AlignSize>
+    template <std::size_t DataSize, std::size_t AlignSize, typename Layout = circ::layout::packed>
     struct elem_t {
+        alignas(circ::align_for(Layout::elem_align, AlignSize))
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
+        alignas(circ::align_for(Layout::ctrl_align, alignof(std::atomic<rc_t>)))
         std::atomic<rc_t  > rc_   { 0 }; // read-counter
         std::atomic<flag_t> f_ct_ { 0 }; // commit flag
     };
@@ -375,7 +380,7 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & rc_mask;
             if (cc & rem_cc) {
-                ipc::log("force_push: k = %u, cc = %u, rem_cc = %u\n", k, cc, rem_cc);
+                ipc::trace::report(ipc::trace::event::queue_force_push, k, cc, rem_cc);
                 cc = wrapper->elems()->disconnect_receiver(rem_cc); // disconnect all invalid readers
                 if (cc == 0) return false; // no reader
             }
@@ -430,4 +435,16 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
     }
 };
 
+/**
+ * prod_cons_impl<Flag>, with its elements laid out by Layout (see circ::layout).
+*/
+template <typename Flag, typename Layout>
+struct prod_cons_layout : prod_cons_impl<Flag> {
+    template <std::size_t DataSize, std::size_t AlignSize>
+    using elem_t = typename prod_cons_impl<Flag>::template elem_t<DataSize, AlignSize, Layout>;
+};
+
+template <typename Flag, typename Layout>
+struct relat_trait<prod_cons_layout<Flag, Layout>> : relat_trait<Flag> {};
+
 } // namespace ipc
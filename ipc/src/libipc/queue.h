@@ -155,6 +155,11 @@ public:
         return !valid() || (cursor_ == elems_->cursor());
     }
 
+    /* How far this receiver has read. */
+    auto cursor() const noexcept {
+        return cursor_;
+    }
+
     template <typename T, typename F, typename... P>
     bool push(F&& prep, P&&... params) {
         if (elems_ == nullptr) return false;
@@ -180,6 +185,23 @@ public:
             ::new (&item) T(std::move(*static_cast<T*>(p)));
         }, std::forward<F>(out));
     }
+
+    /**
+     * Pops an element, but copies it into item only if pred holds for it,
+     * pred being given the element where it lies in the queue.
+     * Returns false if empty; taken tells whether item has been filled.
+    */
+    template <typename T, typename P, typename F>
+    bool pop_if(T& item, bool& taken, P&& pred, F&& out) {
+        if (elems_ == nullptr) {
+            return false;
+        }
+        return elems_->pop(this, &(this->cursor_), [&item, &taken, &pred](void* p) {
+            if ((taken = pred(*static_cast<T const *>(p)))) {
+                ::new (&item) T(std::move(*static_cast<T*>(p)));
+            }
+        }, std::forward<F>(out));
+    }
 };
 
 } // namespace detail
@@ -211,6 +233,11 @@ public:
     bool pop(T& item, F&& out) {
         return base_t::pop(item, std::forward<F>(out));
     }
+
+    template <typename P, typename F>
+    bool pop_if(T& item, bool& taken, P&& pred, F&& out) {
+        return base_t::pop_if(item, taken, std::forward<P>(pred), std::forward<F>(out));
+    }
 };
 
 } // namespace ipc
@@ -0,0 +1,387 @@
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "libipc/rpc.h"
+#include "libipc/ipc.h"
+#include "libipc/ipc.inc"   // detail::chan_inline, for sending a head and a payload as one message
+#include "libipc/shm.h"
+#include "libipc/pool_alloc.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/pimpl.h"
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include "libipc/platform/win/process.h"
+#else
+#include "libipc/platform/posix/process.h"
+#endif
+
+namespace {
+
+using chan_t = ipc::detail::chan_inline<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>>;
+using clock_type = std::chrono::steady_clock;
+
+constexpr char const reply_prefix[] = "__RPC_REP__";
+
+/* Put in front of every request and every reply. */
+struct rpc_head {
+    std::uint64_t client_;
+    std::uint32_t slot_;
+    std::uint32_t seq_;     // tells a late reply from the reply of the slot's current call
+};
+
+enum : std::uint64_t {
+    wait_slice = 100    /* ms, how long a receiver blocks before re-checking */
+};
+
+std::string reply_name(char const * name, std::uint64_t client) {
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "%s%016llx__", reply_prefix, static_cast<unsigned long long>(client));
+    return ipc::shm::make_name(prefix, name);
+}
+
+std::uint64_t make_client_id() noexcept {
+    static std::atomic<std::uint32_t> counter {0};
+    return (static_cast<std::uint64_t>(ipc::detail::curr_pid()) << 32)
+          | counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Returns a view of buff past its rpc_head, keeping buff (and its chunk) alive.
+*/
+ipc::buff_t payload_of(ipc::buff_t && buff) {
+    auto size = buff.size() - sizeof(rpc_head);
+    auto data = static_cast<ipc::byte_t *>(buff.data()) + sizeof(rpc_head);
+    auto hold = ipc::mem::alloc<ipc::buff_t>(std::move(buff));
+    return ipc::buff_t{data, size, [](void * p, std::size_t) {
+        ipc::mem::free(static_cast<ipc::buff_t *>(p));
+    }, hold};
+}
+
+bool head_of(ipc::buff_t const & buff, rpc_head & head) noexcept {
+    if (buff.size() < sizeof(rpc_head)) return false;
+    std::memcpy(&head, buff.data(), sizeof(rpc_head));
+    return true;
+}
+
+} // internal-linkage
+
+namespace ipc {
+
+////////////////////////////////////////////////////////////////
+/// class rpc_client implementation
+////////////////////////////////////////////////////////////////
+
+class rpc_client::rpc_client_ : public ipc::pimpl<rpc_client_> {
+public:
+    struct slot_t {
+        std::condition_variable cv_;
+        std::uint32_t seq_  = 0;
+        bool          busy_ = false;
+        bool          done_ = false;
+        ipc::buff_t   reply_;
+    };
+
+    std::uint64_t id_ = 0;
+    ipc::channel  req_;
+    ipc::channel  rep_;
+
+    // Everything below is guarded by lock_.
+    std::mutex lock_;
+    std::unique_ptr<slot_t[]>  slots_;
+    std::size_t                slot_count_ = 0;
+    std::vector<std::uint32_t> free_;
+    std::condition_variable    free_cv_;
+    bool receiving_ = false;    // somebody is blocked in rep_.recv
+
+    /* Stores the reply in its slot, or drops it if nobody waits for it any more. */
+    void dispatch(ipc::buff_t && buff) {
+        rpc_head head;
+        if (!head_of(buff, head) || (head.client_ != id_) || (head.slot_ >= slot_count_)) {
+            ipc::error("fail rpc_client: bad reply (size = %zd)\n", buff.size());
+            return;
+        }
+        auto &slot = slots_[head.slot_];
+        if (!slot.busy_ || slot.done_ || (slot.seq_ != head.seq_)) return; // the call has timed out
+        slot.reply_ = payload_of(std::move(buff));
+        slot.done_  = true;
+        slot.cv_.notify_one();
+    }
+
+    /* Lets another pending call take over receiving. */
+    void hand_over() {
+        for (std::size_t i = 0; i < slot_count_; ++i) {
+            if (slots_[i].busy_ && !slots_[i].done_) {
+                slots_[i].cv_.notify_one();
+                return;
+            }
+        }
+    }
+
+    void release(std::uint32_t idx) {
+        auto &slot = slots_[idx];
+        slot.busy_ = false;
+        slot.done_ = false;
+        slot.reply_ = {};
+        free_.push_back(idx);
+        free_cv_.notify_one();
+    }
+};
+
+rpc_client::rpc_client()
+    : p_(p_->make()) {
+}
+
+rpc_client::rpc_client(char const * name, std::size_t slots)
+    : rpc_client() {
+    connect(name, slots);
+}
+
+rpc_client::~rpc_client() {
+    disconnect();
+    p_->clear();
+}
+
+bool rpc_client::valid() const noexcept {
+    return impl(p_)->slot_count_ != 0;
+}
+
+bool rpc_client::connect(char const * name, std::size_t slots) {
+    disconnect();
+    if ((name == nullptr) || (name[0] == '\0') || (slots == 0)) {
+        ipc::error("fail rpc_client::connect: invalid arguments.\n");
+        return false;
+    }
+    auto p = impl(p_);
+    p->id_ = make_client_id();
+    // Listen for replies before any request can be answered.
+    if (!p->rep_.connect(reply_name(name, p->id_).c_str(), ipc::receiver) ||
+        !p->req_.connect(name, ipc::sender)) {
+        ipc::error("fail rpc_client::connect: %s\n", name);
+        disconnect();
+        return false;
+    }
+    p->slots_.reset(new rpc_client_::slot_t[slots]);
+    p->slot_count_ = slots;
+    p->free_.clear();
+    for (std::size_t i = slots; i > 0; --i) {
+        p->free_.push_back(static_cast<std::uint32_t>(i - 1));
+    }
+    return true;
+}
+
+void rpc_client::disconnect() noexcept {
+    auto p = impl(p_);
+    p->req_.disconnect();
+    p->rep_.disconnect();
+    p->slots_.reset();
+    p->slot_count_ = 0;
+    p->free_.clear();
+}
+
+std::uint64_t rpc_client::id() const noexcept {
+    return impl(p_)->id_;
+}
+
+buffer rpc_client::call(void const * data, std::size_t size, std::uint64_t tm) {
+    if (!valid()) return {};
+    auto p = impl(p_);
+    auto deadline = (tm == invalid_value) ? clock_type::time_point::max()
+                                          : clock_type::now() + std::chrono::milliseconds(tm);
+    auto timed_out = [&deadline] {
+        return (deadline != clock_type::time_point::max()) && (clock_type::now() >= deadline);
+    };
+    auto next_wake = [&deadline] {
+        auto slice = clock_type::now() + std::chrono::milliseconds(wait_slice);
+        return (deadline < slice) ? deadline : slice;
+    };
+
+    std::unique_lock<std::mutex> guard {p->lock_};
+    while (p->free_.empty()) {
+        if (timed_out()) return {};
+        p->free_cv_.wait_until(guard, next_wake());
+    }
+    auto idx = p->free_.back();
+    p->free_.pop_back();
+    auto &slot = p->slots_[idx];
+    slot.busy_ = true;
+    slot.done_ = false;
+    rpc_head head {p->id_, idx, ++slot.seq_};
+    guard.unlock();
+
+    if (!chan_t::send(p->req_.handle(), &head, sizeof(head), data, size, default_timeout)) {
+        guard.lock();
+        p->release(idx);
+        return {};
+    }
+
+    guard.lock();
+    // Whoever finds nobody receiving becomes the receiver, and dispatches
+    // the replies of the other calls until its own reply shows up.
+    while (!slot.done_ && !timed_out()) {
+        if (p->receiving_) {
+            slot.cv_.wait_until(guard, next_wake());
+            continue;
+        }
+        p->receiving_ = true;
+        guard.unlock();
+        auto slice = std::chrono::duration_cast<std::chrono::milliseconds>(next_wake() - clock_type::now()).count();
+        auto buff  = p->rep_.recv(static_cast<std::uint64_t>((slice > 0) ? slice : 0));
+        guard.lock();
+        p->receiving_ = false;
+        if (!buff.empty()) p->dispatch(std::move(buff));
+    }
+    auto reply = std::move(slot.reply_);
+    p->release(idx);
+    p->hand_over();
+    return reply;
+}
+
+////////////////////////////////////////////////////////////////
+/// class rpc_server implementation
+////////////////////////////////////////////////////////////////
+
+class rpc_server::rpc_server_ : public ipc::pimpl<rpc_server_> {
+public:
+    struct client_t {
+        ipc::channel  rep_;
+        std::uint64_t used_;    // tick_ of the last reply, for the LRU eviction
+    };
+
+    std::string  name_;
+    ipc::channel req_;
+    // Reply channels by client, at most max_clients of them are kept open.
+    std::unordered_map<std::uint64_t, client_t> clients_;
+    std::uint64_t tick_ = 0;
+    std::atomic<std::uint64_t> dropped_ {0};
+    bool make_request(ipc::buff_t && buff, rpc_request & req) {
+        rpc_head head;
+        if (!head_of(buff, head)) {
+            ipc::error("fail rpc_server: bad request (size = %zd)\n", buff.size());
+            return false;
+        }
+        req.client_ = head.client_;
+        req.slot_   = head.slot_;
+        req.seq_    = head.seq_;
+        req.size_   = buff.size() - sizeof(rpc_head);
+        req.data_   = static_cast<ipc::byte_t const *>(buff.data()) + sizeof(rpc_head);
+        req.buff_   = std::move(buff);
+        return true;
+    }
+
+    /* Closes the reply channels of clients that have gone, then the least recently used ones. */
+    void evict() {
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            if (it->second.rep_.recv_count() == 0) it = clients_.erase(it);
+            else ++it;
+        }
+        while (clients_.size() >= rpc_server::max_clients) {
+            auto lru = clients_.begin();
+            for (auto it = clients_.begin(); it != clients_.end(); ++it) {
+                if (it->second.used_ < lru->second.used_) lru = it;
+            }
+            clients_.erase(lru);
+        }
+    }
+
+    ipc::channel *reply_chan(std::uint64_t client) {
+        auto it = clients_.find(client);
+        if (it != clients_.end()) {
+            it->second.used_ = ++tick_;
+            return &(it->second.rep_);
+        }
+        if (clients_.size() >= rpc_server::max_clients) evict();
+        ipc::channel rep;
+        if (!rep.connect(reply_name(name_.c_str(), client).c_str(), ipc::sender)) {
+            return nullptr;
+        }
+        return &(clients_.emplace(client, client_t{std::move(rep), ++tick_}).first->second.rep_);
+    }
+};
+
+rpc_server::rpc_server()
+    : p_(p_->make()) {
+}
+
+rpc_server::rpc_server(char const * name)
+    : rpc_server() {
+    connect(name);
+}
+
+rpc_server::~rpc_server() {
+    disconnect();
+    p_->clear();
+}
+
+bool rpc_server::valid() const noexcept {
+    return !impl(p_)->name_.empty();
+}
+
+bool rpc_server::connect(char const * name) {
+    disconnect();
+    if ((name == nullptr) || (name[0] == '\0')) {
+        ipc::error("fail rpc_server::connect: invalid name.\n");
+        return false;
+    }
+    auto p = impl(p_);
+    if (!p->req_.connect(name, ipc::receiver)) {
+        ipc::error("fail rpc_server::connect: %s\n", name);
+        return false;
+    }
+    // Requests are broadcast, a second server would execute and answer them all again.
+    if (p->req_.recv_count() > 1) {
+        ipc::error("fail rpc_server::connect: %s already has a server.\n", name);
+        p->req_.disconnect();
+        return false;
+    }
+    p->name_ = name;
+    return true;
+}
+
+void rpc_server::disconnect() noexcept {
+    auto p = impl(p_);
+    p->req_.disconnect();
+    p->clients_.clear();
+    p->name_.clear();
+}
+
+std::size_t rpc_server::recv(rpc_request * reqs, std::size_t count, std::uint64_t tm) {
+    if (!valid() || (reqs == nullptr) || (count == 0)) return 0;
+    auto p = impl(p_);
+    std::size_t n = 0;
+    for (auto buff = p->req_.recv(tm); !buff.empty(); buff = p->req_.try_recv()) {
+        if (p->make_request(std::move(buff), reqs[n]) && (++n == count)) break;
+    }
+    return n;
+}
+
+bool rpc_server::reply(rpc_request const & req, void const * data, std::size_t size) {
+    if (!valid()) return false;
+    auto p = impl(p_);
+    auto rep = p->reply_chan(req.client_);
+    if (rep == nullptr) return false;
+    rpc_head head {req.client_, req.slot_, req.seq_};
+    // Never waits on a client that does not drain its replies: that would hold up
+    // every other client, and force-pushing would cut the slow one off for good.
+    if (chan_t::try_send(rep->handle(), &head, sizeof(head), data, size, 0)) {
+        return true;
+    }
+    p->dropped_.fetch_add(1, std::memory_order_relaxed);
+    // the client is gone once nobody receives any more
+    if (rep->recv_count() == 0) p->clients_.erase(req.client_);
+    return false;
+}
+
+std::uint64_t rpc_server::dropped() const noexcept {
+    return impl(p_)->dropped_.load(std::memory_order_relaxed);
+}
+
+} // namespace ipc
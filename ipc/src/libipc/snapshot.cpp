@@ -0,0 +1,247 @@
+
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+#include "libipc/snapshot.h"
+#include "libipc/shm.h"
+#include "libipc/rw_lock.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/utility.h"
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include "libipc/platform/win/process.h"
+#else
+#include "libipc/platform/posix/process.h"
+#endif
+#if defined(IPC_OS_LINUX_)
+#include <time.h>
+#include "a0/err_macro.h"
+#include "a0/ftx.h"
+#endif
+
+namespace {
+
+/*
+ * In shm, every field is zero when the segment is freshly created,
+ * which is a valid "nothing published yet" state.
+ * seq_ is even when the value is stable, and odd while a writer is copying.
+ * writer_ is the pid of the process storing a value, 0 if none: writers
+ * take it before making seq_ odd, so a writer that died half-way is known,
+ * and the next writer takes over from it.
+*/
+struct head_t {
+    alignas(ipc::cache_line_size) std::atomic<std::uint32_t> seq_;
+    std::atomic<std::uint32_t> waiters_;
+    std::atomic<std::uint32_t> writer_;
+};
+
+/* True if the writer word names a process that is gone. */
+bool writer_dead(std::uint32_t wr) noexcept {
+    return (wr != 0) && (wr != ipc::detail::curr_pid()) && !ipc::detail::pid_alive(wr);
+}
+
+constexpr std::size_t data_offset() noexcept {
+    return ipc::make_align(ipc::cache_line_size, sizeof(head_t));
+}
+
+#if defined(IPC_OS_LINUX_)
+a0_ftx_t *ftx_of(std::atomic<std::uint32_t> &seq) noexcept {
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(a0_ftx_t), "Unexpected atomic size.");
+    return reinterpret_cast<a0_ftx_t *>(&seq);
+}
+
+// FUTEX_WAIT takes a relative timeout, so use the bitset variant,
+// which takes an absolute CLOCK_MONOTONIC deadline and survives EINTR retries.
+int ftx_wait_until(a0_ftx_t *ftx, std::uint32_t val, timespec const *deadline) noexcept {
+    return A0_SYSERR(a0_futex(ftx, FUTEX_WAIT_BITSET, static_cast<int>(val),
+                              reinterpret_cast<uintptr_t>(deadline), nullptr, FUTEX_BITSET_MATCH_ANY));
+}
+#endif
+
+} // internal-linkage
+
+namespace ipc {
+
+class latest_value::latest_value_ : public ipc::pimpl<latest_value_> {
+public:
+    ipc::shm::handle shm_;
+    std::size_t size_ = 0;
+
+    head_t *head() const noexcept {
+        return static_cast<head_t *>(shm_.get());
+    }
+
+    byte_t *data() const noexcept {
+        return static_cast<byte_t *>(shm_.get()) + data_offset();
+    }
+};
+
+latest_value::latest_value()
+    : p_(p_->make()) {
+}
+
+latest_value::latest_value(char const * name, std::size_t size)
+    : latest_value() {
+    open(name, size);
+}
+
+latest_value::~latest_value() {
+    close();
+    p_->clear();
+}
+
+bool latest_value::valid() const noexcept {
+    return impl(p_)->shm_.valid();
+}
+
+std::size_t latest_value::size() const noexcept {
+    return impl(p_)->size_;
+}
+
+bool latest_value::open(char const * name, std::size_t size) noexcept {
+    close();
+    if (name == nullptr || name[0] == '\0') {
+        ipc::error("fail latest_value open: name is empty\n");
+        return false;
+    }
+    if (size == 0) {
+        ipc::error("fail latest_value open: size is 0, name = %s\n", name);
+        return false;
+    }
+    if (!impl(p_)->shm_.acquire(name, data_offset() + size)) {
+        ipc::error("fail latest_value open: shm.acquire fails, name = %s\n", name);
+        return false;
+    }
+    impl(p_)->size_ = size;
+    return true;
+}
+
+void latest_value::close() noexcept {
+    impl(p_)->shm_.release();
+    impl(p_)->size_ = 0;
+}
+
+void latest_value::store(void const * data) noexcept {
+    if (!valid() || (data == nullptr)) return;
+    auto h   = impl(p_)->head();
+    auto pid = detail::curr_pid();
+    // Take the writer word, which excludes other writers,
+    // or take it over from a writer that died holding it.
+    for (unsigned k = 0;; ipc::yield(k)) {
+        std::uint32_t wr = 0;
+        if (h->writer_.compare_exchange_weak(wr, pid, std::memory_order_acquire, std::memory_order_relaxed)) break;
+        // Only look for a dead owner once spinning has given way to sleeping.
+        if ((k >= 32) && writer_dead(wr) && h->writer_.compare_exchange_strong(wr, pid, std::memory_order_acquire)) {
+            ipc::error("latest_value: writer (pid = %u) is dead, taken over, name = %s\n", wr, impl(p_)->shm_.name());
+            break;
+        }
+    }
+    // Make the sequence number odd; it already is if the writer taken over died copying.
+    auto seq = h->seq_.load(std::memory_order_relaxed) | 1u;
+    h->seq_.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(impl(p_)->data(), data, impl(p_)->size_);
+    // Version 0 is reserved for "never published".
+    auto next = seq + 1;
+    if (next == 0) next = 2;
+    h->seq_.store(next, std::memory_order_release);
+    h->writer_.store(0, std::memory_order_release);
+#if defined(IPC_OS_LINUX_)
+    // Pairs with the seq_cst increment of waiters_ in wait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (h->waiters_.load(std::memory_order_relaxed) > 0) {
+        int eno = A0_SYSERR(a0_ftx_broadcast(ftx_of(h->seq_)));
+        if (eno != 0) {
+            ipc::error("fail latest_value wake[%d]: name = %s\n", eno, impl(p_)->shm_.name());
+        }
+    }
+#endif
+}
+
+bool latest_value::load(void * out, std::uint32_t * ver) const noexcept {
+    if (!valid() || (out == nullptr)) return false;
+    auto h = impl(p_)->head();
+    for (unsigned k = 0;; ipc::yield(k)) {
+        auto seq = h->seq_.load(std::memory_order_acquire);
+        if (seq == 0) return false;
+        if (seq & 1) {
+            // A writer is copying: wait for it, unless it died half-way.
+            if ((k >= 32) && writer_dead(h->writer_.load(std::memory_order_relaxed)) &&
+                (h->seq_.load(std::memory_order_acquire) == seq)) {
+                return false;
+            }
+            continue;
+        }
+        std::memcpy(out, impl(p_)->data(), impl(p_)->size_);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (h->seq_.load(std::memory_order_relaxed) == seq) {
+            if (ver != nullptr) *ver = seq;
+            return true;
+        }
+    }
+}
+
+std::uint32_t latest_value::version() const noexcept {
+    if (!valid()) return 0;
+    auto seq = impl(p_)->head()->seq_.load(std::memory_order_acquire);
+    // A writer in progress has not published anything new yet.
+    return seq & ~1u;
+}
+
+bool latest_value::wait(std::uint32_t ver, std::uint64_t tm) const noexcept {
+    if (!valid()) return false;
+    auto h = impl(p_)->head();
+    auto changed = [h, ver] {
+        auto seq = h->seq_.load(std::memory_order_acquire);
+        return ((seq & 1) == 0) && (seq != ver);
+    };
+    // Spin a little first, the writer may be just a few instructions away.
+    for (unsigned k = 0; k < 16; ipc::yield(k)) {
+        if (changed()) return true;
+    }
+#if defined(IPC_OS_LINUX_)
+    timespec ts {};
+    if (tm != invalid_value) {
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        auto ns = static_cast<std::uint64_t>(ts.tv_nsec) + (tm % 1000) * 1000000ull;
+        ts.tv_sec  += static_cast<time_t>(tm / 1000 + ns / 1000000000ull);
+        ts.tv_nsec  = static_cast<long>(ns % 1000000000ull);
+    }
+    h->waiters_.fetch_add(1, std::memory_order_seq_cst);
+    bool ret = true;
+    for (;;) {
+        auto seq = h->seq_.load(std::memory_order_seq_cst);
+        if (((seq & 1) == 0) && (seq != ver)) break;
+        int eno = ftx_wait_until(ftx_of(h->seq_), seq, (tm == invalid_value) ? nullptr : &ts);
+        if (eno == ETIMEDOUT) {
+            ret = changed();
+            break;
+        }
+        if ((eno != 0) && (eno != EAGAIN) && (eno != EINTR)) {
+            ipc::error("fail latest_value wait[%d]: name = %s\n", eno, impl(p_)->shm_.name());
+            ret = false;
+            break;
+        }
+    }
+    h->waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return ret;
+#else
+    // No shared futex here, fall back to polling.
+    std::chrono::steady_clock::time_point deadline {};
+    if (tm != invalid_value) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(tm);
+    }
+    for (unsigned k = 0; !changed(); ipc::sleep(k)) {
+        if ((tm != invalid_value) && (std::chrono::steady_clock::now() >= deadline)) {
+            return changed();
+        }
+    }
+    return true;
+#endif
+}
+
+} // namespace ipc
@@ -0,0 +1,334 @@
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>   // std::hash
+
+#include "libipc/rw_mutex.h"
+#include "libipc/shm.h"
+#include "libipc/rw_lock.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/utility.h"
+#include "libipc/memory/resource.h"
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include "libipc/platform/win/process.h"
+#elif defined(IPC_OS_LINUX_) || defined(IPC_OS_QNX_)
+#include "libipc/platform/posix/process.h"
+#else/*IPC_OS*/
+#   error "Unsupported platform."
+#endif
+
+namespace {
+
+enum : std::size_t {
+    reader_slots = 64
+};
+
+enum class enter_result {
+    entered,
+    busy,   // a writer holds or waits for the lock, retry later
+    full    // every reader slot belongs to another live process
+};
+
+/*
+ * A reader slot packs the owner pid (high 32 bits) and the number of
+ * shared holders from that process (low 32 bits).
+ * Zero means the slot is free, so a fresh segment is a valid unlocked lock.
+*/
+struct slot_t {
+    alignas(ipc::cache_line_size) std::atomic<std::uint64_t> rc_;
+};
+
+struct rw_head_t {
+    alignas(ipc::cache_line_size) std::atomic<std::uint32_t> wr_; // pid of the writer, 0 if none
+    slot_t slots_[reader_slots];
+};
+
+constexpr std::uint32_t owner_of(std::uint64_t rc) noexcept {
+    return static_cast<std::uint32_t>(rc >> 32);
+}
+
+constexpr std::uint32_t count_of(std::uint64_t rc) noexcept {
+    return static_cast<std::uint32_t>(rc);
+}
+
+constexpr std::uint64_t make_rc(std::uint32_t pid, std::uint32_t count) noexcept {
+    return (static_cast<std::uint64_t>(pid) << 32) | count;
+}
+
+std::size_t &slot_hint() noexcept {
+    thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id()) % reader_slots;
+    return hint;
+}
+
+class deadline {
+    std::chrono::steady_clock::time_point tp_;
+    bool inf_;
+
+public:
+    explicit deadline(std::uint64_t tm) noexcept
+        : tp_ (std::chrono::steady_clock::now() + std::chrono::milliseconds(tm))
+        , inf_(tm == ipc::invalid_value) {}
+
+    bool expired() const noexcept {
+        return !inf_ && (std::chrono::steady_clock::now() >= tp_);
+    }
+};
+
+/**
+ * Spins/yields first, then sleeps, calling `check` before each sleep.
+ * Returns false if the deadline has passed.
+*/
+template <typename F>
+bool wait_step(unsigned &k, deadline const &dl, F &&check) {
+    bool ok = true;
+    ipc::sleep(k, [&] {
+        check();
+        if (dl.expired()) {
+            ok = false;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    return ok;
+}
+
+/// Clears the writer word if its owner process is gone.
+void recover_writer(rw_head_t *h) noexcept {
+    auto wr = h->wr_.load(std::memory_order_acquire);
+    if ((wr != 0) && (wr != ipc::detail::curr_pid()) && !ipc::detail::pid_alive(wr)) {
+        if (h->wr_.compare_exchange_strong(wr, 0, std::memory_order_acq_rel)) {
+            ipc::error("rw_mutex: writer (pid = %u) is dead, lock recovered\n", wr);
+        }
+    }
+}
+
+/// Returns the slot this process shares among its threads, or nullptr if none.
+std::atomic<std::uint64_t> *join_slot(rw_head_t *h, std::uint32_t pid, std::size_t idx, bool claim) noexcept {
+    auto &rc = h->slots_[idx].rc_;
+    auto cur = rc.load(std::memory_order_relaxed);
+    for (;;) {
+        std::uint64_t nxt;
+        if ((cur != 0) && (owner_of(cur) == pid)) {
+            nxt = cur + 1;
+        }
+        else if ((cur == 0) && claim) {
+            nxt = make_rc(pid, 1);
+        }
+        else return nullptr;
+        if (rc.compare_exchange_weak(cur, nxt, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return &rc;
+        }
+    }
+}
+
+std::atomic<std::uint64_t> *enter_slot(rw_head_t *h, std::uint32_t pid) noexcept {
+    auto &hint = slot_hint();
+    // Look for the slot this process already holds before claiming a free one,
+    // so its threads share a single slot however their hints are spread.
+    for (bool claim : {false, true}) {
+        for (std::size_t i = 0; i < reader_slots; ++i) {
+            auto idx = (hint + i) % reader_slots;
+            if (auto rc = join_slot(h, pid, idx, claim)) {
+                hint = idx;
+                return rc;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void leave_slot(std::atomic<std::uint64_t> &rc) noexcept {
+    auto cur = rc.load(std::memory_order_relaxed);
+    for (;;) {
+        auto nxt = (count_of(cur) <= 1) ? 0 : (cur - 1);
+        if (rc.compare_exchange_weak(cur, nxt, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+/// Any slot owned by this process may be released, counts are per process.
+bool leave_any_slot(rw_head_t *h, std::uint32_t pid) noexcept {
+    auto hint = slot_hint();
+    for (std::size_t i = 0; i < reader_slots; ++i) {
+        auto &rc = h->slots_[(hint + i) % reader_slots].rc_;
+        auto cur = rc.load(std::memory_order_relaxed);
+        if ((cur != 0) && (owner_of(cur) == pid)) {
+            leave_slot(rc);
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Returns true if the slot is free, reclaiming it when its owner is dead.
+bool slot_drained(std::atomic<std::uint64_t> &rc, bool check_owner) noexcept {
+    auto cur = rc.load(std::memory_order_seq_cst);
+    if (cur == 0) return true;
+    if (!check_owner || ipc::detail::pid_alive(owner_of(cur))) return false;
+    if (rc.compare_exchange_strong(cur, 0, std::memory_order_acq_rel)) {
+        ipc::error("rw_mutex: reader (pid = %u, count = %u) is dead, slot recovered\n",
+                    owner_of(cur), count_of(cur));
+    }
+    return rc.load(std::memory_order_acquire) == 0;
+}
+
+} // internal-linkage
+
+namespace ipc {
+namespace sync {
+
+class rw_mutex::rw_mutex_ : public ipc::pimpl<rw_mutex_> {
+public:
+    ipc::shm::handle shm_;
+
+    rw_head_t *head() const noexcept {
+        return static_cast<rw_head_t *>(shm_.get());
+    }
+
+    bool try_enter_writer(std::uint32_t pid) noexcept {
+        std::uint32_t expected = 0;
+        return head()->wr_.compare_exchange_strong(expected, pid, std::memory_order_seq_cst);
+    }
+
+    bool readers_drained(bool check_owner) noexcept {
+        for (auto &s : head()->slots_) {
+            if (!slot_drained(s.rc_, check_owner)) return false;
+        }
+        return true;
+    }
+
+    /// Frees the slot of every dead reader, unlike readers_drained it never stops early.
+    void reclaim_readers() noexcept {
+        for (auto &s : head()->slots_) {
+            slot_drained(s.rc_, true);
+        }
+    }
+
+    enter_result try_enter_reader(std::uint32_t pid) noexcept {
+        auto h = head();
+        if (h->wr_.load(std::memory_order_acquire) != 0) return enter_result::busy;
+        auto rc = enter_slot(h, pid);
+        if (rc == nullptr) {
+            // Slots of dead readers may be reused, only give up if none was freed.
+            reclaim_readers();
+            rc = enter_slot(h, pid);
+            if (rc == nullptr) return enter_result::full;
+        }
+        // The slot increment is seq_cst, so a writer either sees us,
+        // or we see its pid here and back off.
+        if (h->wr_.load(std::memory_order_seq_cst) != 0) {
+            leave_slot(*rc);
+            return enter_result::busy;
+        }
+        return enter_result::entered;
+    }
+};
+
+rw_mutex::rw_mutex()
+    : p_(p_->make()) {
+}
+
+rw_mutex::rw_mutex(char const * name)
+    : rw_mutex() {
+    open(name);
+}
+
+rw_mutex::~rw_mutex() {
+    close();
+    p_->clear();
+}
+
+bool rw_mutex::valid() const noexcept {
+    return impl(p_)->shm_.valid();
+}
+
+bool rw_mutex::open(char const *name) noexcept {
+    close();
+    if (!impl(p_)->shm_.acquire(name, sizeof(rw_head_t))) {
+        ipc::error("[rw_mutex::open] fail shm.acquire: %s\n", name);
+        return false;
+    }
+    return true;
+}
+
+void rw_mutex::close() noexcept {
+    impl(p_)->shm_.release();
+}
+
+bool rw_mutex::lock(std::uint64_t tm) noexcept {
+    if (!valid()) return false;
+    auto h   = impl(p_)->head();
+    auto pid = detail::curr_pid();
+    deadline dl {tm};
+    // Claim the writer word first, new readers back off from now on.
+    for (unsigned k = 0; !impl(p_)->try_enter_writer(pid);) {
+        if (!wait_step(k, dl, [h] { recover_writer(h); })) return false;
+    }
+    for (unsigned k = 0; !impl(p_)->readers_drained(k >= 32);) {
+        if (!wait_step(k, dl, [] {})) {
+            h->wr_.store(0, std::memory_order_release);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rw_mutex::try_lock() noexcept {
+    if (!valid()) return false;
+    if (!impl(p_)->try_enter_writer(detail::curr_pid())) return false;
+    if (impl(p_)->readers_drained(false)) return true;
+    impl(p_)->head()->wr_.store(0, std::memory_order_release);
+    return false;
+}
+
+bool rw_mutex::unlock() noexcept {
+    if (!valid()) return false;
+    auto pid = detail::curr_pid();
+    if (!impl(p_)->head()->wr_.compare_exchange_strong(pid, 0, std::memory_order_release)) {
+        ipc::error("fail rw_mutex unlock: not locked by this process (owner = %u)\n", pid);
+        return false;
+    }
+    return true;
+}
+
+bool rw_mutex::lock_shared(std::uint64_t tm) noexcept {
+    if (!valid()) return false;
+    auto h   = impl(p_)->head();
+    auto pid = detail::curr_pid();
+    deadline dl {tm};
+    for (unsigned k = 0;;) {
+        switch (impl(p_)->try_enter_reader(pid)) {
+        case enter_result::entered:
+            return true;
+        case enter_result::full:
+            ipc::error("fail rw_mutex lock_shared: all %zd reader slots are owned by other processes\n",
+                       static_cast<std::size_t>(reader_slots));
+            return false;
+        default:
+            if (!wait_step(k, dl, [h] { recover_writer(h); })) return false;
+            break;
+        }
+    }
+}
+
+bool rw_mutex::try_lock_shared() noexcept {
+    if (!valid()) return false;
+    return impl(p_)->try_enter_reader(detail::curr_pid()) == enter_result::entered;
+}
+
+bool rw_mutex::unlock_shared() noexcept {
+    if (!valid()) return false;
+    if (!leave_any_slot(impl(p_)->head(), detail::curr_pid())) {
+        ipc::error("fail rw_mutex unlock_shared: no shared lock held by this process\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace sync
+} // namespace ipc
@@ -6,7 +6,9 @@
 #include "libipc/platform/detail.h"
 #if defined(IPC_OS_WINDOWS_)
 #include "libipc/platform/win/semaphore.h"
-#elif defined(IPC_OS_LINUX_) || defined(IPC_OS_QNX_)
+#elif defined(IPC_OS_LINUX_)
+#include "libipc/platform/linux/semaphore_impl.h"
+#elif defined(IPC_OS_QNX_)
 #include "libipc/platform/posix/semaphore_impl.h"
 #else/*IPC_OS*/
 #   error "Unsupported platform."
@@ -0,0 +1,157 @@
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>      // std::atexit, std::at_quick_exit, std::getenv
+#include <functional>   // std::hash
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "libipc/trace.h"
+#include "libipc/shm.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include "libipc/platform/win/process.h"
+#elif defined(IPC_OS_LINUX_) || defined(IPC_OS_QNX_)
+#include "libipc/platform/posix/process.h"
+#else/*IPC_OS*/
+#   error "Unsupported platform."
+#endif
+
+namespace {
+
+using namespace ipc::trace;
+
+enum : std::uint32_t {
+    prints_per_second = 8
+};
+
+char          ring_name[64];
+std::uint32_t ring_owner = 0; // pid the ring named above belongs to
+
+void remove_ring() {
+    // A forked child inherits this handler, it must not remove its parent's ring.
+    if (ring_owner == ipc::detail::curr_pid()) {
+        ipc::shm::remove(ring_name);
+    }
+}
+
+ring *open_ring(std::uint32_t pid) noexcept {
+    std::snprintf(ring_name, sizeof(ring_name), "%s%u", ring_prefix, pid);
+    ring_owner = pid;
+    // Never released: events may still be emitted while other statics are destroyed.
+    // A forked child leaks its parent's handle too, releasing it would drop the parent's ref count.
+    auto h = new ipc::shm::handle;
+    if (!h->acquire(ring_name, sizeof(ring))) {
+        ipc::error("fail: trace ring acquire: %s\n", ring_name);
+        return nullptr;
+    }
+    // Keep the ring after exit for post-mortem decoding only when asked to.
+    static bool registered = false;
+    if (!registered && (std::getenv("LIBIPC_TRACE_KEEP") == nullptr)) {
+        registered = true;
+        std::atexit(remove_ring);
+        std::at_quick_exit(remove_ring);
+    }
+    return static_cast<ring *>(h->get());
+}
+
+/// The ring of the calling process, reopened after fork so a child never writes into its parent's ring.
+ring *ring_of() noexcept {
+    static std::atomic<std::uint32_t> cached_pid {0};
+    static ring *cached = nullptr;
+    auto pid = ipc::detail::curr_pid();
+    if (cached_pid.load(std::memory_order_acquire) == pid) {
+        return cached;
+    }
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard {lock};
+    if (cached_pid.load(std::memory_order_relaxed) != pid) {
+        cached = open_ring(pid);
+        cached_pid.store(pid, std::memory_order_release);
+    }
+    return cached;
+}
+
+std::uint32_t curr_tid() noexcept {
+    thread_local std::uint32_t tid = static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return tid;
+}
+
+std::uint64_t now_ns() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void write(event ev, std::uint64_t ts, std::uint64_t const (&args)[args_max]) noexcept {
+    auto r = ring_of();
+    if (r == nullptr) return;
+    auto idx = r->cursor_.fetch_add(1, std::memory_order_relaxed);
+    auto &rec = r->records_[idx & (record_count - 1)];
+    rec.seq_.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec.ts_    = ts;
+    rec.event_ = static_cast<std::uint32_t>(ev);
+    rec.tid_   = curr_tid();
+    for (std::size_t i = 0; i < args_max; ++i) rec.args_[i] = args[i];
+    rec.seq_.store(idx + 1, std::memory_order_release);
+}
+
+/// Per event id: at most prints_per_second lines, the rest are counted.
+struct limiter {
+    std::atomic<std::uint64_t> window_ {0};
+    std::atomic<std::uint32_t> printed_{0};
+    std::atomic<std::uint32_t> dropped_{0};
+
+    bool allow(std::uint64_t ts, std::uint32_t &dropped) noexcept {
+        auto sec = ts / 1000000000ull;
+        auto win = window_.load(std::memory_order_relaxed);
+        dropped = 0;
+        if ((win != sec) && window_.compare_exchange_strong(win, sec, std::memory_order_relaxed)) {
+            printed_.store(0, std::memory_order_relaxed);
+            dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        }
+        if (printed_.fetch_add(1, std::memory_order_relaxed) < prints_per_second) {
+            return true;
+        }
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+limiter limiters[static_cast<std::size_t>(event::count)];
+
+} // internal-linkage
+
+namespace ipc {
+namespace trace {
+
+void emit(event ev, std::uint64_t a0, std::uint64_t a1, std::uint64_t a2, std::uint64_t a3) noexcept {
+    write(ev, now_ns(), {a0, a1, a2, a3});
+}
+
+void report(event ev, std::uint64_t a0, std::uint64_t a1, std::uint64_t a2, std::uint64_t a3) noexcept {
+    auto ts = now_ns();
+    write(ev, ts, {a0, a1, a2, a3});
+    auto i = static_cast<std::size_t>(ev);
+    if (i >= static_cast<std::size_t>(event::count)) return;
+    std::uint32_t dropped = 0;
+    if (!limiters[i].allow(ts, dropped)) return;
+    auto const &inf = info_of(ev);
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), inf.fmt, a0, a1, a2, a3);
+    if (inf.lev == level::error) {
+        if (dropped == 0) ipc::error("%s\n", buf);
+        else              ipc::error("%s (%u similar messages suppressed)\n", buf, dropped);
+    }
+    else {
+        if (dropped == 0) ipc::log("%s\n", buf);
+        else              ipc::log("%s (%u similar messages suppressed)\n", buf, dropped);
+    }
+}
+
+} // namespace trace
+} // namespace ipc
@@ -73,6 +73,16 @@ public:
         return cursor_ == max_count;
     }
 
+    /**
+     * Walks the free list, at most max_count steps,
+     * so it also ends when read without the lock while the pool changes.
+    */
+    std::size_t free_count() const noexcept {
+        std::size_t n = 0;
+        for (std::size_t id = cursor_; (id < max_count) && (n < max_count); id = next_[id]) ++n;
+        return n;
+    }
+
     storage_id_t acquire() {
         if (empty()) return -1;
         storage_id_t id = cursor_;
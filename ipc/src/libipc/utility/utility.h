@@ -5,6 +5,7 @@
 #include <new>          // std::hardware_destructive_interference_size
 #include <type_traits>  // std::is_trivially_copyable
 
+#include "libipc/def.h"
 #include "libipc/platform/detail.h"
 
 namespace ipc {
@@ -35,15 +36,6 @@ IPC_CONSTEXPR_ void static_for(F&& f) {
     static_for(std::make_index_sequence<N>{}, std::forward<F>(f));
 }
 
-// Minimum offset between two objects to avoid false sharing.
-enum {
-// #if __cplusplus >= 201703L
-//     cache_line_size = std::hardware_destructive_interference_size
-// #else /*__cplusplus < 201703L*/
-    cache_line_size = 64
-// #endif/*__cplusplus < 201703L*/
-};
-
 template <typename T, typename U>
 auto horrible_cast(U rhs) noexcept
     -> typename std::enable_if<std::is_trivially_copyable<T>::value
@@ -56,9 +48,4 @@ auto horrible_cast(U rhs) noexcept
     return r.t;
 }
 
-IPC_CONSTEXPR_ std::size_t make_align(std::size_t align, std::size_t size) {
-    // align must be 2^n
-    return (size + align - 1) & ~(align - 1);
-}
-
 } // namespace ipc
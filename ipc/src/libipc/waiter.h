@@ -4,19 +4,44 @@
 #include <string>
 #include <mutex>
 #include <atomic>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <condition_variable>
 
 #include "libipc/def.h"
 #include "libipc/mutex.h"
 #include "libipc/condition.h"
+#include "libipc/shm.h"
 #include "libipc/platform/detail.h"
 
 namespace ipc {
 namespace detail {
 
 class waiter {
-    ipc::sync::condition cond_;
-    ipc::sync::mutex     lock_;
-    std::atomic<bool>    quit_ {false};
+    /*
+     * For process-local names (see ipc::shm::local_prefix) the waiter skips the
+     * robust shm mutex & condition, and shares a plain std pair by name instead.
+    */
+    struct local_t {
+        std::mutex              lock_;
+        std::condition_variable cond_;
+
+        static std::shared_ptr<local_t> open(std::string const &name) {
+            static std::mutex lock;
+            static std::unordered_map<std::string, std::weak_ptr<local_t>> locals;
+            IPC_UNUSED_ std::lock_guard<std::mutex> guard {lock};
+            auto &wp = locals[name];
+            auto sp = wp.lock();
+            if (!sp) wp = sp = std::make_shared<local_t>();
+            return sp;
+        }
+    };
+
+    ipc::sync::condition     cond_;
+    ipc::sync::mutex         lock_;
+    std::shared_ptr<local_t> local_;
+    std::atomic<bool>        quit_ {false};
 
 public:
     waiter() = default;
@@ -29,11 +54,15 @@ public:
     }
 
     bool valid() const noexcept {
-        return cond_.valid() && lock_.valid();
+        return local_ || (cond_.valid() && lock_.valid());
     }
 
     bool open(char const *name) noexcept {
         quit_.store(false, std::memory_order_relaxed);
+        if (ipc::shm::is_local(name)) {
+            local_ = local_t::open(name);
+            return valid();
+        }
         if (!cond_.open((std::string{"_waiter_cond_"} + name).c_str())) {
             return false;
         }
@@ -45,12 +74,25 @@ public:
     }
 
     void close() noexcept {
+        local_.reset();
         cond_.close();
         lock_.close();
     }
 
     template <typename F>
     bool wait_if(F &&pred, std::uint64_t tm = ipc::invalid_value) noexcept {
+        if (local_) {
+            std::unique_lock<std::mutex> guard {local_->lock_};
+            while (!quit_.load(std::memory_order_relaxed) && std::forward<F>(pred)()) {
+                if (tm == ipc::invalid_value) {
+                    local_->cond_.wait(guard);
+                }
+                else if (local_->cond_.wait_for(guard, std::chrono::milliseconds(tm)) == std::cv_status::timeout) {
+                    return false;
+                }
+            }
+            return true;
+        }
         IPC_UNUSED_ std::lock_guard<ipc::sync::mutex> guard {lock_};
         while ([this, &pred] {
                     return !quit_.load(std::memory_order_relaxed)
@@ -62,11 +104,21 @@ public:
     }
 
     bool notify() noexcept {
+        if (local_) {
+            std::lock_guard<std::mutex>{local_->lock_}; // barrier
+            local_->cond_.notify_one();
+            return true;
+        }
         std::lock_guard<ipc::sync::mutex>{lock_}; // barrier
         return cond_.notify(lock_);
     }
 
     bool broadcast() noexcept {
+        if (local_) {
+            std::lock_guard<std::mutex>{local_->lock_}; // barrier
+            local_->cond_.notify_all();
+            return true;
+        }
         std::lock_guard<ipc::sync::mutex>{lock_}; // barrier
         return cond_.broadcast(lock_);
     }
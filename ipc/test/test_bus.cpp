@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/bus.h"
+
+#include "test.h"
+
+namespace {
+
+std::string recv_str(ipc::bus & b, ipc::topic_t * topic = nullptr) {
+    auto buf = b.recv(100, topic);
+    return buf.empty() ? std::string{} : std::string{buf.get<char const *>()};
+}
+
+TEST(Bus, topics) {
+    ipc::bus pub {"test-bus-topics", ipc::sender};
+    ipc::bus sub {"test-bus-topics", ipc::receiver};
+    ASSERT_TRUE(pub.valid());
+    ASSERT_TRUE(sub.valid());
+
+    EXPECT_EQ(pub.topic(""), 0);
+    EXPECT_EQ(pub.topic("a/+"), 0);
+    EXPECT_EQ(pub.topic(std::string(ipc::bus::max_topic_name + 1, 'x').c_str()), 0);
+
+    auto temp = pub.topic("sensors/left/temp");
+    ASSERT_NE(temp, 0);
+    EXPECT_EQ(sub.topic("sensors/left/temp"), temp); // the same directory
+    EXPECT_STREQ(sub.topic_name(temp), "sensors/left/temp");
+
+    // nothing subscribed yet
+    ASSERT_TRUE(pub.publish(temp, std::string{"20"}.c_str(), 3));
+    EXPECT_TRUE(sub.try_recv().empty());
+
+    ASSERT_TRUE(sub.subscribe("sensors/left/temp"));
+    ASSERT_TRUE(pub.publish("sensors/left/temp", std::string{"21"}));
+    ASSERT_TRUE(pub.publish("sensors/left/rh",   std::string{"40"}));
+    ipc::topic_t topic = 0;
+    EXPECT_EQ(recv_str(sub, &topic), "21");
+    EXPECT_EQ(topic, temp);
+    EXPECT_TRUE(sub.try_recv().empty());
+
+    sub.unsubscribe("sensors/left/temp");
+    ASSERT_TRUE(pub.publish("sensors/left/temp", std::string{"22"}));
+    EXPECT_TRUE(sub.try_recv().empty());
+}
+
+TEST(Bus, wildcards) {
+    ipc::bus pub {"test-bus-wildcards", ipc::sender};
+    ipc::bus sub {"test-bus-wildcards", ipc::receiver};
+    ASSERT_NE(pub.topic("a/x/temp"), 0);    // known before subscribing
+    ASSERT_TRUE(sub.subscribe("a/+/temp"));
+    ASSERT_TRUE(sub.subscribe("b/#"));
+
+    // known and new topics alike
+    ASSERT_TRUE(pub.publish("a/x/temp", std::string{"1"}));
+    ASSERT_TRUE(pub.publish("a/y/temp", std::string{"2"}));
+    ASSERT_TRUE(pub.publish("a/y/rh",   std::string{"no"}));
+    ASSERT_TRUE(pub.publish("a/y/z/temp", std::string{"no"}));
+    ASSERT_TRUE(pub.publish("b/1/2/3",  std::string{"3"}));
+    ASSERT_TRUE(pub.publish("c",        std::string{"no"}));
+    ipc::topic_t topic = 0;
+    EXPECT_EQ(recv_str(sub), "1");
+    EXPECT_EQ(recv_str(sub, &topic), "2");
+    EXPECT_STREQ(sub.topic_name(topic), "a/y/temp");
+    EXPECT_EQ(recv_str(sub), "3");
+    EXPECT_TRUE(sub.try_recv().empty());
+
+    sub.unsubscribe("a/+/temp");
+    ASSERT_TRUE(pub.publish("a/x/temp", std::string{"no"}));
+    ASSERT_TRUE(pub.publish("b/4",      std::string{"4"}));
+    EXPECT_EQ(recv_str(sub), "4");
+    EXPECT_TRUE(sub.try_recv().empty());
+}
+
+TEST(Bus, many_topics) {
+    constexpr int Topics = 1000;
+    ipc::bus pub {"test-bus-many", ipc::sender};
+    std::vector<ipc::bus> subs(4);
+    for (std::size_t i = 0; i < subs.size(); ++i) {
+        ASSERT_TRUE(subs[i].connect("test-bus-many", ipc::receiver));
+        // each one takes every 4th topic
+        for (int t = static_cast<int>(i); t < Topics; t += static_cast<int>(subs.size())) {
+            ASSERT_TRUE(subs[i].subscribe(("topic/" + std::to_string(t)).c_str()));
+        }
+    }
+    std::vector<std::thread> readers;
+    std::vector<int> counts(subs.size());
+    for (std::size_t i = 0; i < subs.size(); ++i) {
+        readers.emplace_back([&, i] {
+            // Topics of different rings are not ordered: no "quit" topic, count instead.
+            while (counts[i] < Topics / 4) {
+                ipc::topic_t topic = 0;
+                auto buf = subs[i].recv(1000, &topic);
+                if (buf.empty()) break;
+                auto name = std::string{subs[i].topic_name(topic)};
+                EXPECT_EQ(std::stoi(name.substr(6)) % 4, static_cast<int>(i));
+                ++counts[i];
+            }
+        });
+    }
+    for (int t = 0; t < Topics; ++t) {
+        ASSERT_TRUE(pub.publish(("topic/" + std::to_string(t)).c_str(), std::to_string(t)));
+    }
+    for (auto & r : readers) r.join();
+    for (auto & s : subs) EXPECT_TRUE(s.try_recv().empty());
+    for (auto n : counts) EXPECT_EQ(n, Topics / 4);
+}
+
+TEST(Bus, rings) {
+    ipc::bus pub {"test-bus-rings", ipc::sender, 4};
+    ipc::bus slow {"test-bus-rings", ipc::receiver, 2};
+    ipc::bus fast {"test-bus-rings", ipc::receiver};
+    ASSERT_EQ(pub.rings(), 4u);
+    EXPECT_EQ(slow.rings(), 4u);   // the first one has set it
+    EXPECT_FALSE(ipc::bus{}.connect("test-bus-rings-0", ipc::sender, 0));
+
+    auto a = pub.topic("rings/a"), b = pub.topic("rings/b");
+    ASSERT_NE((a - 1) % 4, (b - 1) % 4);
+    ASSERT_TRUE(slow.subscribe("rings/a"));
+    ASSERT_TRUE(fast.subscribe("rings/b"));
+
+    // The slow receiver never reads: it only holds back the ring of rings/a.
+    constexpr int Count = 1000;
+    int got = 0;
+    std::thread reader {[&] {
+        for (; got < Count; ++got) {
+            if (fast.recv(1000).empty()) break;
+        }
+    }};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Count; ++i) {
+        ASSERT_TRUE(pub.publish(b, &i, sizeof(i)));
+    }
+    reader.join();
+    EXPECT_EQ(got, Count);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(Bus, wildcard_rings) {
+    ipc::bus pub {"test-bus-wildcard-rings", ipc::sender};
+    ipc::bus sub {"test-bus-wildcard-rings", ipc::receiver};
+    ASSERT_TRUE(sub.subscribe("w/#"));
+    std::vector<std::string> got;
+    std::thread reader {[&] {
+        while (got.size() < 8) {
+            ipc::topic_t topic = 0;
+            auto buf = sub.recv(ipc::invalid_value, &topic); // sleeps on the bell
+            ASSERT_FALSE(buf.empty());
+            got.emplace_back(sub.topic_name(topic));
+        }
+    }};
+    for (int i = 0; i < 8; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto name = "w/" + std::to_string(i);
+        ASSERT_TRUE(pub.publish(name.c_str(), name));
+    }
+    reader.join();
+    ASSERT_EQ(got.size(), 8u);
+    std::sort(got.begin(), got.end()); // not ordered across rings
+    for (int i = 0; i < 8; ++i) EXPECT_EQ(got[i], "w/" + std::to_string(i));
+}
+
+} // internal-linkage
@@ -0,0 +1,198 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/gateway.h"
+#include "libipc/ipc.h"
+#include "libipc/platform/detail.h"
+
+#include "test.h"
+
+#if !defined(IPC_OS_WINDOWS_)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int Count = 20000;
+
+/* A message of a size between 1 and ~100KB, filled from its index. */
+std::vector<std::uint8_t> make_message(int i) {
+    std::size_t size = (i % 100 == 0) ? (100 * 1024 + i % 7) : (1 + (i * 37) % 300);
+    std::vector<std::uint8_t> msg(size);
+    for (std::size_t k = 0; k < size; ++k) msg[k] = static_cast<std::uint8_t>(i + k);
+    return msg;
+}
+
+/*
+ * route "src" -> gateway_out -> socket -> gateway_in -> route "dst".
+ * slow_every: the final receiver sleeps 1ms every slow_every messages.
+*/
+void test_bridge(char const * endpoint, char const * src, char const * dst, int slow_every = 0) {
+    ipc::route_gateway_in gw_in {endpoint, dst};
+    ASSERT_TRUE(gw_in.valid());
+    ipc::route_gateway_out gw_out {src, gw_in.endpoint().c_str()};
+    ASSERT_TRUE(gw_out.valid());
+
+    ipc::route receiver {dst, ipc::receiver};
+    ipc::route sender   {src, ipc::sender};
+
+    std::thread t_in  {[&gw_in ] { gw_in .run(); }};
+    std::thread t_out {[&gw_out] { gw_out.run(); }};
+
+    int fails = 0;
+    std::thread t_recv {[&] {
+        for (int i = 0; i < Count; ++i) {
+            auto buf = receiver.recv(5000);
+            auto msg = make_message(i);
+            if ((buf.size() != msg.size()) || (std::memcmp(buf.data(), msg.data(), msg.size()) != 0)) {
+                ++fails;
+                if (buf.empty()) break;
+            }
+            if ((slow_every != 0) && (i % slow_every == 0)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }};
+
+    ipc_ut::test_stopwatch sw;
+    sw.start();
+    for (int i = 0; i < Count; ++i) {
+        auto msg = make_message(i);
+        // retried by hand: a timed out send must not drop messages in this test
+        while (!sender.try_send(msg.data(), msg.size(), 1000)) ;
+    }
+    t_recv.join();
+    sw.print_elapsed(1, Count, endpoint);
+    EXPECT_EQ(fails, 0);
+
+    gw_out.stop();
+    gw_in .stop();
+    t_out.join();
+    t_in .join();
+}
+
+TEST(Gateway, unix_socket) {
+    test_bridge("unix:///tmp/test-ipc-gateway.sock", "test-gw-unix-src", "test-gw-unix-dst");
+}
+
+TEST(Gateway, tcp_loopback) {
+    test_bridge("tcp://127.0.0.1:0", "test-gw-tcp-src", "test-gw-tcp-dst");
+}
+
+TEST(Gateway, backpressure) {
+    test_bridge("tcp://127.0.0.1:0", "test-gw-bp-src", "test-gw-bp-dst", 200);
+}
+
+/* Connects a raw unix socket to path and writes a frame announcing size bytes, with no payload. */
+int send_bad_frame(char const * path, std::uint32_t size) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    std::uint8_t head[4] = {std::uint8_t(size), std::uint8_t(size >> 8), std::uint8_t(size >> 16), std::uint8_t(size >> 24)};
+    if ((::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) ||
+        (::write(fd, head, sizeof(head)) != sizeof(head))) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+TEST(Gateway, bad_frames) {
+    ipc::route_gateway_in gw_in {"unix:///tmp/test-ipc-gateway-bad.sock", "test-gw-bad-dst", 1024};
+    ASSERT_TRUE(gw_in.valid());
+    ipc::route receiver {"test-gw-bad-dst", ipc::receiver};
+
+    for (std::uint32_t size : {0u, 1025u, 0xffffffffu}) {
+        int fd = send_bad_frame("/tmp/test-ipc-gateway-bad.sock", size);
+        ASSERT_GE(fd, 0);
+        gw_in.pump(1000); // accepts
+        EXPECT_EQ(gw_in.pump(1000), 0u);
+        // The gateway hung up on the peer, and still listens.
+        char c;
+        EXPECT_EQ(::read(fd, &c, 1), 0) << "size " << size;
+        ::close(fd);
+        EXPECT_TRUE(gw_in.valid());
+    }
+    EXPECT_TRUE(receiver.try_recv().empty());
+}
+
+TEST(Gateway, unix_path_in_use) {
+    char const * path = "/tmp/test-ipc-gateway-busy.sock";
+    auto first = std::make_unique<ipc::route_gateway_in>("unix:///tmp/test-ipc-gateway-busy.sock", "test-gw-busy-dst");
+    ASSERT_TRUE(first->valid());
+    // A running gateway keeps its path.
+    ipc::route_gateway_in second {"unix:///tmp/test-ipc-gateway-busy.sock", "test-gw-busy-dst2"};
+    EXPECT_FALSE(second.valid());
+    int fd = send_bad_frame(path, 1);
+    EXPECT_GE(fd, 0);
+    if (fd >= 0) ::close(fd);
+    // The socket file it leaves behind is stale, and taken over.
+    first.reset();
+    EXPECT_TRUE(second.open("unix:///tmp/test-ipc-gateway-busy.sock", "test-gw-busy-dst2"));
+}
+
+TEST(Gateway, no_receiver) {
+    char const * path = "/tmp/test-ipc-gateway-late.sock";
+    ipc::route_gateway_in gw_in {"unix:///tmp/test-ipc-gateway-late.sock", "test-gw-late-dst"};
+    ASSERT_TRUE(gw_in.valid());
+    int fd = send_bad_frame(path, 3);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, "abc", 3), 3);
+    gw_in.pump(1000); // accepts
+    // Nobody receives yet: the message is kept, not dropped.
+    EXPECT_EQ(gw_in.pump(1000), 0u);
+    ipc::route receiver {"test-gw-late-dst", ipc::receiver};
+    EXPECT_EQ(gw_in.pump(1000), 1u);
+    auto buf = receiver.recv(1000);
+    ASSERT_EQ(buf.size(), 3u);
+    EXPECT_EQ(std::memcmp(buf.data(), "abc", 3), 0);
+    ::close(fd);
+}
+
+TEST(Gateway, stop_stalled_peer) {
+    // A peer that accepts the connection but never reads.
+    char const * path = "/tmp/test-ipc-gateway-stall.sock";
+    ::unlink(path);
+    int lfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(lfd, 0);
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(::bind(lfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(lfd, 1), 0);
+
+    ipc::route_gateway_out gw_out {"test-gw-stall-src", "unix:///tmp/test-ipc-gateway-stall.sock"};
+    ASSERT_TRUE(gw_out.valid());
+    ipc::route sender {"test-gw-stall-src", ipc::sender};
+    std::atomic<bool> done {false};
+    std::thread t_out {[&] {
+        gw_out.run();
+        done.store(true);
+    }};
+    // Far more than the socket buffers hold.
+    std::vector<std::uint8_t> msg(64 * 1024, 0x5a);
+    for (int i = 0; i < 256; ++i) {
+        if (!sender.try_send(msg.data(), msg.size(), 10)) break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(done.load());
+    auto t0 = std::chrono::steady_clock::now();
+    gw_out.stop();
+    t_out.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(1));
+    EXPECT_FALSE(gw_out.valid());
+    ::close(lfd);
+    ::unlink(path);
+}
+
+} // internal-linkage
+#endif
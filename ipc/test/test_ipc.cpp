@@ -4,6 +4,8 @@
 #include <mutex>
 #include <atomic>
 #include <cstring>
+#include <chrono>
+#include <thread>
 
 #include "libipc/ipc.h"
 #include "libipc/buffer.h"
@@ -183,3 +185,195 @@ TEST(IPC, NvN) {
     //test_sr<relat::multi , relat::multi , trans::unicast  >("mmu", MultiMax, MultiMax);
     test_sr<relat::multi , relat::multi , trans::broadcast>("mmb", MultiMax, MultiMax);
 }
+
+/*
+ * The same tests on process-local channels (see ipc::shm::local_prefix).
+*/
+
+TEST(IPC, local_basic) {
+    test_basic<relat::single, relat::single, trans::unicast  >("inproc://ssu");
+    test_basic<relat::single, relat::multi , trans::broadcast>("inproc://smb");
+    test_basic<relat::multi , relat::multi , trans::broadcast>("inproc://mmb");
+}
+
+TEST(IPC, local_1v1) {
+    test_sr<relat::single, relat::single, trans::unicast  >("inproc://ssu", 1, 1);
+    test_sr<relat::single, relat::multi , trans::broadcast>("inproc://smb", 1, 1);
+    test_sr<relat::multi , relat::multi , trans::broadcast>("inproc://mmb", 1, 1);
+}
+
+TEST(IPC, local_1vN) {
+    test_sr<relat::single, relat::multi , trans::broadcast>("inproc://smb", 1, MultiMax);
+    test_sr<relat::multi , relat::multi , trans::broadcast>("inproc://mmb", 1, MultiMax);
+}
+
+TEST(IPC, local_Nv1) {
+    test_sr<relat::multi , relat::multi , trans::broadcast>("inproc://mmb", MultiMax, 1);
+}
+
+TEST(IPC, local_NvN) {
+    test_sr<relat::multi , relat::multi , trans::broadcast>("inproc://mmb", MultiMax, MultiMax);
+}
+
+TEST(IPC, local_connect) {
+    constexpr int loops = 1000;
+    for (auto name : {"connect", "inproc://connect"}) {
+        ipc_ut::test_stopwatch sw;
+        sw.start();
+        for (int i = 0; i < loops; ++i) {
+            ipc::channel que {name, ipc::receiver};
+            ASSERT_TRUE(que.valid());
+        }
+        sw.print_elapsed<std::chrono::microseconds>(1, loops, name);
+    }
+}
+
+TEST(IPC, topics) {
+    ipc::channel all {"topics", ipc::receiver};
+    ipc::channel one {"topics", ipc::receiver};
+    ipc::channel two {"topics", ipc::receiver};
+    one.subscribe(1);
+    two.subscribe(2);
+    two.subscribe(0);
+
+    ipc::channel snd {"topics", ipc::sender};
+    std::string large(ipc::large_msg_limit * 4, 'L');
+    ASSERT_TRUE(snd.send(1, std::string{"one"}));
+    ASSERT_TRUE(snd.send(2, std::string{"two"}));
+    ASSERT_TRUE(snd.send(std::string{"none"}));
+    ASSERT_TRUE(snd.send(1, large));
+
+    auto recv_str = [](ipc::channel & ch) {
+        auto buf = ch.recv(100);
+        return buf.empty() ? std::string{} : std::string{buf.get<char const *>()};
+    };
+    EXPECT_EQ(recv_str(all), "one");
+    EXPECT_EQ(recv_str(all), "two");
+    EXPECT_EQ(recv_str(all), "none");
+    EXPECT_EQ(recv_str(all), large);
+
+    EXPECT_EQ(recv_str(one), "one");
+    EXPECT_EQ(recv_str(one), large);
+    EXPECT_TRUE(one.try_recv().empty());
+
+    EXPECT_EQ(recv_str(two), "two");
+    EXPECT_EQ(recv_str(two), "none");
+    EXPECT_TRUE(two.try_recv().empty());
+
+    two.unsubscribe_all();
+    ASSERT_TRUE(snd.send(3, std::string{"three"}));
+    EXPECT_EQ(recv_str(two), "three");
+}
+
+TEST(IPC, topics_unicast) {
+    // Subscribing is refused: a skipped message would be gone for every receiver.
+    using chan_t = ipc::chan<relat::single, relat::single, trans::unicast>;
+    chan_t rcv {"topics-unicast", ipc::receiver};
+    chan_t snd {"topics-unicast", ipc::sender};
+    rcv.subscribe(1);
+    ASSERT_TRUE(snd.send(2, std::string{"two"}));
+    ASSERT_TRUE(snd.send(1, std::string{"one"}));
+
+    auto recv_str = [](chan_t & ch) {
+        auto buf = ch.recv(100);
+        return buf.empty() ? std::string{} : std::string{buf.get<char const *>()};
+    };
+    EXPECT_EQ(recv_str(rcv), "two");
+    EXPECT_EQ(recv_str(rcv), "one");
+}
+
+TEST(IPC, skip_self) {
+    ipc::channel peer {"skip-self", ipc::receiver};
+    ipc::channel self {"skip-self", ipc::sender | ipc::receiver};
+    std::string large(ipc::large_msg_limit * 4, 'L');
+    // more rounds than the queue has slots, so that self must keep skipping
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(self.send(std::to_string(i)));
+        ASSERT_TRUE(self.send(large));
+        auto buf = peer.recv(100);
+        ASSERT_STREQ(buf.get<char const *>(), std::to_string(i).c_str());
+        buf = peer.recv(100);
+        ASSERT_EQ(buf.size(), large.size() + 1);
+        ASSERT_TRUE(self.try_recv().empty());
+    }
+    ipc::channel other {"skip-self", ipc::sender};
+    ASSERT_TRUE(other.send(std::string{"other"}));
+    EXPECT_STREQ(peer.recv(100).get<char const *>(), "other");
+    auto buf = self.recv(100);
+    ASSERT_FALSE(buf.empty());
+    EXPECT_STREQ(buf.get<char const *>(), "other");
+}
+
+TEST(IPC, credits) {
+    for (auto name : {"credits", "inproc://credits"}) {
+        ipc::channel snd {name, ipc::sender};
+        EXPECT_EQ(snd.credits(), 0u); // no receiver
+        ipc::channel r1 {name, ipc::receiver};
+        ipc::channel r2 {name, ipc::receiver};
+        auto max = snd.credits();
+        ASSERT_GT(max, 0u);
+
+        // every send takes a credit, until the queue is full for the slowest receiver
+        std::size_t sent = 0;
+        while (snd.credits() > 0) {
+            ASSERT_EQ(snd.credits(), max - sent);
+            ASSERT_TRUE(snd.try_send(std::to_string(sent), 0));
+            ++sent;
+        }
+        EXPECT_EQ(sent, max);
+        EXPECT_FALSE(snd.try_send(std::string{"full"}, 0));
+        EXPECT_FALSE(snd.wait_for_credits(1, 10));
+
+        // r1 gives everything back, r2 still holds the queue
+        for (std::size_t i = 0; i < sent; ++i) ASSERT_FALSE(r1.recv(100).empty());
+        EXPECT_EQ(snd.credits(), 0u);
+        for (std::size_t i = 0; i < 10; ++i) ASSERT_FALSE(r2.recv(100).empty());
+        EXPECT_EQ(snd.credits(), 10u);
+        EXPECT_TRUE(snd.wait_for_credits(10, 0));
+        for (std::size_t i = 10; i < sent; ++i) ASSERT_FALSE(r2.recv(100).empty());
+        EXPECT_EQ(snd.credits(), max);
+
+        // a receiver may grant less than the queue
+        r1.set_window(16);
+        EXPECT_EQ(snd.credits(), 16u);
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(snd.send(std::string{"w"}));
+        EXPECT_EQ(snd.credits(), 12u);
+        ASSERT_FALSE(r1.recv(100).empty());
+        EXPECT_EQ(snd.credits(), 13u);
+        r1.set_window(0);
+        EXPECT_EQ(snd.credits(), max - 4);
+    }
+    // unicast: from the read and write cursors of the queue
+    ipc::chan<relat::single, relat::single, trans::unicast> que {"credits-ssu", ipc::sender};
+    ipc::chan<relat::single, relat::single, trans::unicast> rcv {"credits-ssu", ipc::receiver};
+    auto max = que.credits();
+    ASSERT_GT(max, 0u);
+    ASSERT_TRUE(que.send(std::string{"1"}));
+    ASSERT_TRUE(que.send(std::string{"2"}));
+    EXPECT_EQ(que.credits(), max - 2);
+    ASSERT_FALSE(rcv.recv(100).empty());
+    EXPECT_EQ(que.credits(), max - 1);
+}
+
+TEST(IPC, credits_window_wakeup) {
+    for (auto name : {"credits-wakeup", "inproc://credits-wakeup"}) {
+        ipc::channel snd {name, ipc::sender};
+        ipc::channel r1  {name, ipc::receiver};
+        ipc::channel r2  {name, ipc::receiver};
+        r1.set_window(4);
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(snd.send(std::string{"w"}));
+        ASSERT_EQ(snd.credits(), 0u);
+
+        // r2 lags behind, so what r1 reads frees no slot: only its window gives room
+        std::atomic<bool> ok {false};
+        auto start = std::chrono::steady_clock::now();
+        std::thread sender {[&] {
+            ok = snd.wait_for_credits(1, 2000);
+        }};
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_FALSE(r1.recv(100).empty());
+        sender.join();
+        EXPECT_TRUE(ok);
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+    }
+}
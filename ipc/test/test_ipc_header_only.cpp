@@ -0,0 +1,51 @@
+// Built as its own target with LIBIPC_HEADER_ONLY defined,
+// chan_wrapper must be compiled the same way in every translation unit.
+#if !defined(LIBIPC_HEADER_ONLY)
+#   error "This file must be compiled with LIBIPC_HEADER_ONLY defined."
+#endif
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "libipc/ipc.h"
+
+#include "test.h"
+
+namespace {
+
+using flag_t = ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>;
+
+// ipc.h pulled the inline definitions in, not only the declaration.
+static_assert(sizeof(ipc::detail::chan_inline<flag_t>) > 0, "chan_inline is not defined.");
+
+TEST(IPC, header_only_send_recv) {
+    ipc::channel receiver {"test-ipc-header-only", ipc::receiver};
+    ipc::channel sender   {"test-ipc-header-only", ipc::sender};
+    ASSERT_TRUE(sender.wait_for_recv(1, 1000));
+
+    // Small messages fit in the queue element, large ones go through chunk storage.
+    for (std::size_t size : {std::size_t(1), std::size_t(ipc::data_length), std::size_t(64 * 1024)}) {
+        std::vector<char> data(size);
+        for (std::size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i);
+        ASSERT_TRUE(sender.send(data.data(), data.size()));
+        auto buf = receiver.recv(1000);
+        ASSERT_EQ(buf.size(), size);
+        EXPECT_EQ(std::memcmp(buf.data(), data.data(), size), 0);
+    }
+}
+
+TEST(IPC, header_only_interop) {
+    // The inline code and the library's chan_impl share one wire format.
+    ipc::handle_t h = nullptr;
+    ASSERT_TRUE(ipc::chan_impl<flag_t>::connect(&h, "test-ipc-header-only-2", ipc::receiver));
+    {
+        ipc::channel sender {"test-ipc-header-only-2", ipc::sender};
+        ASSERT_TRUE(sender.send(std::string{"inline"}));
+    }
+    auto buf = ipc::chan_impl<flag_t>::recv(h, 1000);
+    EXPECT_STREQ(static_cast<char const *>(buf.data()), "inline");
+    ipc::chan_impl<flag_t>::destroy(h);
+}
+
+} // internal-linkage
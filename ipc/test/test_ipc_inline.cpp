@@ -0,0 +1,72 @@
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "libipc/ipc.h"
+#include "libipc/ipc.inc"   // detail::chan_inline, what LIBIPC_HEADER_ONLY builds on
+
+#include "test.h"
+
+namespace {
+
+/*
+ * Compares the exported, out-of-line chan_impl against the same code
+ * compiled into this translation unit, on small messages where the
+ * per-call overhead is the largest part of the cost.
+*/
+
+using flag_t = ipc::wr<ipc::relat::single, ipc::relat::multi, ipc::trans::broadcast>;
+
+constexpr int Batch = 64;
+constexpr int Loops = 2000;
+
+template <typename Detail>
+void test_call_overhead(char const *name, char const *message) {
+    ipc::handle_t sender = nullptr, receiver = nullptr;
+    ASSERT_TRUE(Detail::connect(&receiver, name, ipc::receiver));
+    ASSERT_TRUE(Detail::connect(&sender  , name, ipc::sender));
+
+    std::uint64_t data = 0, sum = 0;
+    ipc_ut::test_stopwatch sw;
+    sw.start();
+    for (int i = 0; i < Loops; ++i) {
+        for (int k = 0; k < Batch; ++k, ++data) {
+            EXPECT_TRUE(Detail::send(sender, &data, sizeof(data), 0));
+        }
+        for (int k = 0; k < Batch; ++k) {
+            auto buf = Detail::try_recv(receiver);
+            ASSERT_EQ(buf.size(), sizeof(data));
+            sum += *static_cast<std::uint64_t *>(buf.data());
+        }
+    }
+    sw.print_elapsed(1, Loops * Batch, message);
+    EXPECT_EQ(sum, data * (data - 1) / 2);
+
+    Detail::destroy(sender);
+    Detail::destroy(receiver);
+}
+
+TEST(IPC, inline_call_overhead) {
+    test_call_overhead<ipc::chan_impl<flag_t>>          ("test-ipc-inline", "chan_impl  ");
+    test_call_overhead<ipc::detail::chan_inline<flag_t>>("test-ipc-inline", "chan_inline");
+}
+
+TEST(IPC, inline_gather_fragments) {
+    // Fragments of a two-part message, copied without joining the parts first.
+    char head[20], data[150], joined[sizeof(head) + sizeof(data)];
+    for (std::size_t i = 0; i < sizeof(joined); ++i) joined[i] = static_cast<char>(i);
+    std::memcpy(head, joined, sizeof(head));
+    std::memcpy(data, joined + sizeof(head), sizeof(data));
+
+    ipc::detail::channel_impl::gather_t frag {reinterpret_cast<ipc::byte_t const *>(head), sizeof(head),
+                                              reinterpret_cast<ipc::byte_t const *>(data), 0};
+    char out[ipc::data_length];
+    for (; frag.offset_ < sizeof(joined); frag.offset_ += ipc::data_length) {
+        auto n = (std::min)(sizeof(out), sizeof(joined) - frag.offset_);
+        frag.copy_to(out, n);
+        EXPECT_EQ(std::memcmp(out, joined + frag.offset_, n), 0) << "offset " << frag.offset_;
+    }
+}
+
+} // internal-linkage
@@ -0,0 +1,229 @@
+#if __has_include("mio/mio.hpp") && (__cplusplus >= 202002L)
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/journal.h"
+#include "libipc/ipc.h"
+
+#include "test.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+fs::path journal_base(char const * name) {
+    return fs::temp_directory_path() / name;
+}
+
+void remove_journal(fs::path const & base) {
+    std::error_code ec;
+    for (std::uint32_t i = 0; fs::remove(ipc::journal::segment_path(base, i), ec); ++i) ;
+}
+
+std::string message_of(int i) {
+    // sizes vary from a few bytes up to past the chunk threshold
+    return std::string(static_cast<std::size_t>(1 + (i * 37) % 200), static_cast<char>('a' + i % 26))
+         + std::to_string(i);
+}
+
+TEST(Journal, write_read) {
+    auto base = journal_base("test-journal-rw");
+    {
+        // small segments, so that the journal rolls over many times
+        ipc::journal::writer wr {base, 4096};
+        ASSERT_TRUE(wr.valid());
+        for (int i = 0; i < 1000; ++i) {
+            auto msg = message_of(i);
+            ASSERT_TRUE(wr.append(msg.data(), msg.size(), static_cast<std::uint64_t>(i)));
+        }
+        // larger than a segment
+        std::string large(10000, 'x');
+        ASSERT_TRUE(wr.append(large.data(), large.size(), 1000));
+        EXPECT_EQ(wr.count(), 1001u);
+    }
+    EXPECT_TRUE(fs::exists(ipc::journal::segment_path(base, 10)));
+
+    ipc::journal::reader rd {base};
+    ASSERT_TRUE(rd.valid());
+    ipc::journal::record rec;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(rd.next(rec));
+        auto msg = message_of(i);
+        EXPECT_EQ(rec.ts, static_cast<std::uint64_t>(i));
+        ASSERT_EQ(rec.size, msg.size());
+        EXPECT_EQ(std::memcmp(rec.data, msg.data(), msg.size()), 0);
+    }
+    ASSERT_TRUE(rd.next(rec));
+    EXPECT_EQ(rec.size, 10000u);
+    EXPECT_FALSE(rd.next(rec));
+    remove_journal(base);
+}
+
+TEST(Journal, follow) {
+    constexpr std::uint64_t Count = 20000;
+    auto base = journal_base("test-journal-follow");
+    ipc::journal::writer wr {base, 4096};
+    ASSERT_TRUE(wr.valid());
+
+    // The reader keeps up with the writer across many roll-overs
+    // and must not skip the tail of a segment the writer has just left.
+    std::thread writing {[&] {
+        for (std::uint64_t i = 0; i < Count; ++i) wr.append(&i, sizeof(i), i);
+    }};
+    ipc::journal::reader rd {base};
+    ASSERT_TRUE(rd.valid());
+    ipc::journal::record rec;
+    std::uint64_t n = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((n < Count) && (std::chrono::steady_clock::now() < deadline)) {
+        if (!rd.next(rec)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(rec.size, sizeof(std::uint64_t));
+        std::uint64_t v;
+        std::memcpy(&v, rec.data, sizeof(v));
+        ASSERT_EQ(v, n);
+        ++n;
+    }
+    writing.join();
+    EXPECT_EQ(n, Count);
+    EXPECT_FALSE(bool(rd.error()));
+    wr.close();
+    remove_journal(base);
+}
+
+TEST(Journal, record_replay) {
+    constexpr int Count = 2000;
+    auto base = journal_base("test-journal-chan");
+
+    std::atomic<bool> ready {false};
+    ipc::journal::recorder<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>> rec;
+    std::thread recording {[&] {
+        ASSERT_TRUE(rec.open("test-journal-src", base, 64 * 1024));
+        ready.store(true);
+        rec.run();
+        rec.close();
+    }};
+    while (!ready.load()) std::this_thread::yield();
+
+    {
+        ipc::channel src {"test-journal-src", ipc::sender};
+        for (int i = 0; i < Count; ++i) {
+            ASSERT_TRUE(src.send(message_of(i)));
+        }
+    }
+    while (rec.count() < Count) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    rec.stop();
+    recording.join();
+    ASSERT_EQ(rec.count(), std::uint64_t(Count));
+
+    // as fast as possible
+    ipc::channel dst {"test-journal-dst", ipc::receiver};
+    ipc::journal::replayer<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>> rep {base, "test-journal-dst"};
+    ASSERT_TRUE(rep.valid());
+    std::thread replaying {[&] {
+        EXPECT_EQ(rep.replay(), std::uint64_t(Count));
+    }};
+    for (int i = 0; i < Count; ++i) {
+        auto buf = dst.recv(1000);
+        auto msg = message_of(i);
+        ASSERT_EQ(buf.size(), msg.size() + 1);
+        ASSERT_STREQ(buf.get<char const *>(), msg.c_str());
+    }
+    replaying.join();
+    remove_journal(base);
+}
+
+TEST(Journal, timing) {
+    auto base = journal_base("test-journal-timing");
+    {
+        ipc::journal::writer wr {base};
+        // 10 messages, 20 ms apart
+        for (std::uint64_t i = 0; i < 10; ++i) {
+            wr.append(&i, sizeof(i), i * 20'000'000);
+        }
+    }
+    ipc::channel dst {"test-journal-timing", ipc::receiver};
+    ipc::journal::replayer<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>> rep {base, "test-journal-timing"};
+    auto elapsed = [&](double speed) {
+        auto t0 = std::chrono::steady_clock::now();
+        EXPECT_EQ(rep.replay(speed), 10u);
+        for (int i = 0; i < 10; ++i) EXPECT_EQ(dst.recv(1000).size(), sizeof(std::uint64_t));
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    };
+    EXPECT_GE(elapsed(1), 180);  // original timing
+    EXPECT_LT(elapsed(4), 150);  // 4x faster
+    EXPECT_LT(elapsed(0), 50);   // no pacing
+    remove_journal(base);
+}
+
+TEST(Journal, timing_backwards) {
+    auto base = journal_base("test-journal-backwards");
+    {
+        // the clock stepped back by a second between the two messages
+        ipc::journal::writer wr {base};
+        std::uint64_t v = 0;
+        wr.append(&v, sizeof(v), 5'000'000'000);
+        wr.append(&v, sizeof(v), 4'000'000'000);
+    }
+    ipc::channel dst {"test-journal-backwards", ipc::receiver};
+    ipc::journal::replayer<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>> rep {base, "test-journal-backwards"};
+    auto t0 = std::chrono::steady_clock::now();
+    EXPECT_EQ(rep.replay(1), 2u);
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(500));
+    remove_journal(base);
+}
+
+TEST(Journal, errors) {
+    ipc::journal::writer wr {fs::path{"/nonexistent-dir/test-journal"}};
+    EXPECT_FALSE(wr.valid());
+    EXPECT_TRUE(bool(wr.error()));
+
+    auto base = journal_base("test-journal-bad");
+    {
+        std::FILE * f = std::fopen(ipc::journal::segment_path(base, 0).string().c_str(), "wb");
+        ASSERT_NE(f, nullptr);
+        char junk[128] = "not a journal";
+        std::fwrite(junk, 1, sizeof(junk), f);
+        std::fclose(f);
+    }
+    ipc::journal::reader rd {base};
+    EXPECT_FALSE(rd.valid());
+    EXPECT_EQ(rd.error(), std::make_error_code(std::errc::invalid_argument));
+    remove_journal(base);
+
+    // a record claiming more bytes than the segment holds
+    {
+        ipc::journal::writer wr {base, 4096};
+        std::uint64_t v = 0;
+        wr.append(&v, sizeof(v));
+        wr.append(&v, sizeof(v));
+    }
+    {
+        std::FILE * f = std::fopen(ipc::journal::segment_path(base, 0).string().c_str(), "r+b");
+        ASSERT_NE(f, nullptr);
+        std::uint32_t huge = 0x7fffffffu;
+        std::fseek(f, long(sizeof(ipc::journal::segment_head) + offsetof(ipc::journal::record_head, size_)), SEEK_SET);
+        std::fwrite(&huge, sizeof(huge), 1, f);
+        std::fclose(f);
+    }
+    ipc::journal::reader bad {base};
+    ASSERT_TRUE(bad.valid());
+    ipc::journal::record rec;
+    EXPECT_FALSE(bad.next(rec));
+    EXPECT_EQ(bad.error(), std::make_error_code(std::errc::illegal_byte_sequence));
+    remove_journal(base);
+}
+
+} // internal-linkage
+
+#endif
@@ -24,11 +24,11 @@ struct msg_t {
     msg_t(int p, int d) : pid_(p), dat_(d) {}
 };
 
-template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts>
-using queue_t = ipc::queue<msg_t, ipc::policy::choose<ipc::circ::elem_array, ipc::wr<Rp, Rc, Ts>>>;
+template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts, typename L = ipc::circ::layout::packed>
+using queue_t = ipc::queue<msg_t, ipc::policy::choose<ipc::circ::elem_array, ipc::wr<Rp, Rc, Ts>, L>>;
 
-template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts>
-struct elems_t : public queue_t<Rp, Rc, Ts>::elems_t {};
+template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts, typename L = ipc::circ::layout::packed>
+struct elems_t : public queue_t<Rp, Rc, Ts, L>::elems_t {};
 
 bool operator==(msg_t const & m1, msg_t const & m2) noexcept {
     return (m1.pid_ == m2.pid_) && (m1.dat_ == m2.dat_);
@@ -80,15 +80,15 @@ struct quitter<ipc::trans::broadcast> {
     }
 };
 
-template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts>
-void test_sr(elems_t<Rp, Rc, Ts> && elems, int s_cnt, int r_cnt, char const * message) {
+template <ipc::relat Rp, ipc::relat Rc, ipc::trans Ts, typename L>
+void test_sr(elems_t<Rp, Rc, Ts, L> && elems, int s_cnt, int r_cnt, char const * message) {
     ipc_ut::sender().start(static_cast<std::size_t>(s_cnt));
     ipc_ut::reader().start(static_cast<std::size_t>(r_cnt));
     ipc_ut::test_stopwatch sw;
 
     for (int k = 0; k < s_cnt; ++k) {
         ipc_ut::sender() << [&elems, &sw, r_cnt, k] {
-            queue_t<Rp, Rc, Ts> que { &elems };
+            queue_t<Rp, Rc, Ts, L> que { &elems };
             while (que.conn_count() != static_cast<std::size_t>(r_cnt)) {
                 std::this_thread::yield();
             }
@@ -100,7 +100,7 @@ void test_sr(elems_t<Rp, Rc, Ts> && elems, int s_cnt, int r_cnt, char const * me
     }
     for (int k = 0; k < r_cnt; ++k) {
         ipc_ut::reader() << [&elems, k] {
-            queue_t<Rp, Rc, Ts> que { &elems };
+            queue_t<Rp, Rc, Ts, L> que { &elems };
             ASSERT_TRUE(que.connect());
             while (pop(que).pid_ >= 0) ;
             ASSERT_TRUE(que.disconnect());
@@ -108,7 +108,7 @@ void test_sr(elems_t<Rp, Rc, Ts> && elems, int s_cnt, int r_cnt, char const * me
     }
 
     ipc_ut::sender().wait_for_done();
-    quitter<Ts>::emit(queue_t<Rp, Rc, Ts> { &elems }, r_cnt);
+    quitter<Ts>::emit(queue_t<Rp, Rc, Ts, L> { &elems }, r_cnt);
     ipc_ut::reader().wait_for_done();
     sw.print_elapsed(s_cnt, r_cnt, LoopCount, message);
 }
@@ -128,6 +128,23 @@ TEST(Queue, check_size) {
     std::cout << "sizeof(elems_t<s, m, b>) = " << sizeof(el_t) << std::endl;
 }
 
+TEST(Queue, check_layout) {
+    using packed_t = elems_t<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>;
+    using line_t   = elems_t<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast, ipc::circ::layout::cache_line>;
+    using split_t  = elems_t<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast, ipc::circ::layout::split_ctrl>;
+
+    std::cout << "elem_size (packed)     = " << packed_t::elem_size << std::endl;
+    std::cout << "elem_size (cache_line) = " << line_t  ::elem_size << std::endl;
+    std::cout << "elem_size (split_ctrl) = " << split_t ::elem_size << std::endl;
+
+    EXPECT_EQ(static_cast<std::size_t>(line_t ::elem_size), ipc::cache_line_size);
+    EXPECT_EQ(static_cast<std::size_t>(split_t::elem_size), ipc::cache_line_size * 2);
+
+    using big_t = ipc::prod_cons_layout<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>,
+                                        ipc::circ::layout::cache_line>::elem_t<ipc::cache_line_size, 8>;
+    EXPECT_EQ(sizeof(big_t), ipc::cache_line_size * 2); // payload fills its line, control words spill
+}
+
 TEST(Queue, el_connection) {
     {
         elems_t<ipc::relat::single, ipc::relat::single, ipc::trans::unicast> el;
@@ -302,3 +319,27 @@ TEST(Queue, prod_cons_NvN_broadcast) {
         test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::broadcast>{}, i, i, "mmb");
     }
 }
+
+TEST(Queue, DISABLED_prod_cons_layout) {
+    using ipc::circ::layout::packed;
+    using ipc::circ::layout::cache_line;
+    using ipc::circ::layout::split_ctrl;
+    test_sr(elems_t<ipc::relat::single, ipc::relat::single, ipc::trans::unicast  , packed    >{}, 1, 1, "ssu packed    ");
+    test_sr(elems_t<ipc::relat::single, ipc::relat::single, ipc::trans::unicast  , cache_line>{}, 1, 1, "ssu cache_line");
+    test_sr(elems_t<ipc::relat::single, ipc::relat::single, ipc::trans::unicast  , split_ctrl>{}, 1, 1, "ssu split_ctrl");
+    for (int i = 1; i <= ThreadMax; i *= 2) {
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::unicast  , packed    >{}, i, i, "mmu packed    ");
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::unicast  , cache_line>{}, i, i, "mmu cache_line");
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::unicast  , split_ctrl>{}, i, i, "mmu split_ctrl");
+    }
+    for (int i = 1; i <= ThreadMax; i *= 2) {
+        test_sr(elems_t<ipc::relat::single, ipc::relat::multi , ipc::trans::broadcast, packed    >{}, 1, i, "smb packed    ");
+        test_sr(elems_t<ipc::relat::single, ipc::relat::multi , ipc::trans::broadcast, cache_line>{}, 1, i, "smb cache_line");
+        test_sr(elems_t<ipc::relat::single, ipc::relat::multi , ipc::trans::broadcast, split_ctrl>{}, 1, i, "smb split_ctrl");
+    }
+    for (int i = 1; i <= ThreadMax; i *= 2) {
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::broadcast, packed    >{}, i, i, "mmb packed    ");
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::broadcast, cache_line>{}, i, i, "mmb cache_line");
+        test_sr(elems_t<ipc::relat::multi , ipc::relat::multi , ipc::trans::broadcast, split_ctrl>{}, i, i, "mmb split_ctrl");
+    }
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/rpc.h"
+#include "libipc/ipc.h"
+
+#include "test.h"
+
+namespace {
+
+/* Echoes every request back until stopped. */
+class echo_server {
+    ipc::rpc_server server_;
+    std::atomic<bool> quit_ {false};
+    std::atomic<std::size_t> batches_ {0};
+    std::atomic<std::size_t> served_  {0};
+    std::thread thread_;
+
+public:
+    echo_server(char const * name, std::size_t batch = 1)
+        : server_{name} {
+        thread_ = std::thread{[this, batch] {
+            while (!quit_.load(std::memory_order_relaxed)) {
+                auto n = server_.serve([](ipc::rpc_request const & req) {
+                    // the request outlives its reply, so just point at it
+                    return ipc::buff_t{const_cast<void *>(req.data()), req.size()};
+                }, batch, 100);
+                if (n > 0) {
+                    batches_.fetch_add(1, std::memory_order_relaxed);
+                    served_ .fetch_add(n, std::memory_order_relaxed);
+                }
+            }
+        }};
+    }
+
+    ~echo_server() {
+        quit_.store(true, std::memory_order_relaxed);
+        thread_.join();
+    }
+
+    std::size_t batches() const noexcept { return batches_.load(); }
+    std::size_t served () const noexcept { return served_ .load(); }
+};
+
+void print_percentiles(std::vector<std::int64_t> & ns, char const * message) {
+    std::sort(ns.begin(), ns.end());
+    auto at = [&ns](double q) {
+        return double(ns[static_cast<std::size_t>(q * double(ns.size() - 1))]) / 1000.0;
+    };
+    std::cout << message << "\tp50 " << at(0.5) << " us, p90 " << at(0.9)
+              << " us, p99 " << at(0.99) << " us, p99.9 " << at(0.999) << " us" << std::endl;
+}
+
+TEST(RPC, call) {
+    echo_server server {"test-rpc-call"};
+    ipc::rpc_client client {"test-rpc-call"};
+    ASSERT_TRUE(client.valid());
+
+    auto reply = client.call(std::string{"hello"}, 1000);
+    ASSERT_FALSE(reply.empty());
+    EXPECT_STREQ(reply.get<char const *>(), "hello");
+
+    // large payload, through the chunk storage
+    std::string large(64 * 1024, '\0');
+    for (std::size_t i = 0; i < large.size(); ++i) large[i] = static_cast<char>('a' + i % 26);
+    reply = client.call(large, 1000);
+    ASSERT_EQ(reply.size(), large.size() + 1);
+    EXPECT_EQ(std::memcmp(reply.data(), large.c_str(), reply.size()), 0);
+}
+
+TEST(RPC, no_server) {
+    ipc::rpc_client client {"test-rpc-no-server"};
+    ASSERT_TRUE(client.valid());
+    EXPECT_TRUE(client.call(std::string{"anybody?"}, 100).empty());
+}
+
+TEST(RPC, one_server_per_name) {
+    ipc::rpc_server first {"test-rpc-one-server"};
+    ASSERT_TRUE(first.valid());
+    ipc::rpc_server second {"test-rpc-one-server"};
+    EXPECT_FALSE(second.valid());
+    first.disconnect();
+    EXPECT_TRUE(second.connect("test-rpc-one-server"));
+}
+
+TEST(RPC, client_churn) {
+    // More clients come and go than the server keeps reply channels for.
+    echo_server server {"test-rpc-churn"};
+    for (std::size_t i = 0; i < ipc::rpc_server::max_clients * 2; ++i) {
+        ipc::rpc_client client {"test-rpc-churn", 1};
+        ASSERT_TRUE(client.valid());
+        auto reply = client.call(&i, sizeof(i), 1000);
+        ASSERT_EQ(reply.size(), sizeof(i));
+        EXPECT_EQ(std::memcmp(reply.data(), &i, sizeof(i)), 0);
+    }
+    std::vector<std::unique_ptr<ipc::rpc_client>> clients;
+    for (std::size_t i = 0; i < ipc::rpc_server::max_clients + 8; ++i) {
+        clients.emplace_back(new ipc::rpc_client{"test-rpc-churn", 1});
+        ASSERT_FALSE(clients.back()->call(&i, sizeof(i), 1000).empty());
+    }
+    // The least recently used clients were evicted, and get their channel back on demand.
+    for (std::size_t i = 0; i < clients.size(); ++i) {
+        EXPECT_FALSE(clients[i]->call(&i, sizeof(i), 1000).empty());
+    }
+}
+
+TEST(RPC, stalled_client) {
+    ipc::rpc_server server {"test-rpc-stalled"};
+    ASSERT_TRUE(server.valid());
+    ipc::rpc_client stalled {"test-rpc-stalled"}, other {"test-rpc-stalled"};
+
+    // Calls with no time to wait never read their replies, which pile up
+    // in the stalled client's queue until it is full.
+    auto echo = [](ipc::rpc_request const & req) {
+        return ipc::buff_t{const_cast<void *>(req.data()), req.size()};
+    };
+    auto t0 = std::chrono::steady_clock::now();
+    for (int round = 0; round < 8; ++round) {
+        for (int i = 0; i < 64; ++i) stalled.call(&i, sizeof(i), 0);
+        while (server.serve(echo, 64, 0) > 0) ;
+    }
+    // The server went on at full speed, dropping what did not fit.
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(1));
+    EXPECT_GT(server.dropped(), 0u);
+
+    // Once it reads again (this call times out, nobody serves it yet), the stalled
+    // client drains its queue, and its connection was not cut off.
+    int v = 42;
+    EXPECT_TRUE(stalled.call(&v, sizeof(v), 100).empty());
+    std::thread serving {[&] {
+        for (int i = 0; i < 3; ++i) server.serve(echo, 1, 1000);
+    }};
+    // Other clients are served as usual.
+    auto reply = other.call(&v, sizeof(v), 1000);
+    ASSERT_EQ(reply.size(), sizeof(v));
+    EXPECT_EQ(std::memcmp(reply.data(), &v, sizeof(v)), 0);
+
+    reply = stalled.call(&v, sizeof(v), 1000);
+    EXPECT_EQ(reply.size(), sizeof(v));
+    serving.join();
+}
+
+TEST(RPC, concurrent) {
+    constexpr int Threads = 8;
+    constexpr int Loops   = 2000;
+    echo_server server {"test-rpc-concurrent", 32};
+    ipc::rpc_client client {"test-rpc-concurrent", 4}; // fewer slots than threads
+    ASSERT_TRUE(client.valid());
+
+    std::atomic<int> fails {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < Loops; ++i) {
+                int req[2] = {t, i};
+                auto reply = client.call(req, sizeof(req), 5000);
+                if ((reply.size() != sizeof(req)) || (std::memcmp(reply.data(), req, sizeof(req)) != 0)) {
+                    fails.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto & t : threads) t.join();
+    EXPECT_EQ(fails.load(), 0);
+    EXPECT_EQ(server.served(), std::size_t(Threads * Loops));
+    std::cout << "requests per batch: " << double(server.served()) / double(server.batches()) << std::endl;
+}
+
+TEST(RPC, latency) {
+    constexpr int Loops = 20000;
+    std::vector<std::int64_t> ns;
+    ns.reserve(Loops);
+    std::uint64_t data[4] {};
+
+    // hand-rolled: a request channel and a reply channel, echoed by a thread
+    {
+        ipc::channel req {"test-rpc-latency-req", ipc::sender};
+        ipc::channel rep {"test-rpc-latency-rep", ipc::receiver};
+        std::thread echo {[] {
+            ipc::channel req {"test-rpc-latency-req", ipc::receiver};
+            ipc::channel rep {"test-rpc-latency-rep", ipc::sender};
+            for (;;) {
+                auto buf = req.recv();
+                if (buf.size() != sizeof(data)) break;
+                rep.send(buf);
+            }
+        }};
+        req.wait_for_recv(1);
+        for (int i = 0; i < Loops; ++i) {
+            data[0] = static_cast<std::uint64_t>(i);
+            auto t0 = std::chrono::steady_clock::now();
+            req.send(data, sizeof(data));
+            auto buf = rep.recv();
+            ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+            ASSERT_EQ(buf.size(), sizeof(data));
+        }
+        req.send(std::string{"quit"});
+        echo.join();
+        print_percentiles(ns, "channel pair");
+    }
+
+    ns.clear();
+    {
+        echo_server server {"test-rpc-latency"};
+        ipc::rpc_client client {"test-rpc-latency"};
+        for (int i = 0; i < Loops; ++i) {
+            data[0] = static_cast<std::uint64_t>(i);
+            auto t0 = std::chrono::steady_clock::now();
+            auto buf = client.call(data, sizeof(data));
+            ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+            ASSERT_EQ(buf.size(), sizeof(data));
+        }
+        print_percentiles(ns, "rpc_client  ");
+    }
+}
+
+} // internal-linkage
@@ -0,0 +1,206 @@
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include "libipc/shm_container.h"
+#include "test.h"
+
+namespace {
+
+struct node_t {
+    int value;
+    ipc::offset_ptr<node_t> next;
+};
+
+struct root_t {
+    ipc::shm_hash_map<std::uint64_t, std::uint64_t, 1024> map;
+    ipc::shm_vector<std::uint64_t, 16> vec;
+    ipc::shm_pool<node_t, 64> pool;
+    ipc::offset_ptr<node_t> list;
+};
+
+TEST(ShmContainer, offset_ptr) {
+    ipc::shm_segment<root_t> seg1 {"test-shm-container-1", 1024 * 1024};
+    ipc::shm_segment<root_t> seg2 {"test-shm-container-1", 1024 * 1024};
+    ASSERT_TRUE(seg1.valid());
+    ASSERT_TRUE(seg2.valid());
+    ASSERT_NE(seg1.root(), seg2.root());
+
+    EXPECT_TRUE(seg1->list == nullptr);
+    for (int i = 1; i <= 3; ++i) {
+        auto n = seg1->pool.construct();
+        ASSERT_NE(n, nullptr);
+        n->value = i;
+        n->next  = seg1->list;
+        seg1->list = n;
+    }
+
+    // Walk the list through the other mapping.
+    int sum = 0, count = 0;
+    for (auto n = seg2->list; n; n = n->next) {
+        EXPECT_GE(reinterpret_cast<char const *>(n.get()), reinterpret_cast<char const *>(seg2.root()));
+        sum += n->value;
+        ++count;
+    }
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(sum, 6);
+}
+
+TEST(ShmContainer, pool) {
+    ipc::shm_segment<root_t> seg {"test-shm-container-2", 1024 * 1024};
+    ASSERT_TRUE(seg.valid());
+
+    std::vector<node_t *> nodes;
+    for (std::size_t i = 0; i < decltype(seg->pool)::capacity(); ++i) {
+        auto p = seg->pool.allocate();
+        ASSERT_NE(p, nullptr);
+        nodes.push_back(p);
+    }
+    EXPECT_EQ(seg->pool.allocate(), nullptr);
+    seg->pool.deallocate(nodes[10]);
+    seg->pool.deallocate(nodes[20]);
+    EXPECT_EQ(seg->pool.allocate(), nodes[20]);
+    EXPECT_EQ(seg->pool.allocate(), nodes[10]);
+    EXPECT_EQ(seg->pool.allocate(), nullptr);
+}
+
+TEST(ShmContainer, hash_map) {
+    ipc::shm_segment<root_t> seg1 {"test-shm-container-3", 1024 * 1024};
+    ipc::shm_segment<root_t> seg2 {"test-shm-container-3", 1024 * 1024};
+    ASSERT_TRUE(seg1.valid());
+    ASSERT_TRUE(seg2.valid());
+
+    std::uint64_t val = 0;
+    EXPECT_FALSE(seg2->map.find(1, val));
+    EXPECT_TRUE (seg1->map.insert(1, 100));
+    EXPECT_FALSE(seg1->map.insert(1, 200));
+    EXPECT_TRUE (seg2->map.find(1, val));
+    EXPECT_EQ(val, 100u);
+    EXPECT_TRUE (seg1->map.assign(1, 300));
+    EXPECT_TRUE (seg2->map.find(1, val));
+    EXPECT_EQ(val, 300u);
+    EXPECT_EQ(seg2->map.size(), 1u);
+    EXPECT_TRUE (seg2->map.erase(1));
+    EXPECT_FALSE(seg1->map.find(1, val));
+    EXPECT_FALSE(seg1->map.erase(1));
+    EXPECT_TRUE (seg1->map.insert(1, 400));
+    EXPECT_TRUE (seg2->map.find(1, val));
+    EXPECT_EQ(val, 400u);
+
+    for (std::uint64_t k = 2; k <= decltype(seg1->map)::capacity(); ++k) {
+        EXPECT_TRUE(seg1->map.insert(k, k * 10));
+    }
+    EXPECT_FALSE(seg1->map.insert(0, 0));
+    for (std::uint64_t k = 2; k <= decltype(seg1->map)::capacity(); ++k) {
+        ASSERT_TRUE(seg2->map.find(k, val));
+        EXPECT_EQ(val, k * 10);
+    }
+}
+
+TEST(ShmContainer, hash_map_churn) {
+    ipc::shm_segment<root_t> seg {"test-shm-container-5", 1024 * 1024};
+    ASSERT_TRUE(seg.valid());
+    auto & map = seg->map;
+    constexpr std::uint64_t cap = decltype(seg->map)::capacity();
+
+    // Every key is new, so each erase leaves a tombstone no later key matches.
+    for (std::uint64_t k = 0; k < cap * 4; ++k) {
+        ASSERT_TRUE(map.insert(k, k));
+        ASSERT_TRUE(map.erase(k));
+    }
+    EXPECT_EQ(map.size(), 0u);
+    std::uint64_t val = 0;
+    EXPECT_TRUE (map.insert(cap * 4, 1));
+    EXPECT_TRUE (map.find(cap * 4, val));
+    EXPECT_EQ(val, 1u);
+    EXPECT_TRUE (map.erase(cap * 4));
+
+    // The tombstones still leave room for a full table.
+    for (std::uint64_t k = 0; k < cap; ++k) {
+        ASSERT_TRUE(map.assign(cap * 8 + k, k));
+    }
+    EXPECT_EQ(map.size(), cap);
+    EXPECT_FALSE(map.insert(0, 0));
+    for (std::uint64_t k = 0; k < cap; ++k) {
+        ASSERT_TRUE(map.find(cap * 8 + k, val));
+        EXPECT_EQ(val, k);
+    }
+}
+
+TEST(ShmContainer, hash_map_churn_concurrent) {
+    ipc::shm_segment<root_t> seg {"test-shm-container-6", 1024 * 1024};
+    ASSERT_TRUE(seg.valid());
+    auto & map = seg->map;
+    constexpr std::uint64_t cap = decltype(seg->map)::capacity();
+    for (std::uint64_t k = 0; k < cap / 2; ++k) {
+        ASSERT_TRUE(map.insert(cap + k, 0));
+        ASSERT_TRUE(map.erase(cap + k));
+    }
+
+    // All threads insert the same keys over the tombstones: each key goes in once.
+    constexpr std::uint64_t count = cap / 4;
+    std::atomic<std::uint64_t> inserted {0};
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 4; ++i) {
+        writers.emplace_back([&] {
+            for (std::uint64_t k = 0; k < count; ++k) {
+                if (map.insert(k, k)) inserted.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &t : writers) t.join();
+    EXPECT_EQ(inserted.load(), count);
+    EXPECT_EQ(map.size(), count);
+    for (std::uint64_t k = 0; k < count; ++k) {
+        EXPECT_TRUE (map.erase(k));
+        EXPECT_FALSE(map.contains(k));
+    }
+    EXPECT_EQ(map.size(), 0u);
+}
+
+TEST(ShmContainer, concurrent) {
+    constexpr std::uint64_t count = 1000;
+    ipc::shm_segment<root_t> seg {"test-shm-container-4", 1024 * 1024};
+    ASSERT_TRUE(seg.valid());
+
+    std::atomic<bool> done {false};
+    std::atomic<std::uint64_t> bad {0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            ipc::shm_segment<root_t> seg {"test-shm-container-4", 1024 * 1024};
+            while (!done.load(std::memory_order_acquire)) {
+                auto n = seg->vec.size();
+                for (std::size_t i = 0; i < n; ++i) {
+                    if (seg->vec[i] != i * 3) bad.fetch_add(1, std::memory_order_relaxed);
+                }
+                std::uint64_t val = 0;
+                for (std::uint64_t k = 0; k < count; ++k) {
+                    if (seg->map.find(k, val) && (val != k + 1) && (val != k + 2)) {
+                        bad.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    }
+    // Readers are still running here, so failures are only counted
+    // and checked once every thread has been joined.
+    std::uint64_t failed = 0;
+    for (std::uint64_t k = 0; k < count; ++k) {
+        if (seg->vec.push_back(seg, k * 3) == std::size_t(ipc::invalid_value)) ++failed;
+        if (!seg->map.insert(k, k + 1)) ++failed;
+    }
+    for (std::uint64_t k = 0; k < count; ++k) {
+        if (!seg->map.assign(k, k + 2)) ++failed;
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers) t.join();
+
+    ASSERT_EQ(failed, 0u);
+    EXPECT_EQ(bad.load(), 0u);
+    EXPECT_EQ(seg->vec.size(), count);
+    EXPECT_GT(seg.used(), count * sizeof(std::uint64_t));
+}
+
+} // internal-linkage
@@ -0,0 +1,140 @@
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+#include "libipc/snapshot.h"
+#include "libipc/platform/detail.h"
+#include "test.h"
+
+#if defined(IPC_OS_LINUX_)
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct quote {
+    std::uint64_t seq;
+    double bid;
+    double ask;
+    std::uint64_t check;
+};
+
+TEST(Snapshot, store_load) {
+    ipc::snapshot<quote> sn {"test-snapshot-1"};
+    ASSERT_TRUE(sn.valid());
+
+    quote q {};
+    EXPECT_FALSE(sn.load(q));
+    EXPECT_EQ(sn.version(), 0u);
+
+    sn.store({1, 1.5, 2.5, 1});
+    std::uint32_t ver = 0;
+    EXPECT_TRUE(sn.load(q, &ver));
+    EXPECT_EQ(q.seq, 1u);
+    EXPECT_EQ(q.bid, 1.5);
+    EXPECT_EQ(q.ask, 2.5);
+    EXPECT_EQ(ver, sn.version());
+
+    ipc::snapshot<quote> other {"test-snapshot-1"};
+    other.store({2, 3.5, 4.5, 2});
+    EXPECT_NE(ver, sn.version());
+    EXPECT_EQ(sn.load().seq, 2u);
+}
+
+TEST(Snapshot, wait) {
+    ipc::snapshot<quote> sn {"test-snapshot-2"};
+    ASSERT_TRUE(sn.valid());
+
+    auto ver = sn.version();
+    EXPECT_FALSE(sn.wait(ver, 10));
+
+    std::thread writer {[] {
+        ipc::snapshot<quote> sn {"test-snapshot-2"};
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sn.store({7, 0, 0, 7});
+    }};
+    EXPECT_TRUE(sn.wait(ver, 5000));
+    EXPECT_EQ(sn.load().seq, 7u);
+    writer.join();
+}
+
+TEST(Snapshot, consistency) {
+    constexpr std::uint64_t loops = 200000;
+    ipc::snapshot<quote> sn {"test-snapshot-3"};
+    ASSERT_TRUE(sn.valid());
+
+    std::atomic<bool> done {false};
+    std::atomic<std::uint64_t> torn {0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&] {
+            ipc::snapshot<quote> sn {"test-snapshot-3"};
+            quote q {};
+            while (!done.load(std::memory_order_relaxed)) {
+                if (sn.load(q) && ((q.check != q.seq) || (q.bid != double(q.seq)))) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    ipc_ut::test_stopwatch sw;
+    sw.start();
+    for (std::uint64_t i = 1; i <= loops; ++i) {
+        sn.store({i, double(i), double(i), i});
+    }
+    sw.print_elapsed(1, 2, loops, "snapshot store: ");
+    done.store(true, std::memory_order_relaxed);
+    for (auto &t : readers) t.join();
+
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_EQ(sn.load().seq, loops);
+}
+
+#if defined(IPC_OS_LINUX_)
+TEST(Snapshot, writer_dies) {
+    // Large enough that a store spends its time copying, so a kill lands in the middle.
+    constexpr std::size_t size = 16 * 1024 * 1024;
+    std::vector<char> val(size, 'p');
+    bool torn = false;
+    for (int round = 0; (round < 5) && !torn; ++round) {
+        int ready[2];
+        ASSERT_EQ(::pipe(ready), 0);
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ipc::latest_value lv {"test-snapshot-4", size};
+            std::vector<char> buf(size, 'c');
+            lv.store(buf.data());
+            char c = 1;
+            if (::write(ready[1], &c, 1) != 1) ::_exit(1);
+            for (;;) lv.store(buf.data());
+        }
+        char c = 0;
+        ASSERT_EQ(::read(ready[0], &c, 1), 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+        ::close(ready[0]);
+        ::close(ready[1]);
+
+        ipc::latest_value lv {"test-snapshot-4", size};
+        ASSERT_TRUE(lv.valid());
+        std::vector<char> out(size);
+        auto t0 = std::chrono::steady_clock::now();
+        torn = !lv.load(out.data());
+        // The dead writer is noticed instead of waited for, by readers and writers.
+        lv.store(val.data());
+        EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(1));
+        ASSERT_TRUE(lv.load(out.data()));
+        EXPECT_EQ(std::memcmp(out.data(), val.data(), size), 0);
+    }
+    EXPECT_TRUE(torn);
+}
+#endif
+
+} // internal-linkage
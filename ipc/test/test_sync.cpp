@@ -5,6 +5,8 @@
 #include <chrono>
 #include <deque>
 #include <array>
+#include <vector>
+#include <atomic>
 #include <cstdio>
 
 #include "test.h"
@@ -101,6 +103,365 @@ TEST(Sync, Semaphore) {
     EXPECT_FALSE(sem.wait(0));
 }
 
+TEST(Sync, SemaphoreBatch) {
+    ipc::sync::semaphore sem {"test-sem-batch"};
+    ASSERT_TRUE(sem.valid());
+    std::atomic<int> woken {0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 4; ++i) {
+        waiters.emplace_back([&woken] {
+            ipc::sync::semaphore sem {"test-sem-batch"};
+            if (sem.wait(1000)) woken.fetch_add(1);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(sem.post(3));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(woken.load(), 3);
+    EXPECT_TRUE(sem.post(1));
+    for (auto &t : waiters) t.join();
+    EXPECT_EQ(woken.load(), 4);
+    EXPECT_FALSE(sem.wait(10));
+}
+
+namespace {
+
+template <typename Sem>
+void test_sem_ping_pong(Sem &ping, Sem &pong, char const *message) {
+    constexpr int loops = 100000;
+    ipc_ut::test_stopwatch sw;
+    std::thread t {[&] {
+        for (int i = 0; i < loops; ++i) {
+            ping.wait();
+            pong.post();
+        }
+    }};
+    sw.start();
+    for (int i = 0; i < loops; ++i) {
+        ping.post();
+        pong.wait();
+    }
+    t.join();
+    sw.print_elapsed(1, loops, message);
+}
+
+} // internal-linkage
+
+#if defined(IPC_OS_LINUX_)
+#include <fcntl.h>
+#include <semaphore.h>
+
+namespace {
+
+struct posix_sem {
+    sem_t *h_;
+    explicit posix_sem(char const *name)
+        : h_(::sem_open(name, O_CREAT, 0666, 0)) {}
+    ~posix_sem() { ::sem_close(h_); }
+    void wait() { ::sem_wait(h_); }
+    void post() { ::sem_post(h_); }
+};
+
+} // internal-linkage
+#endif
+
+TEST(Sync, SemaphorePerformance) {
+    {
+        ipc::sync::semaphore ping {"test-sem-ping"}, pong {"test-sem-pong"};
+        test_sem_ping_pong(ping, pong, "ipc::sync::semaphore");
+    }
+#if defined(IPC_OS_LINUX_)
+    {
+        posix_sem ping {"/test-posix-sem-ping"}, pong {"/test-posix-sem-pong"};
+        ASSERT_NE(ping.h_, SEM_FAILED);
+        ASSERT_NE(pong.h_, SEM_FAILED);
+        test_sem_ping_pong(ping, pong, "sem_open       ");
+    }
+    ::sem_unlink("/test-posix-sem-ping");
+    ::sem_unlink("/test-posix-sem-pong");
+#endif
+}
+
+#include "libipc/rw_mutex.h"
+
+TEST(Sync, RwMutex) {
+    ipc::sync::rw_mutex lock;
+    EXPECT_TRUE(lock.open("test-rw-mutex"));
+
+    EXPECT_TRUE(lock.lock_shared());
+    EXPECT_TRUE(lock.lock_shared());
+    std::thread{[] {
+        ipc::sync::rw_mutex lock {"test-rw-mutex"};
+        EXPECT_TRUE(lock.try_lock_shared());
+        EXPECT_TRUE(lock.unlock_shared());
+        EXPECT_FALSE(lock.try_lock());
+        EXPECT_FALSE(lock.lock(10));
+    }}.join();
+    EXPECT_TRUE(lock.unlock_shared());
+    EXPECT_TRUE(lock.unlock_shared());
+
+    EXPECT_TRUE(lock.lock());
+    std::thread{[] {
+        ipc::sync::rw_mutex lock {"test-rw-mutex"};
+        EXPECT_FALSE(lock.try_lock_shared());
+        EXPECT_FALSE(lock.lock_shared(10));
+    }}.join();
+    EXPECT_TRUE(lock.unlock());
+
+    int data = 0;
+    std::array<std::thread, 4> writers;
+    for (auto &t : writers) {
+        t = std::thread{[&data] {
+            ipc::sync::rw_mutex lock {"test-rw-mutex"};
+            for (int i = 0; i < 1000; ++i) {
+                std::lock_guard<ipc::sync::rw_mutex> guard {lock};
+                ++data;
+            }
+        }};
+    }
+    for (auto &t : writers) t.join();
+    EXPECT_EQ(data, 4000);
+}
+
+#if defined(IPC_OS_LINUX_)
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libipc/shm.h"
+
+TEST(Sync, RwMutexRobust) {
+    ipc::sync::rw_mutex lock {"test-rw-mutex-robust"};
+    ASSERT_TRUE(lock.valid());
+
+    auto die_holding = [](bool shared) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ipc::sync::rw_mutex lock {"test-rw-mutex-robust"};
+            bool ok = shared ? lock.lock_shared() : lock.lock();
+            ::_exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+    };
+
+    ASSERT_TRUE(die_holding(false));
+    EXPECT_TRUE(lock.lock_shared(1000));
+    EXPECT_TRUE(lock.unlock_shared());
+
+    ASSERT_TRUE(die_holding(true));
+    EXPECT_TRUE(lock.lock(1000));
+    EXPECT_TRUE(lock.unlock());
+}
+
+TEST(Sync, SemaphoreOpenRace) {
+    // Processes racing to create a semaphore must agree on one initial count.
+    for (int round = 0; round < 50; ++round) {
+        int go[2], ready[2], hold[2];
+        ASSERT_EQ(::pipe(go), 0);
+        ASSERT_EQ(::pipe(ready), 0);
+        ASSERT_EQ(::pipe(hold), 0);
+        std::vector<pid_t> children;
+        for (int i = 0; i < 4; ++i) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                ::close(go[1]);
+                ::close(hold[1]);
+                char c;
+                ::read(go[0], &c, 1); // returns once the parent closes the pipe
+                {
+                    ipc::sync::semaphore sem {"test-sem-open-race", 2};
+                    c = sem.valid() ? 1 : 0;
+                    if (::write(ready[1], &c, 1) != 1) ::_exit(1);
+                    ::read(hold[0], &c, 1);
+                }
+                ::_exit(0);
+            }
+            children.push_back(pid);
+        }
+        ::close(go[1]);
+        for (std::size_t i = 0; i < children.size(); ++i) {
+            char c = 0;
+            ASSERT_EQ(::read(ready[0], &c, 1), 1);
+            ASSERT_EQ(c, 1);
+        }
+        int taken = 0;
+        {
+            ipc::sync::semaphore sem {"test-sem-open-race", 2};
+            while (sem.wait(0)) ++taken;
+        }
+        ::close(hold[1]);
+        for (auto pid : children) ::waitpid(pid, nullptr, 0);
+        for (int fd : {go[0], ready[0], ready[1], hold[0]}) ::close(fd);
+        ASSERT_EQ(taken, 2) << "round " << round;
+    }
+}
+
+TEST(Sync, SemaphoreInitializerDied) {
+    pid_t dead = ::fork();
+    if (dead == 0) ::_exit(0);
+    ::waitpid(dead, nullptr, 0);
+
+    // An opener won the race to initialize, then died before the count was set:
+    // init_ follows count_ and waiters_, and holds 0x80000000 | its pid.
+    ipc::shm::handle shm {"test-sem-init-dead", ipc::cache_line_size};
+    ASSERT_TRUE(shm.valid());
+    auto init = reinterpret_cast<std::atomic<std::uint32_t> *>(shm.get()) + 2;
+    init->store(0x80000000u | static_cast<std::uint32_t>(dead));
+
+    auto t0 = std::chrono::steady_clock::now();
+    ipc::sync::semaphore sem {"test-sem-init-dead", 1};
+    ASSERT_TRUE(sem.valid());
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(1));
+    EXPECT_TRUE(sem.wait(0));
+    EXPECT_FALSE(sem.wait(0));
+}
+
+TEST(Sync, RwMutexSlotsFull) {
+    ipc::sync::rw_mutex lock {"test-rw-mutex-full"};
+    ASSERT_TRUE(lock.valid());
+
+    int hold[2], ready[2];
+    ASSERT_EQ(::pipe(hold), 0);
+    ASSERT_EQ(::pipe(ready), 0);
+    std::vector<pid_t> children;
+    for (int i = 0; i < 64; ++i) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(hold[1]);
+            ipc::sync::rw_mutex lock {"test-rw-mutex-full"};
+            char c = lock.lock_shared(1000) ? 1 : 0;
+            if (::write(ready[1], &c, 1) != 1) ::_exit(1);
+            ::read(hold[0], &c, 1); // returns once the parent closes the pipe
+            ::_exit(0);
+        }
+        children.push_back(pid);
+    }
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        char c = 0;
+        ASSERT_EQ(::read(ready[0], &c, 1), 1);
+        ASSERT_EQ(c, 1);
+    }
+    // No writer is present, so a full table fails at once rather than spinning.
+    auto t0 = std::chrono::steady_clock::now();
+    EXPECT_FALSE(lock.lock_shared());
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(1));
+
+    ::close(hold[1]);
+    for (auto pid : children) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    }
+    ::close(hold[0]);
+    ::close(ready[0]);
+    ::close(ready[1]);
+    EXPECT_TRUE(lock.lock_shared(1000));
+    EXPECT_TRUE(lock.unlock_shared());
+}
+
+TEST(Sync, RwMutexThreadsShareSlot) {
+    ipc::sync::rw_mutex lock {"test-rw-mutex-share"};
+    ASSERT_TRUE(lock.valid());
+
+    // Threads of this process hold shared locks at once, taking a single slot,
+    // which leaves the other 63 for one reader process each.
+    constexpr int thread_count = 16;
+    std::atomic<int> held {0};
+    std::atomic<bool> quit {false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&] {
+            ipc::sync::rw_mutex lock {"test-rw-mutex-share"};
+            if (!lock.lock_shared(1000)) return;
+            ++held;
+            while (!quit.load()) std::this_thread::yield();
+            lock.unlock_shared();
+        });
+    }
+    while (held.load() < thread_count) std::this_thread::yield();
+
+    int hold[2], ready[2];
+    ASSERT_EQ(::pipe(hold), 0);
+    ASSERT_EQ(::pipe(ready), 0);
+    std::vector<pid_t> children;
+    for (int i = 0; i < 63; ++i) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(hold[1]);
+            ipc::sync::rw_mutex lock {"test-rw-mutex-share"};
+            char c = lock.lock_shared(1000) ? 1 : 0;
+            if (::write(ready[1], &c, 1) != 1) ::_exit(1);
+            ::read(hold[0], &c, 1); // returns once the parent closes the pipe
+            if (c) lock.unlock_shared();
+            ::_exit(0);
+        }
+        children.push_back(pid);
+    }
+    int entered = 0;
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        char c = 0;
+        ASSERT_EQ(::read(ready[0], &c, 1), 1);
+        entered += c;
+    }
+    EXPECT_EQ(entered, 63);
+
+    ::close(hold[1]);
+    for (auto pid : children) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    }
+    ::close(hold[0]);
+    ::close(ready[0]);
+    ::close(ready[1]);
+    quit = true;
+    for (auto &t : threads) t.join();
+    EXPECT_TRUE(lock.lock(1000));
+    EXPECT_TRUE(lock.unlock());
+}
+
+TEST(Sync, RwMutexDeadSlotsBehindLive) {
+    ipc::sync::rw_mutex lock {"test-rw-mutex-dead"};
+    ASSERT_TRUE(lock.valid());
+
+    int hold[2];
+    ASSERT_EQ(::pipe(hold), 0);
+    pid_t live = ::fork();
+    if (live == 0) {
+        ::close(hold[1]);
+        char c;
+        ::read(hold[0], &c, 1); // returns once the parent closes the pipe
+        ::_exit(0);
+    }
+    pid_t dead = ::fork();
+    if (dead == 0) ::_exit(0);
+    ::waitpid(dead, nullptr, 0);
+
+    // The first slot belongs to a live reader, every other one to a dead reader.
+    // Slots follow the writer word, one cache line each.
+    ipc::shm::handle shm {"test-rw-mutex-dead", ipc::cache_line_size * 65};
+    ASSERT_TRUE(shm.valid());
+    auto base = static_cast<char *>(shm.get());
+    auto slot = [base](std::size_t i) -> std::atomic<std::uint64_t> & {
+        return *reinterpret_cast<std::atomic<std::uint64_t> *>(base + (i + 1) * ipc::cache_line_size);
+    };
+    slot(0).store((static_cast<std::uint64_t>(live) << 32) | 1);
+    for (std::size_t i = 1; i < 64; ++i) {
+        slot(i).store((static_cast<std::uint64_t>(dead) << 32) | 1);
+    }
+
+    EXPECT_TRUE(lock.try_lock_shared());
+    EXPECT_TRUE(lock.unlock_shared());
+
+    ::close(hold[1]);
+    ::waitpid(live, nullptr, 0);
+    ::close(hold[0]);
+    EXPECT_TRUE(lock.lock(1000));
+    EXPECT_TRUE(lock.unlock());
+}
+#endif // IPC_OS_LINUX_
+
 #include "libipc/condition.h"
 
 TEST(Sync, Condition) {
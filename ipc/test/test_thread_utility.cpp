@@ -11,6 +11,8 @@
 #include "capo/type_name.hpp"
 
 #include "libipc/rw_lock.h"
+#include "libipc/rw_mutex.h"
+#include "libipc/mutex.h"
 
 #include "test.h"
 #include "thread_pool.h"
@@ -31,6 +33,14 @@ struct lc_wrapper : Mutex {
     void unlock_shared() { Mutex::unlock(); }
 };
 
+struct shm_mutex : ipc::sync::mutex {
+    shm_mutex() : ipc::sync::mutex("test-mutex-benchmark") {}
+};
+
+struct shm_rw_mutex : ipc::sync::rw_mutex {
+    shm_rw_mutex() : ipc::sync::rw_mutex("test-rw-mutex-benchmark") {}
+};
+
 template <typename Lc, int Loops = LoopCount>
 void benchmark_lc(int w, int r, char const * message) {
     ipc_ut::sender().start(static_cast<std::size_t>(w));
@@ -80,6 +90,13 @@ void test_lock_performance(int w, int r) {
     // benchmark_lc<std::shared_mutex          >(w, r, "std::shared_mutex");
 }
 
+void test_shm_lock_performance(int w, int r) {
+    std::cout << "test_shm_lock_performance: [" << w << "-" << r << "]" << std::endl;
+    benchmark_lc<ipc::rw_lock          , LoopCount / 10>(w, r, "ipc::rw_lock");
+    benchmark_lc<shm_rw_mutex          , LoopCount / 10>(w, r, "ipc::sync::rw_mutex");
+    benchmark_lc<lc_wrapper<shm_mutex> , LoopCount / 10>(w, r, "ipc::sync::mutex");
+}
+
 } // internal-linkage
 
 //TEST(Thread, rw_lock) {
@@ -88,6 +105,12 @@ void test_lock_performance(int w, int r) {
 //    for (int i = 2; i <= ThreadMax; ++i) test_lock_performance(i, i);
 //}
 
+TEST(Thread, DISABLED_rw_mutex) {
+    test_shm_lock_performance(1, 1);
+    test_shm_lock_performance(1, ThreadMax);
+    test_shm_lock_performance(2, ThreadMax / 2);
+}
+
 #if 0 // disable ipc::tls
 TEST(Thread, tls_main_thread) {
     ipc::tls::pointer<int> p;
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "libipc/trace.h"
+#include "libipc/shm.h"
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include "libipc/platform/win/process.h"
+#else
+#include "libipc/platform/posix/process.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "test.h"
+
+namespace {
+
+using namespace ipc::trace;
+
+ring const *open_ring(ipc::shm::handle &shm) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%u", ring_prefix, ipc::detail::curr_pid());
+    if (!shm.acquire(name, sizeof(ring), ipc::shm::open)) return nullptr;
+    return static_cast<ring const *>(shm.get());
+}
+
+TEST(Trace, emit) {
+    emit(event::send_force_push, 1, 2, 3);
+    ipc::shm::handle shm;
+    auto r = open_ring(shm);
+    ASSERT_NE(r, nullptr);
+
+    auto cursor = r->cursor_.load(std::memory_order_acquire);
+    emit(event::recv_bad_size, to_arg(-1));
+    ASSERT_EQ(r->cursor_.load(std::memory_order_acquire), cursor + 1);
+    auto const &rec = r->records_[cursor & (record_count - 1)];
+    EXPECT_EQ(rec.seq_.load(std::memory_order_acquire), cursor + 1);
+    EXPECT_EQ(rec.event_, static_cast<std::uint32_t>(event::recv_bad_size));
+    EXPECT_EQ(static_cast<std::int64_t>(rec.args_[0]), -1);
+    EXPECT_STREQ(info_of(static_cast<event>(rec.event_)).name, "recv_bad_size");
+}
+
+TEST(Trace, concurrent) {
+    ipc::shm::handle shm;
+    emit(event::none);
+    auto r = open_ring(shm);
+    ASSERT_NE(r, nullptr);
+
+    constexpr std::uint64_t loops = record_count / 8;
+    auto cursor = r->cursor_.load(std::memory_order_acquire);
+    std::vector<std::thread> threads;
+    for (std::uint64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (std::uint64_t i = 0; i < loops; ++i) emit(event::queue_force_push, t, i);
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    ASSERT_EQ(r->cursor_.load(std::memory_order_acquire), cursor + loops * 4);
+    std::uint64_t seen[4] {};
+    for (auto idx = cursor; idx < cursor + loops * 4; ++idx) {
+        auto const &rec = r->records_[idx & (record_count - 1)];
+        ASSERT_EQ(rec.seq_.load(std::memory_order_acquire), idx + 1);
+        ASSERT_LT(rec.args_[0], 4u);
+        EXPECT_EQ(rec.args_[1], seen[rec.args_[0]]++); // per-thread order is kept
+    }
+}
+
+#if !defined(IPC_OS_WINDOWS_)
+TEST(Trace, fork) {
+    emit(event::none);
+    ipc::shm::handle shm;
+    auto r = open_ring(shm);
+    ASSERT_NE(r, nullptr);
+    auto cursor = r->cursor_.load(std::memory_order_acquire);
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        emit(event::send_no_receiver);
+        // The child traces into a ring of its own.
+        ipc::shm::handle own;
+        auto c = open_ring(own);
+        bool ok = (c != nullptr) && (c != r) && (c->cursor_.load(std::memory_order_acquire) == 1);
+        // Runs the exit handler inherited from the parent, but not the destructors
+        // of statics that may wait for threads the child doesn't have.
+        std::quick_exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    EXPECT_EQ(r->cursor_.load(std::memory_order_acquire), cursor);
+
+    // The child's exit neither removed our ring nor left its own behind.
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%u", ring_prefix, static_cast<unsigned>(pid));
+    ipc::shm::handle child;
+    EXPECT_FALSE(child.acquire(name, sizeof(ring), ipc::shm::open));
+    emit(event::none);
+    EXPECT_EQ(r->cursor_.load(std::memory_order_acquire), cursor + 1);
+}
+#endif
+
+} // internal-linkage
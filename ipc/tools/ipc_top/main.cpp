@@ -0,0 +1,296 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "libipc/ipc.h"
+#include "libipc/ipc.inc"   // the message and chunk layouts of the channels
+
+namespace {
+
+/*
+ * Everything is mapped PROT_READ and only ever loaded from:
+ * no lock is taken and nothing is written, so the tool cannot slow down
+ * or disturb the processes it watches. The figures are therefore
+ * snapshots that may be slightly inconsistent with each other.
+*/
+
+constexpr char const shm_dir[]    = "/dev/shm";
+constexpr char const shm_prefix[] = "__IPC_SHM__";
+constexpr char const que_prefix[] = "__QU_CONN__";
+constexpr char const chk_prefix[] = "__CHUNK_INFO__";
+
+using ssu_t = ipc::wr<ipc::relat::single, ipc::relat::single, ipc::trans::unicast  >;
+using smb_t = ipc::wr<ipc::relat::single, ipc::relat::multi , ipc::trans::broadcast>;
+using mmb_t = ipc::wr<ipc::relat::multi , ipc::relat::multi , ipc::trans::broadcast>;
+
+template <typename Flag>
+using elems_of = typename ipc::detail::channel_impl::detail_impl<
+                          ipc::policy::choose<ipc::circ::elem_array, Flag>>::queue_t::elems_t;
+
+/* The size of the file behind a shm::handle of 'size' bytes (see shm_posix.cpp). */
+constexpr std::size_t shm_file_size(std::size_t size) noexcept {
+    return ipc::make_align(alignof(std::atomic<std::int32_t>), size) + sizeof(std::atomic<std::int32_t>);
+}
+
+void usage() {
+    std::printf("usage: ipc_top [-i ms] [-n count] [filter]\n"
+                "  Shows the libipc channels and chunk storages found in %s.\n"
+                "  -i  refresh interval, default 1000 ms\n"
+                "  -n  number of refreshes, default 0 (until interrupted)\n"
+                "  filter: only show channels whose name contains it\n", shm_dir);
+}
+
+struct stats_t {
+    std::uint32_t receivers = 0;
+    ipc::circ::cc_t cc      = 0;    // receiver bitmap (broadcast only)
+    std::uint32_t write     = 0;    // writer index
+    std::uint32_t lag[32]   = {};   // unread messages, per receiver bit
+    std::uint32_t max_lag   = 0;
+};
+
+/* Counts, per connected receiver, the elements it has not read yet. */
+template <typename Elems, typename F>
+void count_unread(Elems const * el, stats_t & st, F && unread_bits) {
+    for (std::size_t i = 0; i < Elems::elem_max; ++i) {
+        ipc::circ::cc_t bits = unread_bits(el->block()[i]) & st.cc;
+        for (unsigned b = 0; bits != 0; ++b, bits >>= 1) {
+            if (bits & 1u) ++st.lag[b];
+        }
+    }
+    for (unsigned b = 0; b < 32; ++b) {
+        if (st.lag[b] > st.max_lag) st.max_lag = st.lag[b];
+    }
+}
+
+stats_t inspect(elems_of<ssu_t> const * el) {
+    stats_t st;
+    st.receivers = static_cast<std::uint32_t>(el->connections(std::memory_order_relaxed));
+    st.write     = el->head().wt_.load(std::memory_order_relaxed);
+    st.max_lag   = ipc::circ::index_of(st.write - el->head().rd_.load(std::memory_order_relaxed));
+    return st;
+}
+
+/*
+ * A route (single writer) and a channel (multi writers) are told apart by
+ * nothing in their segment: name and size are the same. Their layouts agree
+ * on what is shown here, the write index leads the header and the low
+ * 32 bits of each read-counter are the receivers yet to read it,
+ * so both are read as a channel.
+*/
+static_assert(sizeof(elems_of<smb_t>) == sizeof(elems_of<mmb_t>), "route and channel segments differ in size");
+static_assert(std::uint64_t(elems_of<smb_t>::policy_t::ep_mask) == std::uint64_t(elems_of<mmb_t>::policy_t::rc_mask), "read-counter layouts differ");
+static_assert(sizeof(elems_of<ssu_t>) != sizeof(elems_of<mmb_t>), "unicast and broadcast segments have the same size");
+
+stats_t inspect(elems_of<mmb_t> const * el) {
+    using policy_t = elems_of<mmb_t>::policy_t;
+    stats_t st;
+    st.cc        = el->connections(std::memory_order_relaxed);
+    st.receivers = static_cast<std::uint32_t>(el->conn_count(std::memory_order_relaxed));
+    st.write     = el->head().ct_.load(std::memory_order_relaxed);
+    count_unread(el, st, [](auto const & e) {
+        return static_cast<ipc::circ::cc_t>(e.rc_.load(std::memory_order_relaxed) & policy_t::rc_mask);
+    });
+    return st;
+}
+
+/* How many chunks of a storage are in use. */
+std::size_t chunks_used(ipc::detail::channel_impl::chunk_info_t const * info) {
+    auto const & pool = info->pool_;
+    if (pool.invalid()) return 0; // never used
+    return ipc::id_pool<>::max_count - pool.free_count();
+}
+
+#if !defined(_WIN32)
+
+struct mapping_t {
+    void const *  mem_  = nullptr;
+    std::size_t   size_ = 0;
+    dev_t         dev_  = 0;    // the file mapped: a segment removed and recreated
+    ino_t         ino_  = 0;    // under the same name gets a new inode
+
+    // for the message rate
+    std::uint32_t last_write_ = 0;
+    std::chrono::steady_clock::time_point last_ts_;
+    bool seen_ = false;
+};
+
+bool map_file(std::string const & file, mapping_t & m) {
+    int fd = ::open((std::string{shm_dir} + "/" + file).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if ((::fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        ::close(fd);
+        return false;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    if ((m.mem_ != nullptr) && (m.size_ == size) && (m.dev_ == st.st_dev) && (m.ino_ == st.st_ino)) {
+        ::close(fd);
+        return true;
+    }
+    if (m.mem_ != nullptr) {
+        ::munmap(const_cast<void *>(m.mem_), m.size_);
+        m.seen_ = false; // a new segment, the rate starts over
+    }
+    m.mem_ = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m.mem_ == MAP_FAILED) {
+        m.mem_ = nullptr;
+        return false;
+    }
+    m.size_ = size;
+    m.dev_  = st.st_dev;
+    m.ino_  = st.st_ino;
+    return true;
+}
+
+void unmap(mapping_t & m) {
+    if (m.mem_ != nullptr) ::munmap(const_cast<void *>(m.mem_), m.size_);
+    m.mem_ = nullptr;
+}
+
+std::vector<std::string> list_files(char const * prefix) {
+    std::vector<std::string> names;
+    std::string pre = std::string{shm_prefix} + prefix;
+    auto dir = ::opendir(shm_dir);
+    if (dir == nullptr) return names;
+    while (auto ent = ::readdir(dir)) {
+        if (std::strncmp(ent->d_name, pre.c_str(), pre.size()) == 0) {
+            names.emplace_back(ent->d_name);
+        }
+    }
+    ::closedir(dir);
+    return names;
+}
+
+/* "__IPC_SHM____QU_CONN__<data size>__<align>__<name>" -> "<name>" */
+std::string channel_name(std::string const & file) {
+    auto pos = std::strlen(shm_prefix) + std::strlen(que_prefix);
+    for (int i = 0; (i < 2) && (pos != std::string::npos); ++i) {
+        pos = file.find("__", pos);
+        if (pos != std::string::npos) pos += 2;
+    }
+    return (pos == std::string::npos) ? file : file.substr(pos);
+}
+
+bool inspect_file(mapping_t const & m, stats_t & st) {
+    if      (m.size_ == shm_file_size(sizeof(elems_of<mmb_t>))) st = inspect(static_cast<elems_of<mmb_t> const *>(m.mem_));
+    else if (m.size_ == shm_file_size(sizeof(elems_of<ssu_t>))) st = inspect(static_cast<elems_of<ssu_t> const *>(m.mem_));
+    else return false;
+    return true;
+}
+
+void show_channels(std::map<std::string, mapping_t> & maps, char const * filter) {
+    std::printf("%-32s %4s %-10s %10s %10s %5s %5s  %s\n",
+                "CHANNEL", "RECV", "CC", "WRITE", "MSG/s", "OCC%", "LAG", "LAG PER RECEIVER");
+    auto files = list_files(que_prefix);
+    std::sort(files.begin(), files.end());
+    // forget the segments that are gone
+    for (auto it = maps.begin(); it != maps.end();) {
+        if (std::find(files.begin(), files.end(), it->first) == files.end()) {
+            unmap(it->second);
+            it = maps.erase(it);
+        }
+        else ++it;
+    }
+    for (auto const & file : files) {
+        auto name = channel_name(file);
+        if ((filter != nullptr) && (name.find(filter) == std::string::npos)) continue;
+        auto & m = maps[file];
+        stats_t st;
+        if (!map_file(file, m) || !inspect_file(m, st)) {
+            std::printf("%-32s (unknown layout, %zd bytes)\n", name.c_str(), m.size_);
+            continue;
+        }
+        auto now  = std::chrono::steady_clock::now();
+        double rate = 0;
+        if (m.seen_) {
+            auto sec = std::chrono::duration<double>(now - m.last_ts_).count();
+            if (sec > 0) rate = double(st.write - m.last_write_) / sec; // unsigned wrap is fine
+        }
+        m.last_write_ = st.write;
+        m.last_ts_    = now;
+        m.seen_       = true;
+
+        char lags[32 * 12] {};
+        std::size_t off = 0;
+        for (unsigned b = 0; (b < 32) && (off < sizeof(lags) - 12); ++b) {
+            if (st.cc & (1u << b)) {
+                off += static_cast<std::size_t>(std::snprintf(lags + off, sizeof(lags) - off, "#%u:%u ", b, st.lag[b]));
+            }
+        }
+        std::printf("%-32s %4u 0x%08x %10u %10.0f %5.1f %5u  %s\n",
+                    name.c_str(), st.receivers, st.cc, st.write, rate,
+                    100.0 * double(st.max_lag) / double(elems_of<mmb_t>::elem_max),
+                    st.max_lag, lags);
+    }
+}
+
+void show_chunks(std::map<std::string, mapping_t> & maps) {
+    using ipc::detail::channel_impl::chunk_info_t;
+    auto files = list_files(chk_prefix);
+    if (files.empty()) return;
+    auto skip = std::strlen(shm_prefix) + std::strlen(chk_prefix);
+    std::sort(files.begin(), files.end(), [skip](std::string const & a, std::string const & b) {
+        return std::strtoull(a.c_str() + skip, nullptr, 10) < std::strtoull(b.c_str() + skip, nullptr, 10);
+    });
+    std::printf("\n%-12s %6s %6s\n", "CHUNK SIZE", "USED", "MAX");
+    for (auto const & file : files) {
+        auto & m = maps[file];
+        if (!map_file(file, m) || (m.size_ < sizeof(chunk_info_t))) continue;
+        auto size = file.substr(skip);
+        std::printf("%-12s %6zd %6zd\n", size.c_str(),
+                    chunks_used(static_cast<chunk_info_t const *>(m.mem_)),
+                    static_cast<std::size_t>(ipc::id_pool<>::max_count));
+    }
+}
+
+#endif/*!_WIN32*/
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    unsigned interval = 1000;
+    unsigned count    = 0;
+    char const * filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if      ((std::strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) interval = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if ((std::strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) count    = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "-h") == 0) { usage(); return 0; }
+        else filter = argv[i];
+    }
+#if defined(_WIN32)
+    (void)interval; (void)count; (void)filter;
+    std::printf("ipc_top needs a /dev/shm, it is not available on this platform.\n");
+    return -1;
+#else
+    bool tty = ::isatty(STDOUT_FILENO) != 0;
+    std::map<std::string, mapping_t> que_maps, chk_maps;
+    for (unsigned n = 0; (count == 0) || (n < count); ++n) {
+        if (n > 0) std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+        if (tty && (count != 1)) std::printf("\033[H\033[2J"); // redraw in place
+        show_channels(que_maps, filter);
+        show_chunks(chk_maps);
+        std::fflush(stdout);
+    }
+    for (auto & m : que_maps) unmap(m.second);
+    for (auto & m : chk_maps) unmap(m.second);
+    return 0;
+#endif
+}
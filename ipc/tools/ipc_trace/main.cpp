@@ -0,0 +1,184 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "libipc/shm.h"
+#include "libipc/trace.h"
+
+namespace {
+
+using namespace ipc::trace;
+
+constexpr char const shm_dir[]    = "/dev/shm";
+constexpr char const shm_prefix[] = "__IPC_SHM__";
+
+void usage() {
+    std::printf("usage: ipc_trace [-f] [-r] [pid ...]\n"
+                "  Decodes the libipc trace rings of the given processes.\n"
+                "  Without pid, lists the trace rings found on this machine.\n"
+                "  -f  follow: keep printing new records until interrupted\n"
+                "  -r  remove the rings after decoding\n");
+}
+
+std::vector<std::string> list_rings() {
+    std::vector<std::string> names;
+#if !defined(_WIN32)
+    std::string prefix = std::string(shm_prefix) + ring_prefix;
+    auto dir = ::opendir(shm_dir);
+    if (dir == nullptr) return names;
+    while (auto ent = ::readdir(dir)) {
+        if (std::strncmp(ent->d_name, prefix.c_str(), prefix.size()) == 0) {
+            names.emplace_back(ent->d_name + std::strlen(shm_prefix));
+        }
+    }
+    ::closedir(dir);
+#endif
+    return names;
+}
+
+/*
+ * A ring is mapped PROT_READ straight from its file, like ipc_top does:
+ * attaching through shm::handle would bump the segment's ref count,
+ * and the owner would then no longer be the one to remove it.
+*/
+class ring_view {
+#if !defined(_WIN32)
+    void const * mem_  = nullptr;
+    std::size_t  size_ = 0;
+#else
+    ipc::shm::handle shm_;
+#endif
+
+public:
+    ring_view(ring_view const &) = delete;
+    ring_view &operator=(ring_view const &) = delete;
+
+    explicit ring_view(std::string const & name) {
+#if !defined(_WIN32)
+        int fd = ::open((std::string{shm_dir} + "/" + shm_prefix + name).c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if ((::fstat(fd, &st) == 0) && (static_cast<std::size_t>(st.st_size) >= sizeof(ring))) {
+            auto mem = ::mmap(nullptr, sizeof(ring), PROT_READ, MAP_SHARED, fd, 0);
+            if (mem != MAP_FAILED) {
+                mem_  = mem;
+                size_ = sizeof(ring);
+            }
+        }
+        ::close(fd);
+#else
+        shm_.acquire(name.c_str(), sizeof(ring), ipc::shm::open);
+#endif
+    }
+
+    ~ring_view() {
+#if !defined(_WIN32)
+        if (mem_ != nullptr) ::munmap(const_cast<void *>(mem_), size_);
+#endif
+    }
+
+    ring const * get() const noexcept {
+#if !defined(_WIN32)
+        return static_cast<ring const *>(mem_);
+#else
+        return static_cast<ring const *>(shm_.get());
+#endif
+    }
+};
+
+bool read_record(ring const *r, std::uint64_t idx, record &out) {
+    auto &rec = r->records_[idx & (record_count - 1)];
+    auto seq = rec.seq_.load(std::memory_order_acquire);
+    if (seq != idx + 1) return false; // overwritten, or still being written
+    out.ts_    = rec.ts_;
+    out.event_ = rec.event_;
+    out.tid_   = rec.tid_;
+    for (std::size_t i = 0; i < args_max; ++i) out.args_[i] = rec.args_[i];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return rec.seq_.load(std::memory_order_relaxed) == seq;
+}
+
+void print_record(std::uint64_t idx, record const &rec, std::uint64_t ts0) {
+    auto const &inf = info_of(static_cast<event>(rec.event_));
+    char text[256];
+    std::snprintf(text, sizeof(text), inf.fmt, rec.args_[0], rec.args_[1], rec.args_[2], rec.args_[3]);
+    std::printf("%8llu [%+14.6f ms] tid %08x %-5s %-20s %s\n",
+                static_cast<unsigned long long>(idx),
+                double(rec.ts_ - ts0) / 1e6,
+                rec.tid_,
+                (inf.lev == level::error) ? "ERROR" : "LOG",
+                inf.name, text);
+}
+
+/// Prints records in [from, cursor), returns the new cursor.
+std::uint64_t dump(ring const *r, std::uint64_t from, std::uint64_t &ts0) {
+    auto cursor = r->cursor_.load(std::memory_order_acquire);
+    if (cursor > from + record_count) {
+        std::printf("... %llu records lost (ring wrapped)\n",
+                    static_cast<unsigned long long>(cursor - record_count - from));
+        from = cursor - record_count;
+    }
+    for (auto idx = from; idx < cursor; ++idx) {
+        record rec;
+        if (!read_record(r, idx, rec)) continue;
+        if (ts0 == 0) ts0 = rec.ts_;
+        print_record(idx, rec, ts0);
+    }
+    return cursor;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    bool follow = false, remove = false;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        if      (std::strcmp(argv[i], "-f") == 0) follow = true;
+        else if (std::strcmp(argv[i], "-r") == 0) remove = true;
+        else if (std::strcmp(argv[i], "-h") == 0) { usage(); return 0; }
+        else names.emplace_back(std::string(ring_prefix) + argv[i]);
+    }
+    if (names.empty()) {
+        auto rings = list_rings();
+        if (rings.empty()) std::printf("no trace ring found.\n");
+        for (auto const &n : rings) std::printf("%s\n", n.c_str() + std::strlen(ring_prefix));
+        return 0;
+    }
+    if (follow && (names.size() != 1)) {
+        std::printf("-f takes exactly one pid.\n");
+        return -1;
+    }
+
+    for (auto const &name : names) {
+        ring_view view {name};
+        auto r = view.get();
+        if (r == nullptr) {
+            std::printf("%s: no trace ring.\n", name.c_str());
+            continue;
+        }
+        std::printf("== %s ==\n", name.c_str());
+        std::uint64_t ts0 = 0;
+        auto cursor = dump(r, 0, ts0);
+        while (follow) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            cursor = dump(r, cursor, ts0);
+            std::fflush(stdout);
+        }
+        if (remove) ipc::shm::remove(name.c_str());
+    }
+    return 0;
+}
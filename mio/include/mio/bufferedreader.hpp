@@ -0,0 +1,556 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_BUFFERED_READER_H_
+#define _MIO_BUFFERED_READER_H_
+
+#include <mio/linescan.hpp>
+#include <mio/mio.hpp>
+#include <mio/stringreader.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+namespace mio {
+
+/**
+   How a BufferedReader reads its input.
+ */
+struct buffer_options
+{
+  // Bytes read at a time, into each of the two buffers.
+  size_t block_size = size_t{4} << 20;
+
+  // Read the next block on a helper thread while the current one is parsed,
+  // also from a handle the reader does not own, such as the standard input:
+  // a block read ahead is lost with the reader, as the rest of the current one.
+  bool prefetch = true;
+};
+
+/**
+   The handle of the standard input, for a BufferedReader to read from.
+ */
+inline file_handle_type stdin_handle() noexcept
+{
+#ifdef _WIN32
+  return ::GetStdHandle(STD_INPUT_HANDLE);
+#else
+  return STDIN_FILENO;
+#endif
+}
+
+namespace detail {
+
+/**
+   Whether a_handle is a file that can be memory mapped: a regular, non-empty
+   one. Pipes, FIFOs, terminals and sockets are not; neither are the files of
+   /proc, which report a size of 0 whatever they hold.
+ */
+inline bool is_mappable(file_handle_type a_handle) noexcept
+{
+#ifdef _WIN32
+  if (::GetFileType(a_handle) != FILE_TYPE_DISK) return false;
+  LARGE_INTEGER l_size;
+  return ::GetFileSizeEx(a_handle, &l_size) != 0 && l_size.QuadPart > 0;
+#else
+  struct stat l_stat;
+  return ::fstat(a_handle, &l_stat) == 0 && S_ISREG(l_stat.st_mode) && l_stat.st_size > 0;
+#endif
+}
+
+/**
+   Reads from a_handle into a_buffer until a read brings in a newline, a_size
+   bytes are read or the input ends; a pipe hands out a few pages per read,
+   and an interactive writer a line or so.
+
+   Outside Windows, a_cancel, if valid, is the read end of a pipe: once it
+   becomes readable the read stops with std::errc::operation_canceled. On
+   Windows a read is cancelled with CancelSynchronousIo instead.
+
+   \returns The number of bytes read, 0 only at end of input or on error.
+ */
+inline size_t read_block(file_handle_type a_handle, char *a_buffer, size_t a_size,
+                         std::error_code &a_error,
+                         file_handle_type a_cancel = invalid_handle) noexcept
+{
+  a_error.clear();
+  size_t l_read{0};
+  while (l_read < a_size) {
+#ifdef _WIN32
+    (void)a_cancel;
+    const auto l_want = static_cast<DWORD>(std::min<size_t>(a_size - l_read, 1u << 30));
+    DWORD l_got{0};
+    if (::ReadFile(a_handle, a_buffer + l_read, l_want, &l_got, nullptr) == 0) {
+      // The writer of a pipe has closed it: end of input.
+      if (::GetLastError() == ERROR_OPERATION_ABORTED) a_error = std::make_error_code(std::errc::operation_canceled);
+      else if (::GetLastError() != ERROR_BROKEN_PIPE) a_error = last_error();
+      break;
+    }
+#else
+    if (a_cancel != invalid_handle) {
+      pollfd l_fds[2] = {{a_handle, POLLIN, 0}, {a_cancel, POLLIN, 0}};
+      if (::poll(l_fds, 2, -1) < 0) {
+        if (errno == EINTR) continue;
+        a_error = last_error();
+        break;
+      }
+      if (l_fds[1].revents != 0) {
+        a_error = std::make_error_code(std::errc::operation_canceled);
+        break;
+      }
+    }
+    const auto l_got = ::read(a_handle, a_buffer + l_read, a_size - l_read);
+    if (l_got < 0) {
+      if (errno == EINTR) continue;
+      a_error = last_error();
+      break;
+    }
+#endif
+    if (l_got == 0) break;
+    const char *l_first = a_buffer + l_read;
+    l_read += static_cast<size_t>(l_got);
+    // Whole lines to hand out: don't wait for the rest of the block.
+    if (find_newline(l_first, a_buffer + l_read) != a_buffer + l_read) break;
+  }
+  return l_read;
+}
+
+/**
+   The input and the two buffers of a BufferedReader, shared with its helper
+   thread. The helper may be blocked in a read when the reader goes away: the
+   reader then cancels the read and joins it.
+ */
+struct read_ahead
+{
+  struct buffer
+  {
+    std::vector<char> bytes;
+    size_t headroom{0}; // room before the data, for the end of the previous block
+    size_t size{0};     // bytes read
+    std::error_code error;
+
+    char *data() noexcept
+    {
+      return bytes.data() + headroom;
+    }
+  };
+
+  read_ahead(file_handle_type a_handle, bool a_close, size_t a_block_size) :
+      handle{a_handle}, close{a_close}, block_size{a_block_size}
+  {
+    for (auto &l_buffer : buffers) {
+      l_buffer.headroom = std::min(a_block_size, size_t{64} << 10);
+      l_buffer.bytes.resize(l_buffer.headroom + a_block_size);
+    }
+  }
+
+  ~read_ahead()
+  {
+#ifndef _WIN32
+    for (const int l_fd : cancel) {
+      if (l_fd != invalid_handle) ::close(l_fd);
+    }
+#endif
+    if (!close || handle == invalid_handle) return;
+#ifdef _WIN32
+    ::CloseHandle(handle);
+#else
+    ::close(handle);
+#endif
+  }
+
+  void fill(size_t a_index) noexcept
+  {
+    auto &l_buffer = buffers[a_index];
+#ifdef _WIN32
+    l_buffer.size = read_block(handle, l_buffer.data(), block_size, l_buffer.error);
+#else
+    l_buffer.size = read_block(handle, l_buffer.data(), block_size, l_buffer.error, cancel[0]);
+#endif
+  }
+
+  /**
+     The helper thread: fills the buffer asked for, one at a time.
+   */
+  static void run(std::shared_ptr<read_ahead> a_self)
+  {
+    std::unique_lock l_lock{a_self->mutex};
+    for (;;) {
+      a_self->wake.wait(l_lock, [&] { return a_self->stop || a_self->request >= 0; });
+      if (a_self->stop) break;
+
+      const auto l_index = static_cast<size_t>(a_self->request);
+      l_lock.unlock();
+      a_self->fill(l_index);
+      l_lock.lock();
+
+      a_self->request = -1;
+      a_self->ready = true;
+      a_self->wake.notify_all();
+    }
+    a_self->exited = true;
+    a_self->wake.notify_all();
+  }
+
+  file_handle_type handle;
+  bool close;
+  size_t block_size;
+  std::array<buffer, 2> buffers;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  int request{-1}; // the buffer to fill next, -1 if none
+  bool ready{false};
+  bool stop{false};
+  bool exited{false};
+#ifndef _WIN32
+  int cancel[2]{invalid_handle, invalid_handle}; // a pipe, written to cancel a read
+#endif
+};
+
+} // namespace detail
+
+/**
+   A line reader for inputs that cannot be memory mapped: pipes, FIFOs,
+   /proc files, the standard input. The input is read a large block at a time
+   into one of two buffers, the next block into the other one, on a helper
+   thread while the current one is parsed if buffer_options::prefetch.
+   Destroying the reader cancels a read in progress on the helper thread and
+   waits for it, so a handle it does not own is left with nothing pending.
+
+   Input is still read a block at a time: the part of the blocks read that was
+   not handed out as lines is gone with the reader, also from a handle it does
+   not own.
+
+   getline behaves as StringReader::getline: lines are string_views into the
+   current block, with no copy; the end of a block that is not a whole line
+   is moved in front of the next block. A line is valid until the reader moves
+   on to the next block, which may be the next call to getline: copy what must
+   outlive it.
+
+   Example:
+
+     mio::BufferedReader reader(mio::stdin_handle());
+     while (!reader.eof()) {
+       auto line = reader.getline();
+       // ... do something about the line just read.
+     }
+ */
+class BufferedReader
+{
+public:
+  /**
+    Fires when a new line has been read.
+  */
+  using OnGetline = std::function<void(const std::string_view)>;
+
+  /**
+     Opens a_file to read it. If it cannot be opened, std::system_error is
+     thrown with the error code describing why.
+   */
+  explicit BufferedReader(const std::string &a_file, const buffer_options &a_options = {})
+  {
+    std::error_code l_error;
+    const auto l_handle = detail::open_file(a_file, access_mode::read, l_error);
+    if (l_error) throw std::system_error(l_error);
+    start(l_handle, true, a_options);
+  }
+
+  /**
+     Reads from the open a_handle, which is closed on destruction only if
+     a_close.
+   */
+  explicit BufferedReader(file_handle_type a_handle, const buffer_options &a_options = {},
+                          bool a_close = false)
+  {
+    start(a_handle, a_close, a_options);
+  }
+
+  BufferedReader() = delete;
+  BufferedReader(const BufferedReader &) = delete;
+  BufferedReader(BufferedReader &&) = delete;
+  BufferedReader &operator=(BufferedReader &) = delete;
+  BufferedReader &operator=(BufferedReader &&) = delete;
+
+  ~BufferedReader()
+  {
+    if (!m_helper.joinable()) return;
+    {
+      std::lock_guard l_lock{m_shared->mutex};
+      m_shared->stop = true;
+    }
+    m_shared->wake.notify_all();
+#ifdef _WIN32
+    {
+      // A cancel issued before the helper enters ReadFile is lost: repeat it.
+      std::unique_lock l_lock{m_shared->mutex};
+      while (!m_shared->wake.wait_for(l_lock, std::chrono::milliseconds(10), [&] { return m_shared->exited; })) {
+        ::CancelSynchronousIo(m_helper.native_handle());
+      }
+    }
+#else
+    const char l_byte{0};
+    while (::write(m_shared->cancel[1], &l_byte, 1) < 0 && errno == EINTR) {}
+#endif
+    m_helper.join();
+  }
+
+  /**
+     Checks whether the reader has reached end of file.
+
+     \returns True if end of line, false otherwise.
+   */
+  [[nodiscard]] bool eof() const noexcept
+  {
+    return (m_begin == nullptr);
+  }
+
+  /**
+     Reads a new line into a string view, valid until the reader moves on to
+     the next block. If the input cannot be read, std::system_error is thrown.
+
+     \returns A std::string_view, {nullptr, 0} will be returned if the reader has reached end of file.
+   */
+  std::string_view getline()
+  {
+    while (m_begin) {
+      const char *l_find = detail::find_newline(m_begin, m_end);
+
+      if (l_find != m_end) [[likely]] {
+        const std::string_view l_line{m_begin, static_cast<size_t>(l_find - m_begin)};
+        m_begin = std::next(l_find);
+        return l_line;
+      }
+
+      if (m_input_done) {
+        // Same as StringReader: an unterminated last line is not returned.
+        m_begin = nullptr;
+        break;
+      }
+      next_block();
+    }
+    return {nullptr, 0};
+  }
+
+  size_t getline(const OnGetline &a_on_getline)
+  {
+    size_t l_numlines{0};
+
+    while (!this->eof()) {
+      a_on_getline(this->getline());
+      l_numlines++;
+    }
+    return l_numlines;
+  }
+
+private:
+  void start(file_handle_type a_handle, bool a_close, const buffer_options &a_options)
+  {
+    m_shared = std::make_shared<detail::read_ahead>(a_handle, a_close, std::max(a_options.block_size, size_t{1}));
+
+    // Buffer 1 is the current, empty, block: the first getline moves on to
+    // buffer 0, which is being read already if prefetching.
+    m_current = 1;
+    m_begin = m_end = m_shared->buffers[1].data();
+    if (a_options.prefetch) {
+#ifndef _WIN32
+      if (::pipe(m_shared->cancel) != 0) throw std::system_error(detail::last_error());
+#endif
+      m_helper = std::thread{detail::read_ahead::run, m_shared};
+      request(0);
+    }
+  }
+
+  /**
+     Has the helper fill buffer a_index.
+   */
+  void request(size_t a_index)
+  {
+    {
+      std::lock_guard l_lock{m_shared->mutex};
+      m_shared->request = static_cast<int>(a_index);
+      m_shared->ready = false;
+    }
+    m_shared->wake.notify_all();
+  }
+
+  /**
+     Moves on to the other buffer, once filled, with [m_begin, m_end), the
+     unfinished line of the current one, copied in front of its data.
+   */
+  void next_block()
+  {
+    const size_t l_next = 1 - m_current;
+    auto &l_buffer = m_shared->buffers[l_next];
+
+    if (m_helper.joinable()) {
+      std::unique_lock l_lock{m_shared->mutex};
+      m_shared->wake.wait(l_lock, [&] { return m_shared->ready; });
+    } else {
+      m_shared->fill(l_next);
+    }
+    if (l_buffer.error) throw std::system_error(l_buffer.error);
+
+    const auto l_tail = static_cast<size_t>(m_end - m_begin);
+    if (l_tail > l_buffer.headroom) {
+      // A line longer than the headroom: make room for twice as long.
+      std::vector<char> l_bytes(2 * l_tail + m_shared->block_size);
+      std::memcpy(l_bytes.data() + 2 * l_tail, l_buffer.data(), l_buffer.size);
+      l_buffer.bytes.swap(l_bytes);
+      l_buffer.headroom = 2 * l_tail;
+    }
+    std::memcpy(l_buffer.data() - l_tail, m_begin, l_tail);
+
+    m_begin = l_buffer.data() - l_tail;
+    m_end = l_buffer.data() + l_buffer.size;
+    m_current = l_next;
+
+    // Only an empty block is the end: a short one may just be what was written so far.
+    m_input_done = l_buffer.size == 0;
+    if (!m_input_done && m_helper.joinable()) request(1 - l_next);
+  }
+
+private:
+  std::shared_ptr<detail::read_ahead> m_shared;
+  std::thread m_helper;
+  size_t m_current{0};
+  const char *m_begin{nullptr}; // the cursor, nullptr at end of file
+  const char *m_end{nullptr};
+  bool m_input_done{false};
+};
+
+/**
+   A line reader on any input: a regular file is memory mapped and read with
+   a StringReader; anything else, or "-" for the standard input, is read with
+   a BufferedReader.
+
+   Example:
+
+     mio::LineReader reader(argc > 1 ? argv[1] : "-");
+     while (!reader.eof()) {
+       auto line = reader.getline();
+       // ... do something about the line just read.
+     }
+ */
+class LineReader
+{
+public:
+  /**
+    Fires when a new line has been read.
+  */
+  using OnGetline = std::function<void(const std::string_view)>;
+
+  /**
+     Opens a_file, or takes the standard input if a_file is "-". If the file
+     cannot be opened, std::system_error is thrown with the error code
+     describing why.
+
+     \param   a_file     The file to read.
+     \param   a_options  How to read it if it cannot be mapped.
+   */
+  explicit LineReader(const std::string &a_file, const buffer_options &a_options = {})
+  {
+    if (a_file == "-") {
+      m_buffered.emplace(stdin_handle(), a_options);
+      return;
+    }
+
+    std::error_code l_error;
+    const auto l_handle = detail::open_file(a_file, access_mode::read, l_error);
+    if (l_error) throw std::system_error(l_error);
+
+    if (!detail::is_mappable(l_handle)) {
+      // Keep the handle: a FIFO cannot be opened a second time to the same writer.
+      m_buffered.emplace(l_handle, a_options, true);
+      return;
+    }
+
+#ifdef _WIN32
+    ::CloseHandle(l_handle);
+#else
+    ::close(l_handle);
+#endif
+    m_mapped.emplace(a_file);
+  }
+
+  LineReader() = delete;
+  LineReader(const LineReader &) = delete;
+  LineReader(LineReader &&) = delete;
+  LineReader &operator=(LineReader &) = delete;
+  LineReader &operator=(LineReader &&) = delete;
+
+  /**
+     Checks whether the input is read from a memory mapping, in which case
+     lines stay valid for the life of the reader.
+   */
+  [[nodiscard]] bool is_mapped() const noexcept
+  {
+    return m_mapped.has_value();
+  }
+
+  /**
+     Checks whether the reader has reached end of file.
+
+     \returns True if end of line, false otherwise.
+   */
+  [[nodiscard]] bool eof() const noexcept
+  {
+    return m_mapped ? m_mapped->eof() : m_buffered->eof();
+  }
+
+  /**
+     Reads a new line into a string view, see StringReader::getline and
+     BufferedReader::getline.
+
+     \returns A std::string_view, {nullptr, 0} will be returned if the reader has reached end of file.
+   */
+  std::string_view getline()
+  {
+    return m_mapped ? m_mapped->getline() : m_buffered->getline();
+  }
+
+  size_t getline(const OnGetline &a_on_getline)
+  {
+    return m_mapped ? m_mapped->getline(a_on_getline) : m_buffered->getline(a_on_getline);
+  }
+
+private:
+  std::optional<StringReader> m_mapped;
+  std::optional<BufferedReader> m_buffered;
+};
+
+}
+
+#endif
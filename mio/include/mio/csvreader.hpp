@@ -0,0 +1,580 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_CSV_READER_H_
+#define _MIO_CSV_READER_H_
+
+#include <mio/linescan.hpp>
+#include <mio/mio.hpp>
+#include <mio/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mio {
+
+/**
+   The dialect of a delimited file.
+ */
+struct csv_options
+{
+  // ',' for CSV, '\t' for TSV.
+  char delimiter = ',';
+
+  // Fields may be enclosed in quotes; inside, a doubled quote stands for one
+  // and delimiters and newlines are plain text.
+  char quote = '"';
+
+  // The first row holds the column names.
+  bool header = false;
+};
+
+/**
+   Parses a field in place: arithmetic types with std::from_chars, string_view
+   as is (pointing into the mapping), std::string unescaped, a doubled
+   a_options.quote standing for one. Leading and trailing blanks around a
+   number are ignored.
+
+   \returns False if the field is not a complete value of type T; a_value is
+            then left untouched.
+ */
+template<typename T>
+bool parse_field(std::string_view a_field, T &a_value, const csv_options &a_options)
+{
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    a_value = a_field;
+    return true;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    const char l_quote = a_options.quote;
+    a_value.clear();
+    for (size_t i = 0; i < a_field.size(); i++) {
+      a_value += a_field[i];
+      // A doubled quote inside a quoted field stands for one.
+      if (a_field[i] == l_quote && i + 1 < a_field.size() && a_field[i + 1] == l_quote) i++;
+    }
+    return true;
+  } else {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                  "parse_field supports numbers and strings.");
+    const auto l_blank = [](char c) { return c == ' ' || c == '\t'; };
+    while (!a_field.empty() && l_blank(a_field.front())) a_field.remove_prefix(1);
+    while (!a_field.empty() && l_blank(a_field.back())) a_field.remove_suffix(1);
+    if (!a_field.empty() && a_field.front() == '+') a_field.remove_prefix(1);
+
+    T l_value{};
+    const auto [l_end, l_error] = std::from_chars(a_field.data(), a_field.data() + a_field.size(), l_value);
+    if (l_error != std::errc{} || l_end != a_field.data() + a_field.size() || a_field.empty()) return false;
+    a_value = l_value;
+    return true;
+  }
+}
+
+/**
+   Same as above, for the default dialect: '"' quotes.
+ */
+template<typename T>
+bool parse_field(std::string_view a_field, T &a_value)
+{
+  return parse_field(a_field, a_value, csv_options{});
+}
+
+namespace detail {
+
+/**
+   Delimiter, quote and newline bits of a 64-byte block.
+ */
+struct csv_masks
+{
+  uint64_t delimiter;
+  uint64_t quote;
+  uint64_t newline;
+};
+
+using csv_mask_scan = void (*)(const char *a_block, char a_delimiter, char a_quote,
+                               csv_masks &a_masks) noexcept;
+
+inline void csv_masks_scalar(const char *a_block, char a_delimiter, char a_quote,
+                             csv_masks &a_masks) noexcept
+{
+  a_masks = {};
+  for (unsigned i = 0; i < 64; i++) {
+    const uint64_t l_bit = uint64_t{1} << i;
+    if (a_block[i] == a_delimiter) a_masks.delimiter |= l_bit;
+    if (a_block[i] == a_quote) a_masks.quote |= l_bit;
+    if (a_block[i] == '\n') a_masks.newline |= l_bit;
+  }
+}
+
+#if defined(MIO_SIMD_X86) || defined(MIO_SIMD_SSE2_ONLY)
+
+#ifdef MIO_SIMD_X86
+__attribute__((target("sse2")))
+#endif
+inline void csv_masks_sse2(const char *a_block, char a_delimiter, char a_quote,
+                           csv_masks &a_masks) noexcept
+{
+  const __m128i l_delimiter = _mm_set1_epi8(a_delimiter);
+  const __m128i l_quote = _mm_set1_epi8(a_quote);
+  const __m128i l_newline = _mm_set1_epi8('\n');
+  a_masks = {};
+  for (unsigned i = 0; i < 4; i++) {
+    const __m128i l_chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_block + 16 * i));
+    a_masks.delimiter |= static_cast<uint64_t>(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(l_chunk, l_delimiter)))) << (16 * i);
+    a_masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(l_chunk, l_quote)))) << (16 * i);
+    a_masks.newline |= static_cast<uint64_t>(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(l_chunk, l_newline)))) << (16 * i);
+  }
+}
+
+#endif
+
+#ifdef MIO_SIMD_X86
+
+__attribute__((target("avx2")))
+inline void csv_masks_avx2(const char *a_block, char a_delimiter, char a_quote,
+                           csv_masks &a_masks) noexcept
+{
+  const __m256i l_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_block));
+  const __m256i l_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_block + 32));
+  const __m256i l_chars[3] = {_mm256_set1_epi8(a_delimiter), _mm256_set1_epi8(a_quote),
+                              _mm256_set1_epi8('\n')};
+  uint64_t *l_masks[3] = {&a_masks.delimiter, &a_masks.quote, &a_masks.newline};
+  for (unsigned i = 0; i < 3; i++) {
+    // Not a lambda: it would not inherit this function's target.
+    const auto l_mask_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_lo, l_chars[i])));
+    const auto l_mask_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_hi, l_chars[i])));
+    *l_masks[i] = (static_cast<uint64_t>(l_mask_hi) << 32) | l_mask_lo;
+  }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void csv_masks_avx512(const char *a_block, char a_delimiter, char a_quote,
+                             csv_masks &a_masks) noexcept
+{
+  const __m512i l_block = _mm512_loadu_si512(a_block);
+  a_masks.delimiter = _mm512_cmpeq_epi8_mask(l_block, _mm512_set1_epi8(a_delimiter));
+  a_masks.quote = _mm512_cmpeq_epi8_mask(l_block, _mm512_set1_epi8(a_quote));
+  a_masks.newline = _mm512_cmpeq_epi8_mask(l_block, _mm512_set1_epi8('\n'));
+}
+
+#endif
+
+inline csv_mask_scan csv_mask_scan_for(simd_level a_level) noexcept
+{
+  if (a_level > supported_simd_level()) a_level = supported_simd_level();
+  switch (a_level) {
+#ifdef MIO_SIMD_X86
+    case simd_level::avx512: return csv_masks_avx512;
+    case simd_level::avx2: return csv_masks_avx2;
+#endif
+#if defined(MIO_SIMD_X86) || defined(MIO_SIMD_SSE2_ONLY)
+    case simd_level::sse2: return csv_masks_sse2;
+#endif
+    default: return csv_masks_scalar;
+  }
+}
+
+/**
+   Bit i of the result is the parity of bits [0, i] of a_bits: with a_bits
+   the quotes of a block, the bytes that are inside quotes (opening quotes
+   included, closing ones not).
+ */
+inline uint64_t prefix_xor(uint64_t a_bits) noexcept
+{
+  a_bits ^= a_bits << 1;
+  a_bits ^= a_bits << 2;
+  a_bits ^= a_bits << 4;
+  a_bits ^= a_bits << 8;
+  a_bits ^= a_bits << 16;
+  a_bits ^= a_bits << 32;
+  return a_bits;
+}
+
+/**
+   Splits [a_first, a_last) into rows and fields, 64 bytes at a time: a
+   block's delimiters and newlines that are not inside quotes are found with
+   a handful of vector compares and bit operations, whatever the number of
+   fields. a_first must be at the start of a row.
+ */
+class csv_tokenizer
+{
+public:
+  csv_tokenizer(const char *a_first, const char *a_last, const csv_options &a_options,
+                simd_level a_level = supported_simd_level()) noexcept :
+      m_next_block{a_first}, m_last{a_last}, m_field{a_first},
+      m_delimiter{a_options.delimiter}, m_quote{a_options.quote},
+      m_scan{csv_mask_scan_for(a_level)}
+  {
+  }
+
+  /**
+     Reads the fields of the next row into a_fields, as views into the input:
+     without the enclosing quotes of a quoted field (a doubled quote inside
+     stays doubled, see parse_field), and without the '\r' of a CRLF line end.
+     Empty lines are skipped.
+
+     \returns False at the end of the input.
+   */
+  bool next_row(std::vector<std::string_view> &a_fields)
+  {
+    a_fields.clear();
+    for (;;) {
+      while (m_structural) {
+        const uint64_t l_bit = m_structural & (0 - m_structural);
+        m_structural ^= l_bit;
+        const char *l_at = m_block + std::countr_zero(l_bit);
+        const bool l_newline = (m_newlines & l_bit) != 0;
+        add_field(a_fields, m_field, l_at, l_newline);
+        m_field = l_at + 1;
+        if (l_newline) {
+          if (a_fields.size() == 1 && a_fields[0].empty()) {
+            a_fields.clear(); // an empty line
+            continue;
+          }
+          return true;
+        }
+      }
+
+      if (m_next_block >= m_last) {
+        // The last row, without a newline.
+        if (m_field < m_last || !a_fields.empty()) {
+          add_field(a_fields, m_field, m_last, true);
+          m_field = m_last;
+          if (!(a_fields.size() == 1 && a_fields[0].empty())) return true;
+        }
+        a_fields.clear();
+        return false;
+      }
+      load_block();
+    }
+  }
+
+  /**
+     Where the next row starts.
+   */
+  [[nodiscard]] const char *position() const noexcept
+  {
+    return m_field;
+  }
+
+private:
+  void add_field(std::vector<std::string_view> &a_fields, const char *a_begin, const char *a_end,
+                 bool a_row_end) const
+  {
+    if (a_row_end && a_end > a_begin && a_end[-1] == '\r') a_end--;
+    if (a_end - a_begin >= 2 && *a_begin == m_quote && a_end[-1] == m_quote) a_begin++, a_end--;
+    a_fields.emplace_back(a_begin, static_cast<size_t>(a_end - a_begin));
+  }
+
+  void load_block() noexcept
+  {
+    csv_masks l_masks;
+    const auto l_left = static_cast<size_t>(m_last - m_next_block);
+    if (l_left >= 64) {
+      m_scan(m_next_block, m_delimiter, m_quote, l_masks);
+    } else {
+      // Past the end of the input: scan a padded copy, and drop the bits beyond.
+      alignas(64) char l_tail[64] = {};
+      std::memcpy(l_tail, m_next_block, l_left);
+      m_scan(l_tail, m_delimiter, m_quote, l_masks);
+      const uint64_t l_valid = (uint64_t{1} << l_left) - 1;
+      l_masks.delimiter &= l_valid;
+      l_masks.quote &= l_valid;
+      l_masks.newline &= l_valid;
+    }
+
+    const uint64_t l_inside = prefix_xor(l_masks.quote) ^ m_inside_carry;
+    // All ones if the block ends inside quotes.
+    m_inside_carry = 0 - (l_inside >> 63);
+
+    m_block = m_next_block;
+    m_next_block += 64;
+    m_structural = (l_masks.delimiter | l_masks.newline) & ~l_inside;
+    m_newlines = l_masks.newline & ~l_inside;
+  }
+
+  const char *m_block{nullptr};
+  const char *m_next_block;
+  const char *m_last;
+  const char *m_field;
+  uint64_t m_structural{0};
+  uint64_t m_newlines{0};
+  uint64_t m_inside_carry{0};
+  char m_delimiter;
+  char m_quote;
+  csv_mask_scan m_scan;
+};
+
+template<typename T>
+T missing_value()
+{
+  if constexpr (std::is_floating_point_v<T>) return std::numeric_limits<T>::quiet_NaN();
+  else return T{};
+}
+
+} // namespace detail
+
+/**
+   A zero-copy reader of delimited files (CSV, TSV) on a memory mapped file.
+
+   Fields are string_views into the mapping, found 64 bytes at a time with
+   vector compares (see detail::csv_tokenizer); numbers are parsed in place
+   with parse_field. Quoted fields may hold delimiters, newlines and doubled
+   quotes; lines may end with "\n" or "\r\n".
+
+   Example:
+
+     mio::CsvReader reader("links.csv", {.header = true});
+     const size_t l_length = reader.column("length");
+     std::vector<std::string_view> l_fields;
+     while (reader.next_row(l_fields)) {
+       double l_value;
+       if (mio::parse_field(l_fields[l_length], l_value, reader.options())) ...
+     }
+
+   Columnar mode reads selected columns straight into typed vectors, in
+   parallel:
+
+     auto [l_ids, l_lengths] = reader.read_columns<int, double>(pool, {0, 3});
+ */
+class CsvReader
+{
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  /**
+     Maps a_file, and reads its header row if a_options.header. If the file
+     cannot be mapped, std::system_error is thrown.
+   */
+  explicit CsvReader(const std::string &a_file, const csv_options &a_options = {}) :
+      m_mmap{a_file}, m_options{a_options}, m_tokenizer{m_mmap.begin(), m_mmap.end(), a_options}
+  {
+    std::error_code l_error;
+    m_mmap.advise(0, map_entire_file, advice::sequential, l_error);
+    if (m_options.header) m_tokenizer.next_row(m_header);
+    m_data = m_tokenizer.position();
+  }
+
+  CsvReader(const CsvReader &) = delete;
+  CsvReader &operator=(const CsvReader &) = delete;
+
+  /**
+     The column names, empty without a header row.
+   */
+  [[nodiscard]] const std::vector<std::string_view> &header() const noexcept
+  {
+    return m_header;
+  }
+
+  /**
+     The dialect of the file, to be passed on to parse_field.
+   */
+  [[nodiscard]] const csv_options &options() const noexcept
+  {
+    return m_options;
+  }
+
+  /**
+     The index of the column named a_name in the header, npos if there is none.
+   */
+  [[nodiscard]] size_t column(std::string_view a_name) const noexcept
+  {
+    const auto l_it = std::find(m_header.begin(), m_header.end(), a_name);
+    return l_it == m_header.end() ? npos : static_cast<size_t>(l_it - m_header.begin());
+  }
+
+  /**
+     Reads the fields of the next row into a_fields, reusing its storage.
+
+     \returns False at end of file.
+   */
+  bool next_row(std::vector<std::string_view> &a_fields)
+  {
+    return m_tokenizer.next_row(a_fields);
+  }
+
+  /**
+     Calls a_fn(fields) for every remaining row, fields being a
+     std::span<const std::string_view>.
+
+     \returns The number of rows.
+   */
+  template<typename F>
+  size_t for_each_row(F &&a_fn)
+  {
+    std::vector<std::string_view> l_fields;
+    size_t l_rows{0};
+    while (m_tokenizer.next_row(l_fields)) {
+      a_fn(std::span<const std::string_view>{l_fields});
+      l_rows++;
+    }
+    return l_rows;
+  }
+
+  /**
+     Columnar mode: reads the columns a_columns (by index) of all the data rows
+     into one vector each, of types T..., in file order, whatever rows have been
+     read with next_row. The file is cut into chunks that the workers of a_pool
+     tokenize in parallel; a first parallel pass counts the quotes of each
+     chunk, so that rows are split right even where quoted fields hold newlines.
+
+     A missing field, or one that does not parse as its type, is stored as a
+     NaN for floating-point types and as T{} otherwise.
+   */
+  template<typename... T>
+  std::tuple<std::vector<T>...> read_columns(thread_pool &a_pool,
+                                             const std::array<size_t, sizeof...(T)> &a_columns,
+                                             size_t a_chunk_size = default_chunk_size)
+  {
+    return read_columns_impl<T...>(a_pool, a_columns, a_chunk_size, std::index_sequence_for<T...>{});
+  }
+
+  /**
+     Same as above, columns given by their names in the header.
+   */
+  template<typename... T>
+  std::tuple<std::vector<T>...> read_columns(thread_pool &a_pool,
+                                             const std::array<std::string_view, sizeof...(T)> &a_names,
+                                             size_t a_chunk_size = default_chunk_size)
+  {
+    std::array<size_t, sizeof...(T)> l_columns;
+    for (size_t i = 0; i < a_names.size(); i++) l_columns[i] = column(a_names[i]);
+    return read_columns<T...>(a_pool, l_columns, a_chunk_size);
+  }
+
+private:
+  template<typename... T, size_t... I>
+  std::tuple<std::vector<T>...> read_columns_impl(thread_pool &a_pool,
+                                                  const std::array<size_t, sizeof...(T)> &a_columns,
+                                                  size_t a_chunk_size, std::index_sequence<I...>)
+  {
+    using columns_type = std::tuple<std::vector<T>...>;
+
+    const char *l_first = m_data;
+    const char *l_last = m_mmap.end();
+    const auto l_size = static_cast<size_t>(l_last - l_first);
+    const size_t l_chunk_size = std::max({a_chunk_size, size_t{64}, l_size / 0xffffffffu + 1});
+    const size_t l_count = (l_size + l_chunk_size - 1) / l_chunk_size;
+
+    // Pass 1: the quotes of each chunk, so that the quote state at the start
+    // of every chunk is known without reading what comes before it.
+    std::vector<uint8_t> l_odd(l_count);
+    {
+      detail::chunk_scheduler l_scheduler{l_count, a_pool.size()};
+      a_pool.run([&](size_t a_worker) {
+        size_t l_chunk;
+        while (l_scheduler.next(a_worker, l_chunk)) {
+          const char *l_begin = l_first + l_chunk * l_chunk_size;
+          const char *l_end = std::min(l_begin + l_chunk_size, l_last);
+          l_odd[l_chunk] = std::count(l_begin, l_end, m_options.quote) & 1;
+        }
+      });
+    }
+    std::vector<uint8_t> l_inside(l_count + 1, 0); // inside quotes at the start of chunk i
+    for (size_t i = 0; i < l_count; i++) l_inside[i + 1] = l_inside[i] ^ l_odd[i];
+
+    // The first row start in chunk i, l_last if none: the byte after a newline outside quotes.
+    const auto l_row_start = [&](size_t a_chunk, size_t a_limit) -> const char * {
+      if (a_chunk == 0) return l_first;
+      if (a_chunk >= l_count) return l_last;
+      const char *l_at = l_first + a_chunk * l_chunk_size - 1;
+      bool l_in = l_inside[a_chunk] ^ (*l_at == m_options.quote);
+      const char *l_to = a_limit >= static_cast<size_t>(l_last - l_at) ? l_last : l_at + a_limit;
+      for (; l_at < l_to; l_at++) {
+        if (*l_at == m_options.quote) l_in = !l_in;
+        else if (*l_at == '\n' && !l_in) return l_at + 1;
+      }
+      return l_last;
+    };
+
+    // Pass 2: tokenize the rows starting in each chunk, in parallel.
+    std::vector<columns_type> l_parts(l_count);
+    {
+      detail::chunk_scheduler l_scheduler{l_count, a_pool.size()};
+      a_pool.run([&](size_t a_worker) {
+        std::vector<std::string_view> l_fields;
+        size_t l_chunk;
+        while (l_scheduler.next(a_worker, l_chunk)) {
+          const char *l_begin = l_row_start(l_chunk, l_chunk_size);
+          if (l_begin == l_last) continue;
+          const char *l_end = l_row_start(l_chunk + 1, static_cast<size_t>(-1));
+          detail::csv_tokenizer l_tokenizer{l_begin, l_end, m_options};
+          auto &l_part = l_parts[l_chunk];
+          while (l_tokenizer.next_row(l_fields)) {
+            (store(std::get<I>(l_part), l_fields, a_columns[I], m_options), ...);
+          }
+        }
+      });
+    }
+
+    // Concatenate the chunks, in order.
+    columns_type l_columns;
+    (concatenate(std::get<I>(l_columns), l_parts, std::integral_constant<size_t, I>{}), ...);
+    return l_columns;
+  }
+
+  template<typename T>
+  static void store(std::vector<T> &a_column, const std::vector<std::string_view> &a_fields, size_t a_index,
+                    const csv_options &a_options)
+  {
+    // parse_field leaves the value untouched if the field does not parse.
+    T l_value = detail::missing_value<T>();
+    if (a_index < a_fields.size()) parse_field(a_fields[a_index], l_value, a_options);
+    a_column.push_back(std::move(l_value));
+  }
+
+  template<typename T, typename Parts, size_t I>
+  static void concatenate(std::vector<T> &a_column, Parts &a_parts, std::integral_constant<size_t, I>)
+  {
+    size_t l_size{0};
+    for (auto &l_part : a_parts) l_size += std::get<I>(l_part).size();
+    a_column.reserve(l_size);
+    for (auto &l_part : a_parts) {
+      auto &l_values = std::get<I>(l_part);
+      std::move(l_values.begin(), l_values.end(), std::back_inserter(a_column));
+      std::vector<T>{}.swap(l_values);
+    }
+  }
+
+  mmap_source m_mmap;
+  csv_options m_options;
+  detail::csv_tokenizer m_tokenizer;
+  std::vector<std::string_view> m_header;
+  const char *m_data{nullptr}; // the first data row
+};
+
+}
+
+#endif
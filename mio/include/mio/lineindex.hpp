@@ -0,0 +1,388 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_LINE_INDEX_H_
+#define _MIO_LINE_INDEX_H_
+
+#include <mio/linescan.hpp>
+#include <mio/mio.hpp>
+#include <mio/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace mio {
+
+namespace detail {
+
+/**
+   The header of a line index file. It is followed by one 64-bit base offset
+   per line_index_group checkpoints, then by the checkpoints themselves, each
+   the offset of line i * stride minus the base of its group, in delta_bytes
+   bytes (4, unless a group spans more than 4 GiB).
+ */
+struct line_index_header
+{
+  char magic[8];
+  uint32_t stride;
+  uint32_t delta_bytes;
+  uint64_t file_size;
+  int64_t mtime;
+  uint64_t lines;
+  uint64_t checkpoints;
+};
+
+inline constexpr char line_index_magic[8] = {'m', 'i', 'o', 'L', 'I', 'D', 'X', '1'};
+inline constexpr size_t line_index_group = 64;
+
+/**
+   The last write time of a_file, as stored in a line index; 0 if unknown.
+ */
+inline int64_t file_mtime(const std::string &a_file) noexcept
+{
+  std::error_code l_error;
+  const auto l_time = std::filesystem::last_write_time(a_file, l_error);
+  return l_error ? 0 : static_cast<int64_t>(l_time.time_since_epoch().count());
+}
+
+/**
+   A name next to a_path no other call, in this process or another, returns
+   while it exists: a_path + ".tmp" + a random and a sequence number.
+ */
+inline std::string unique_temp_path(const std::string &a_path)
+{
+  static std::atomic<uint64_t> s_sequence{0};
+  static const uint64_t s_random = (uint64_t{std::random_device{}()} << 32) ^ std::random_device{}() ^
+                                   static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+  char l_suffix[40];
+  std::snprintf(l_suffix, sizeof(l_suffix), ".tmp%016llx%llx", static_cast<unsigned long long>(s_random),
+                static_cast<unsigned long long>(s_sequence.fetch_add(1, std::memory_order_relaxed)));
+  return a_path + l_suffix;
+}
+
+/**
+   The number of '\n' in [a_first, a_last).
+ */
+inline size_t count_newlines(const char *a_first, const char *a_last) noexcept
+{
+  std::array<const char *, 256> l_found;
+  size_t l_count{0};
+  for (size_t l_n; (l_n = scan_newlines(a_first, a_last, l_found.data(), l_found.size())) > 0;) {
+    l_count += l_n;
+    a_first = l_found[l_n - 1] + 1;
+  }
+  return l_count;
+}
+
+} // namespace detail
+
+/**
+   A persistent index of the lines of a file, kept in a sidecar file next to
+   it: the offset of every stride-th line, delta encoded, memory mapped when
+   loaded. It gives the offset of any line after scanning at most stride - 1
+   lines, so a reader can start at line N, or split a file into parts of the
+   same number of lines, without reading what comes before. Finding a line is
+   O(stride); with exact_stride, every line is stored and it is a lookup, for
+   4 bytes per line instead of 4 per default_stride lines.
+
+   The index records the size and last write time of the file it was built
+   for; matches tells whether it still describes the file.
+
+   Lines are counted as by StringReader::getlines: a last line without a '\n'
+   counts if it is not empty.
+
+   Example:
+
+     auto index = mio::LineIndex::open_or_build("links.csv");
+     mio::StringReader reader("links.csv");
+     reader.seek_line(index, 1000000);
+     auto line = reader.getline();
+ */
+class LineIndex
+{
+public:
+  static constexpr uint32_t default_stride = 1024;
+  static constexpr uint32_t exact_stride = 1;
+
+  /**
+     Maps the index file a_index. If it cannot be mapped or is not a line
+     index, std::system_error is thrown.
+   */
+  explicit LineIndex(const std::string &a_index) : m_mmap{a_index}
+  {
+    constexpr size_t l_header_size = sizeof(detail::line_index_header);
+    const auto l_invalid = [] { throw std::system_error(std::make_error_code(std::errc::invalid_argument)); };
+
+    if (m_mmap.size() < l_header_size) l_invalid();
+    std::memcpy(&m_header, m_mmap.data(), l_header_size);
+    if (std::memcmp(m_header.magic, detail::line_index_magic, sizeof(m_header.magic)) != 0 ||
+        m_header.stride == 0 || (m_header.delta_bytes != 4 && m_header.delta_bytes != 8) ||
+        m_header.checkpoints != (m_header.lines + m_header.stride - 1) / m_header.stride)
+      l_invalid();
+
+    const uint64_t l_groups = (m_header.checkpoints + detail::line_index_group - 1) / detail::line_index_group;
+    if (m_mmap.size() != l_header_size + 8 * l_groups + m_header.delta_bytes * m_header.checkpoints)
+      l_invalid();
+  }
+
+  /**
+     The conventional name of the index of a_file.
+   */
+  static std::string sidecar_path(const std::string &a_file)
+  {
+    return a_file + ".lidx";
+  }
+
+  /**
+     Indexes the lines of a_file, every a_stride-th one, into the file
+     a_index, which is replaced atomically. The file is scanned twice in
+     parallel on the workers of a_pool: once to count the lines of each chunk,
+     once to record the offsets. Errors throw std::system_error.
+   */
+  static void build(thread_pool &a_pool, const std::string &a_file, const std::string &a_index,
+                    uint32_t a_stride = default_stride)
+  {
+    detail::line_index_header l_header{};
+    std::memcpy(l_header.magic, detail::line_index_magic, sizeof(l_header.magic));
+    l_header.stride = std::max(a_stride, uint32_t{1});
+    l_header.delta_bytes = 4;
+    l_header.mtime = detail::file_mtime(a_file);
+    l_header.file_size = std::filesystem::file_size(a_file);
+
+    std::vector<uint64_t> l_checkpoints;
+    if (l_header.file_size > 0) {
+      mmap_source l_mmap{a_file};
+      std::error_code l_error;
+      l_mmap.advise(0, map_entire_file, advice::sequential, l_error);
+
+      const char *l_first = l_mmap.begin();
+      const char *l_last = l_mmap.end();
+      const auto l_size = static_cast<size_t>(l_last - l_first);
+      const size_t l_chunk_size = std::max(default_chunk_size, l_size / 0xffffffffu + 1);
+      const size_t l_count = (l_size + l_chunk_size - 1) / l_chunk_size;
+
+      // Pass 1: the newlines before each chunk.
+      std::vector<uint64_t> l_newlines(l_count + 1, 0);
+      {
+        detail::chunk_scheduler l_scheduler{l_count, a_pool.size()};
+        a_pool.run([&](size_t a_worker) {
+          size_t l_chunk;
+          while (l_scheduler.next(a_worker, l_chunk)) {
+            const char *l_begin = l_first + l_chunk * l_chunk_size;
+            l_newlines[l_chunk + 1] = detail::count_newlines(l_begin, std::min(l_begin + l_chunk_size, l_last));
+          }
+        });
+      }
+      for (size_t i = 0; i < l_count; i++) l_newlines[i + 1] += l_newlines[i];
+
+      l_header.lines = l_newlines[l_count] + (l_last[-1] != '\n' ? 1 : 0);
+      l_checkpoints.resize((l_header.lines + l_header.stride - 1) / l_header.stride);
+      l_checkpoints[0] = 0;
+
+      // Pass 2: the newline before every stride-th line, each chunk knowing
+      // from pass 1 the number of the first line that starts in it.
+      {
+        detail::chunk_scheduler l_scheduler{l_count, a_pool.size()};
+        a_pool.run([&](size_t a_worker) {
+          std::array<const char *, 256> l_found;
+          size_t l_chunk;
+          while (l_scheduler.next(a_worker, l_chunk)) {
+            const char *l_begin = l_first + l_chunk * l_chunk_size;
+            const char *l_end = std::min(l_begin + l_chunk_size, l_last);
+            uint64_t l_line = l_newlines[l_chunk];
+            for (size_t l_n; (l_n = detail::scan_newlines(l_begin, l_end, l_found.data(), l_found.size())) > 0;) {
+              for (size_t i = 0; i < l_n; i++) {
+                // The line after the newline, if there is one.
+                if (++l_line % l_header.stride == 0 && l_found[i] + 1 < l_last)
+                  l_checkpoints[l_line / l_header.stride] = static_cast<uint64_t>(l_found[i] + 1 - l_first);
+              }
+              l_begin = l_found[l_n - 1] + 1;
+            }
+          }
+        });
+      }
+    }
+    l_header.checkpoints = l_checkpoints.size();
+
+    // Delta encoding, on 4 bytes unless a group spans more than 4 GiB.
+    std::vector<uint64_t> l_bases;
+    for (size_t i = 0; i < l_checkpoints.size(); i += detail::line_index_group) {
+      l_bases.push_back(l_checkpoints[i]);
+      const size_t l_group_end = std::min(i + detail::line_index_group, l_checkpoints.size());
+      if (l_checkpoints[l_group_end - 1] - l_checkpoints[i] > std::numeric_limits<uint32_t>::max())
+        l_header.delta_bytes = 8;
+    }
+    std::vector<char> l_deltas(l_checkpoints.size() * l_header.delta_bytes);
+    for (size_t i = 0; i < l_checkpoints.size(); i++) {
+      const uint64_t l_delta = l_checkpoints[i] - l_bases[i / detail::line_index_group];
+      if (l_header.delta_bytes == 4) {
+        const auto l_delta32 = static_cast<uint32_t>(l_delta);
+        std::memcpy(l_deltas.data() + 4 * i, &l_delta32, 4);
+      } else {
+        std::memcpy(l_deltas.data() + 8 * i, &l_delta, 8);
+      }
+    }
+
+    // Written aside then renamed, so that a reader never maps half an index,
+    // under a name of its own, so that concurrent builds never mix their bytes.
+    const std::string l_temp = detail::unique_temp_path(a_index);
+    try {
+      {
+        std::ofstream l_out(l_temp, std::ios::binary | std::ios::trunc);
+        l_out.write(reinterpret_cast<const char *>(&l_header), sizeof(l_header));
+        l_out.write(reinterpret_cast<const char *>(l_bases.data()),
+                    static_cast<std::streamsize>(l_bases.size() * sizeof(uint64_t)));
+        l_out.write(l_deltas.data(), static_cast<std::streamsize>(l_deltas.size()));
+        if (!l_out.flush()) throw std::system_error(std::make_error_code(std::errc::io_error));
+      }
+      std::filesystem::rename(l_temp, a_index);
+    } catch (...) {
+      std::error_code l_error;
+      std::filesystem::remove(l_temp, l_error);
+      throw;
+    }
+  }
+
+  /**
+     Same as above, on thread_pool::shared().
+   */
+  static void build(const std::string &a_file, const std::string &a_index, uint32_t a_stride = default_stride)
+  {
+    build(thread_pool::shared(), a_file, a_index, a_stride);
+  }
+
+  /**
+     Loads the index of a_file from its sidecar file, or builds it there
+     first if there is none, or if it is damaged or out of date.
+   */
+  static LineIndex open_or_build(const std::string &a_file, uint32_t a_stride = default_stride,
+                                 thread_pool &a_pool = thread_pool::shared())
+  {
+    const std::string l_index = sidecar_path(a_file);
+    if (std::filesystem::exists(l_index)) {
+      try {
+        LineIndex l_loaded{l_index};
+        if (l_loaded.matches(a_file)) return l_loaded;
+      } catch (const std::system_error &) {
+        // Damaged: rebuilt below.
+      }
+    }
+    build(a_pool, a_file, l_index, a_stride);
+    return LineIndex{l_index};
+  }
+
+  /**
+     Checks that a_file has the size and last write time it had when indexed.
+   */
+  [[nodiscard]] bool matches(const std::string &a_file) const noexcept
+  {
+    std::error_code l_error;
+    const auto l_size = std::filesystem::file_size(a_file, l_error);
+    return !l_error && l_size == m_header.file_size && detail::file_mtime(a_file) == m_header.mtime;
+  }
+
+  /**
+     The number of lines of the file.
+   */
+  [[nodiscard]] uint64_t lines() const noexcept
+  {
+    return m_header.lines;
+  }
+
+  /**
+     The number of lines between two offsets stored.
+   */
+  [[nodiscard]] uint32_t stride() const noexcept
+  {
+    return m_header.stride;
+  }
+
+  /**
+     The size of the file when indexed.
+   */
+  [[nodiscard]] uint64_t file_size() const noexcept
+  {
+    return m_header.file_size;
+  }
+
+  /**
+     The offset of line a_checkpoint * stride().
+     Precondition - a_checkpoint < (lines() + stride() - 1) / stride().
+   */
+  [[nodiscard]] uint64_t checkpoint(uint64_t a_checkpoint) const noexcept
+  {
+    const char *l_bases = m_mmap.data() + sizeof(detail::line_index_header);
+    const char *l_deltas = l_bases + 8 * ((m_header.checkpoints + detail::line_index_group - 1) / detail::line_index_group);
+
+    uint64_t l_base;
+    std::memcpy(&l_base, l_bases + 8 * (a_checkpoint / detail::line_index_group), 8);
+    if (m_header.delta_bytes == 4) {
+      uint32_t l_delta;
+      std::memcpy(&l_delta, l_deltas + 4 * a_checkpoint, 4);
+      return l_base + l_delta;
+    }
+    uint64_t l_delta;
+    std::memcpy(&l_delta, l_deltas + 8 * a_checkpoint, 8);
+    return l_base + l_delta;
+  }
+
+  /**
+     The offset of line a_line in [a_first, a_last), the bytes of the indexed
+     file, found from the nearest checkpoint before it, up to stride() - 1
+     lines back; the size of the file if a_line >= lines().
+   */
+  [[nodiscard]] uint64_t line_offset(uint64_t a_line, const char *a_first, const char *a_last) const noexcept
+  {
+    if (a_line >= m_header.lines) return static_cast<uint64_t>(a_last - a_first);
+
+    if (m_header.stride == exact_stride) return checkpoint(a_line);
+
+    const char *l_at = a_first + checkpoint(a_line / m_header.stride);
+    std::array<const char *, 256> l_found;
+    for (uint64_t l_skip = a_line % m_header.stride; l_skip > 0;) {
+      const size_t l_n = detail::scan_newlines(l_at, a_last, l_found.data(),
+                                               static_cast<size_t>(std::min<uint64_t>(l_skip, l_found.size())));
+      if (l_n == 0) break;
+      l_at = l_found[l_n - 1] + 1;
+      l_skip -= l_n;
+    }
+    return static_cast<uint64_t>(l_at - a_first);
+  }
+
+private:
+  mmap_source m_mmap;
+  detail::line_index_header m_header{};
+};
+
+}
+
+#endif
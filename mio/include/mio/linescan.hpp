@@ -0,0 +1,230 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_LINE_SCAN_H_
+#define _MIO_LINE_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MIO_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(_M_X64)
+#define MIO_SIMD_SSE2_ONLY 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace mio {
+
+/**
+   Instruction sets the line scanner has a kernel for, from the slowest.
+ */
+enum class simd_level
+{
+  scalar,
+  sse2,
+  avx2,
+  avx512
+};
+
+namespace detail {
+
+/**
+   A line scanning kernel: stores the position of each '\n' in [a_first, a_last),
+   in order, into a_found, and stops after a_max of them. Returns the number
+   stored.
+ */
+using newline_scan = size_t (*)(const char *a_first, const char *a_last,
+                                const char **a_found, size_t a_max) noexcept;
+
+inline size_t scan_newlines_scalar(const char *a_first, const char *a_last,
+                                   const char **a_found, size_t a_max) noexcept
+{
+  size_t l_count{0};
+  while (l_count < a_max && a_first < a_last) {
+    const auto *l_find = static_cast<const char *>(std::memchr(a_first, '\n', a_last - a_first));
+    if (!l_find) break;
+    a_found[l_count++] = l_find;
+    a_first = l_find + 1;
+  }
+  return l_count;
+}
+
+/**
+   Reports the set bits of a chunk mask as newline positions. Returns false
+   once a_max positions have been stored, so the caller stops loading blocks
+   as soon as the quota is met.
+ */
+inline bool emit_newlines(uint64_t a_mask, const char *a_chunk, const char **a_found,
+                          size_t &a_count, size_t a_max) noexcept
+{
+  while (a_mask) {
+    if (a_count == a_max) return false;
+#if defined(__GNUC__) || defined(__clang__)
+    a_found[a_count++] = a_chunk + __builtin_ctzll(a_mask);
+#elif defined(_M_X64)
+    unsigned long l_bit;
+    _BitScanForward64(&l_bit, a_mask);
+    a_found[a_count++] = a_chunk + l_bit;
+#else
+    unsigned l_bit{0};
+    while (!((a_mask >> l_bit) & 1)) ++l_bit;
+    a_found[a_count++] = a_chunk + l_bit;
+#endif
+    a_mask &= a_mask - 1;
+  }
+  return a_count < a_max;
+}
+
+#if defined(MIO_SIMD_X86) || defined(MIO_SIMD_SSE2_ONLY)
+
+#ifdef MIO_SIMD_X86
+__attribute__((target("sse2")))
+#endif
+inline size_t scan_newlines_sse2(const char *a_first, const char *a_last,
+                                 const char **a_found, size_t a_max) noexcept
+{
+  size_t l_count{0};
+  const __m128i l_nl = _mm_set1_epi8('\n');
+
+  for (; a_first + 16 <= a_last; a_first += 16) {
+    const __m128i l_chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_first));
+    const auto l_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(l_chunk, l_nl)));
+    if (!emit_newlines(l_mask, a_first, a_found, l_count, a_max)) return l_count;
+  }
+  return l_count + scan_newlines_scalar(a_first, a_last, a_found + l_count, a_max - l_count);
+}
+
+#endif
+
+#ifdef MIO_SIMD_X86
+
+__attribute__((target("avx2")))
+inline size_t scan_newlines_avx2(const char *a_first, const char *a_last,
+                                 const char **a_found, size_t a_max) noexcept
+{
+  size_t l_count{0};
+  const __m256i l_nl = _mm256_set1_epi8('\n');
+
+  // Two vectors per step: lines are often shorter than 64 bytes, but rarely
+  // so short that one mask of 64 bits holds more than a few of them.
+  for (; a_first + 64 <= a_last; a_first += 64) {
+    const __m256i l_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_first));
+    const __m256i l_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_first + 32));
+    const auto l_mask_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_lo, l_nl)));
+    const auto l_mask_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_hi, l_nl)));
+    const uint64_t l_mask = (static_cast<uint64_t>(l_mask_hi) << 32) | l_mask_lo;
+    if (!emit_newlines(l_mask, a_first, a_found, l_count, a_max)) return l_count;
+  }
+  return l_count + scan_newlines_sse2(a_first, a_last, a_found + l_count, a_max - l_count);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t scan_newlines_avx512(const char *a_first, const char *a_last,
+                                   const char **a_found, size_t a_max) noexcept
+{
+  size_t l_count{0};
+  const __m512i l_nl = _mm512_set1_epi8('\n');
+
+  for (; a_first + 64 <= a_last; a_first += 64) {
+    const __m512i l_chunk = _mm512_loadu_si512(a_first);
+    const uint64_t l_mask = _mm512_cmpeq_epi8_mask(l_chunk, l_nl);
+    if (!emit_newlines(l_mask, a_first, a_found, l_count, a_max)) return l_count;
+  }
+  return l_count + scan_newlines_sse2(a_first, a_last, a_found + l_count, a_max - l_count);
+}
+
+#endif
+
+} // namespace detail
+
+/**
+   The fastest instruction set supported by both this build and the CPU it
+   runs on. Checked once.
+ */
+inline simd_level supported_simd_level() noexcept
+{
+  static const simd_level l_level = [] {
+#if defined(MIO_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return simd_level::avx512;
+    if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+    if (__builtin_cpu_supports("sse2")) return simd_level::sse2;
+    return simd_level::scalar;
+#elif defined(MIO_SIMD_SSE2_ONLY)
+    // x64 always has SSE2. MSVC builds stop there: no runtime dispatch to wider kernels.
+    return simd_level::sse2;
+#else
+    return simd_level::scalar;
+#endif
+  }();
+  return l_level;
+}
+
+namespace detail {
+
+/**
+   The kernel for a_level, or the one of the best supported level below it.
+ */
+inline newline_scan newline_scan_for(simd_level a_level) noexcept
+{
+  if (a_level > supported_simd_level()) a_level = supported_simd_level();
+  switch (a_level) {
+#ifdef MIO_SIMD_X86
+    case simd_level::avx512: return scan_newlines_avx512;
+    case simd_level::avx2: return scan_newlines_avx2;
+#endif
+#if defined(MIO_SIMD_X86) || defined(MIO_SIMD_SSE2_ONLY)
+    case simd_level::sse2: return scan_newlines_sse2;
+#endif
+    default: return scan_newlines_scalar;
+  }
+}
+
+/**
+   Finds up to a_max newlines in [a_first, a_last) with the best kernel of this CPU.
+ */
+inline size_t scan_newlines(const char *a_first, const char *a_last,
+                            const char **a_found, size_t a_max) noexcept
+{
+  static const newline_scan l_scan = newline_scan_for(supported_simd_level());
+  return l_scan(a_first, a_last, a_found, a_max);
+}
+
+/**
+   The first '\n' in [a_first, a_last), or a_last if there is none.
+ */
+inline const char *find_newline(const char *a_first, const char *a_last) noexcept
+{
+  const char *l_found = a_last;
+  scan_newlines(a_first, a_last, &l_found, 1);
+  return l_found;
+}
+
+} // namespace detail
+
+}
+
+#endif
@@ -66,6 +66,8 @@
 #include <system_error>
 #include <system_error>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace mio {
 
@@ -79,6 +81,63 @@ enum class access_mode
   write
 };
 
+/**
+   Access-pattern hints passed to the kernel for a mapped range (`madvise` on
+   POSIX). They are advisory only: a hint the platform does not support is
+   ignored.
+
+   - `sequential`: pages are read in order; read ahead aggressively and drop
+     pages soon after they have been read.
+   - `random`: pages are read in no particular order; do not read ahead.
+   - `willneed`: the range will be read soon; start reading it in now.
+   - `dontneed`: the range will not be read soon; its pages may be dropped.
+   - `hugepage`: back the range with transparent huge pages where possible.
+ */
+enum class advice
+{
+  normal,
+  sequential,
+  random,
+  willneed,
+  dontneed,
+  hugepage
+};
+
+/**
+   Options of a mapping, given to `basic_mmap::map` and the `make_mmap`
+   factories. A default constructed `map_options` gives the plain shared
+   mapping `map` has always created.
+ */
+struct map_options
+{
+  // Access-pattern hint applied to the whole mapping once it is established.
+  advice hint = advice::normal;
+
+  // Fault every page in while mapping (`MAP_POPULATE` on Linux, a `willneed`
+  // hint elsewhere), so that the first pass over the data does not stall.
+  bool populate = false;
+
+  // Back the mapping with transparent huge pages where possible.
+  bool huge_pages = false;
+
+  // Map the file copy-on-write (`MAP_PRIVATE`): writes through a sink go to
+  // private copies of the pages and never reach the file, which is then
+  // opened read-only when mapped by path.
+  bool copy_on_write = false;
+};
+
+/**
+   How `basic_mmap::sync` flushes a write mapping: `blocking` returns once the
+   data is on disk, `async` only starts writing it back (`sync_file_range` on
+   Linux, where `MS_ASYNC` does nothing, `MS_ASYNC` elsewhere, and
+   `FlushViewOfFile` without `FlushFileBuffers` on Windows).
+ */
+enum class sync_mode
+{
+  blocking,
+  async
+};
+
 /**
    Determines the operating system's page allocation granularity.
 
@@ -439,9 +498,89 @@ struct mmap_context
 #endif
 };
 
+/**
+   Gives `hint` for the `length` bytes at `start`, which must be page aligned.
+   Errors are reported via `error`; a hint the platform does not know is a
+   no-op.
+ */
+inline void advise(char *start, const size_t length, const advice hint,
+                   std::error_code &error) noexcept
+{
+  error.clear();
+  if (length == 0) return;
+#ifdef _WIN32
+  // Windows has no access-pattern hints, it can only be asked to read ahead.
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+  if (hint == advice::willneed) {
+    WIN32_MEMORY_RANGE_ENTRY range{start, length};
+    if (::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0) == 0) {
+      error = detail::last_error();
+    }
+  }
+#else
+  (void) start;
+  (void) hint;
+#endif
+#else // POSIX
+  int flag = MADV_NORMAL;
+  switch (hint) {
+    case advice::normal:     flag = MADV_NORMAL;     break;
+    case advice::sequential: flag = MADV_SEQUENTIAL; break;
+    case advice::random:     flag = MADV_RANDOM;     break;
+    case advice::willneed:   flag = MADV_WILLNEED;   break;
+    case advice::dontneed:   flag = MADV_DONTNEED;   break;
+    case advice::hugepage:
+#ifdef MADV_HUGEPAGE
+      flag = MADV_HUGEPAGE;
+      break;
+#else
+      return;
+#endif
+  }
+  if (::madvise(start, length, flag) != 0) {
+    error = detail::last_error();
+  }
+#endif
+}
+
+/**
+   Flushes the `length` bytes at `start`, which must be page aligned and map
+   the file behind `file_handle` from `file_offset`. Errors are reported via
+   `error`.
+ */
+inline void flush(char *start, const size_t length, const file_handle_type file_handle,
+                  const uint64_t file_offset, const sync_mode mode, std::error_code &error) noexcept
+{
+  error.clear();
+#ifdef _WIN32
+  (void) file_offset;
+  if ((length > 0 && ::FlushViewOfFile(start, length) == 0)
+      || (mode == sync_mode::blocking && ::FlushFileBuffers(file_handle) == 0)) {
+    error = detail::last_error();
+  }
+#else // POSIX
+  if (length == 0) return;
+#ifdef __linux__
+  if (mode == sync_mode::async) {
+    if (::sync_file_range(file_handle, static_cast<off_t>(file_offset), static_cast<off_t>(length),
+                          SYNC_FILE_RANGE_WRITE) != 0) {
+      error = detail::last_error();
+    }
+    return;
+  }
+#else
+  (void) file_handle;
+  (void) file_offset;
+#endif
+  if (::msync(start, length, mode == sync_mode::async ? MS_ASYNC : MS_SYNC) != 0) {
+    error = detail::last_error();
+  }
+#endif
+}
+
 inline mmap_context memory_map(const file_handle_type file_handle,
                                const size_t offset, const size_t length, const access_mode mode,
-                               std::error_code &error)
+                               const map_options &options, std::error_code &error)
 {
   mmap_context result = {
       nullptr,
@@ -466,7 +605,8 @@ inline mmap_context memory_map(const file_handle_type file_handle,
   const file_handle_type file_mapping_handle = ::CreateFileMapping(
       file_handle,
       nullptr,
-      mode == access_mode::read ? PAGE_READONLY : PAGE_READWRITE,
+      options.copy_on_write ? PAGE_WRITECOPY
+          : mode == access_mode::read ? PAGE_READONLY : PAGE_READWRITE,
       win::int64_high(max_file_size),
       win::int64_low(max_file_size),
       nullptr);
@@ -478,7 +618,8 @@ inline mmap_context memory_map(const file_handle_type file_handle,
 
   LPVOID mapping_start = ::MapViewOfFile(
       file_mapping_handle,
-      mode == access_mode::read ? FILE_MAP_READ : FILE_MAP_WRITE,
+      options.copy_on_write ? FILE_MAP_COPY
+          : mode == access_mode::read ? FILE_MAP_READ : FILE_MAP_WRITE,
       win::int64_high(static_cast<int64_t>(aligned_offset)),
       win::int64_low(static_cast<int64_t>(aligned_offset)),
       static_cast<SIZE_T>(length_to_map));
@@ -488,11 +629,16 @@ inline mmap_context memory_map(const file_handle_type file_handle,
     return result;
   }
 #else // POSIX
+  int flags = options.copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+#ifdef MAP_POPULATE
+  if (options.populate) flags |= MAP_POPULATE;
+#endif
+
   char *mapping_start = static_cast<char *>(::mmap(
         0, // Don't give hint as to where to map.
         length_to_map,
-        mode == access_mode::read ? PROT_READ : PROT_WRITE,
-        MAP_SHARED,
+        mode == access_mode::read ? PROT_READ : PROT_READ | PROT_WRITE,
+        flags,
         file_handle,
         aligned_offset));
 
@@ -502,6 +648,17 @@ inline mmap_context memory_map(const file_handle_type file_handle,
     }
 #endif
 
+  // Hints are advisory: the mapping is good even if the kernel turns them down.
+  std::error_code ignored;
+  if (options.huge_pages)
+    detail::advise(static_cast<char *>(mapping_start), length_to_map, advice::hugepage, ignored);
+  if (options.hint != advice::normal)
+    detail::advise(static_cast<char *>(mapping_start), length_to_map, options.hint, ignored);
+#ifndef MAP_POPULATE
+  if (options.populate)
+    detail::advise(static_cast<char *>(mapping_start), length_to_map, advice::willneed, ignored);
+#endif
+
   result.data = [&](std::span<char> data_) -> char * {
     return &data_[offset - aligned_offset];
   }({static_cast<char *>(mapping_start),
@@ -565,6 +722,15 @@ private:
   // provided path. For this reason, this flag is used to determine when to
   // close `file_handle_`.
   bool is_handle_internal_{};
+  // Offset in the file of the first requested byte.
+  uint64_t file_offset_ = 0;
+  // Page ranges, from the start of the mapping, given to `mark_dirty` and not
+  // synced since.
+  std::vector<std::pair<size_type, size_type>> dirty_;
+  // Set by `mark_dirty`: the destructor then syncs the dirty ranges only.
+  bool track_dirty_ = false;
+  // Whether the destructor of a write mapping syncs it.
+  bool sync_on_destroy_ = true;
 
 public:
 
@@ -635,8 +801,14 @@ public:
       , file_mapping_handle_{std::move(other.file_mapping_handle_)}
 #endif
       , is_handle_internal_{std::move(other.is_handle_internal_)}
+      , file_offset_{other.file_offset_}
+      , dirty_{std::move(other.dirty_)}
+      , track_dirty_{other.track_dirty_}
+      , sync_on_destroy_{other.sync_on_destroy_}
   {
     other.data_ = nullptr;
+    other.dirty_.clear();
+    other.track_dirty_ = false;
     other.length_ = other.mapped_length_ = 0;
     other.file_handle_ = invalid_handle;
 #ifdef _WIN32
@@ -664,7 +836,13 @@ public:
       file_mapping_handle_ = std::move(other.file_mapping_handle_);
 #endif
       is_handle_internal_ = std::move(other.is_handle_internal_);
+      file_offset_ = other.file_offset_;
+      dirty_ = std::move(other.dirty_);
+      track_dirty_ = other.track_dirty_;
+      sync_on_destroy_ = other.sync_on_destroy_;
       other.data_ = nullptr;
+      other.dirty_.clear();
+      other.track_dirty_ = false;
       other.length_ = other.mapped_length_ = 0;
       other.file_handle_ = invalid_handle;
 #ifdef _WIN32
@@ -926,10 +1104,13 @@ public:
 
      `length` is the number of bytes to map. It may be `map_entire_file`, in
      which case a mapping of the entire file is created.
+
+     `options` selects how the mapping is created: access-pattern hint,
+     prefaulting, huge pages, copy-on-write (see `map_options`).
    */
   template<typename StrT>
   void map(const StrT &path, const size_type offset, const size_type length,
-           std::error_code &error)
+           const map_options &options, std::error_code &error)
   {
     error.clear();
 
@@ -938,29 +1119,44 @@ public:
       return;
     }
 
-    const auto handle = detail::open_file(path, AccessMode, error);
+    // A copy-on-write mapping never writes to the file, so reading it is enough.
+    const auto handle = detail::open_file(
+        path, options.copy_on_write ? access_mode::read : AccessMode, error);
     if (error) return;
 
-    map(handle, offset, length, error);
+    map(handle, offset, length, options, error);
 
     // MUST sets this to true.
     if (!error) is_handle_internal_ = true;
   }
 
+  template<typename StrT>
+  void map(const StrT &path, const size_type offset, const size_type length,
+           std::error_code &error)
+  {
+    map(path, offset, length, map_options{}, error);
+  }
+
   /**
       Map the entire file.
    */
+  template<typename StrT>
+  void map(const StrT &path, const map_options &options, std::error_code &error)
+  {
+    map(path, 0, map_entire_file, options, error);
+  }
+
   template<typename StrT>
   void map(const StrT &path, std::error_code &error)
   {
-    map(path, 0, map_entire_file, error);
+    map(path, 0, map_entire_file, map_options{}, error);
   }
 
   /**
      Establish memory mapping using file handle.
    */
   void map(const handle_type handle, const size_type offset,
-           const size_type length, std::error_code &error)
+           const size_type length, const map_options &options, std::error_code &error)
   {
     error.clear();
 
@@ -986,6 +1182,7 @@ public:
         offset,
         static_cast<size_type>(requested_size - offset),
         AccessMode,
+        options,
         error);
 
     if (!error) {
@@ -995,6 +1192,7 @@ public:
       unmap();
       file_handle_ = handle;
       is_handle_internal_ = false;
+      file_offset_ = offset;
 
       if constexpr (std::is_same_v<pointer, decltype(ctx.data)>)
         data_ = ctx.data;
@@ -1009,12 +1207,62 @@ public:
     }
   }
 
+  void map(const handle_type handle, const size_type offset,
+           const size_type length, std::error_code &error)
+  {
+    map(handle, offset, length, map_options{}, error);
+  }
+
   /**
      Establish memory mapping using file handle for the entire file.
    */
+  void map(const handle_type handle, const map_options &options, std::error_code &error)
+  {
+    map(handle, 0, map_entire_file, options, error);
+  }
+
   void map(const handle_type handle, std::error_code &error)
   {
-    map(handle, 0, map_entire_file, error);
+    map(handle, 0, map_entire_file, map_options{}, error);
+  }
+
+  /**
+     Gives an access-pattern hint for the `length` bytes at `offset`, both
+     relative to the first requested byte (as returned by `data`). `length`
+     may be `map_entire_file`, meaning up to the end of the mapping. The
+     range is widened to whole pages. Errors are reported via `error`.
+   */
+  void advise(const size_type offset, const size_type length, const advice hint,
+              std::error_code &error) const noexcept
+  {
+    error.clear();
+
+    if (!is_mapped() || !data_) {
+      error = std::make_error_code(std::errc::bad_file_descriptor);
+      return;
+    }
+
+    if (offset > length_ || (length != map_entire_file && length > length_ - offset)) {
+      error = std::make_error_code(std::errc::invalid_argument);
+      return;
+    }
+
+    const size_type first = mapping_offset() + offset;
+    const size_type last = length == map_entire_file ? mapped_length_ : first + length;
+    const size_type aligned_first = make_offset_page_aligned(first);
+
+    detail::advise(const_cast<char *>(reinterpret_cast<const char *>(get_mapping_start())) + aligned_first,
+                   last - aligned_first, hint, error);
+  }
+
+  /**
+     Asks the kernel to start reading the given range in, ahead of its use.
+     Same as `advise(offset, length, advice::willneed, error)`.
+   */
+  void prefetch(const size_type offset, const size_type length,
+                std::error_code &error) const noexcept
+  {
+    advise(offset, length, advice::willneed, error);
   }
 
   /**
@@ -1059,6 +1307,9 @@ public:
     data_ = nullptr;
     length_ = mapped_length_ = 0;
     file_handle_ = invalid_handle;
+    file_offset_ = 0;
+    dirty_.clear();
+    track_dirty_ = false;
 #ifdef _WIN32
     file_mapping_handle_ = invalid_handle;
 #endif
@@ -1075,14 +1326,52 @@ public:
       std::swap(length_, other.length_);
       std::swap(mapped_length_, other.mapped_length_);
       std::swap(is_handle_internal_, other.is_handle_internal_);
+      std::swap(file_offset_, other.file_offset_);
+      dirty_.swap(other.dirty_);
+      std::swap(track_dirty_, other.track_dirty_);
+      std::swap(sync_on_destroy_, other.sync_on_destroy_);
     }
   }
 
   /**
-     Flushes the memory mapped page to disk. Errors are reported via `error`.
+     Flushes the memory mapped pages to disk, waiting until they are written.
+     Errors are reported via `error`.
    */
   template<access_mode A = AccessMode>
   typename std::enable_if_t<A == access_mode::write> sync(std::error_code &error)
+  {
+    sync(0, map_entire_file, sync_mode::blocking, error);
+  }
+
+  /**
+     Flushes the whole mapping as `mode` says: `sync_mode::async` starts the
+     write-back and returns.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> sync(const sync_mode mode, std::error_code &error)
+  {
+    sync(0, map_entire_file, mode, error);
+  }
+
+  /**
+     Flushes the `length` bytes at `offset`, relative to the first requested
+     byte (as returned by `data`), and waits until they are written. `length`
+     may be `map_entire_file`, meaning up to the end of the mapping. The range
+     is widened to whole pages.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> sync(const size_type offset, const size_type length,
+                                                          std::error_code &error)
+  {
+    sync(offset, length, sync_mode::blocking, error);
+  }
+
+  /**
+     Same as above, as `mode` says.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> sync(const size_type offset, const size_type length,
+                                                          const sync_mode mode, std::error_code &error)
   {
     error.clear();
 
@@ -1091,23 +1380,88 @@ public:
       return;
     }
 
-    if (data()) {
-#ifdef _WIN32
-      if (::FlushViewOfFile(get_mapping_start(), mapped_length_) == 0
-          || ::FlushFileBuffers(file_handle_) == 0)
-#else // POSIX
-        if (::msync(get_mapping_start(), mapped_length_, MS_SYNC) != 0)
-#endif
-      {
-        error = detail::last_error();
-        return;
+    if (offset > length_ || (length != map_entire_file && length > length_ - offset)) {
+      error = std::make_error_code(std::errc::invalid_argument);
+      return;
+    }
+
+    const size_type first = mapping_offset() + offset;
+    const size_type last = length == map_entire_file ? mapped_length_ : first + length;
+    flush_pages(make_offset_page_aligned(first), last, mode, error);
+  }
+
+  /**
+     Records that the `length` bytes at `offset` (relative to `data`) have been
+     written to, for `sync_dirty` to flush them and only them. Once used, the
+     destructor also syncs the dirty ranges only. Writes are not tracked
+     otherwise: a range left out is not flushed until the kernel writes it back
+     on its own.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> mark_dirty(const size_type offset, const size_type length)
+  {
+    if (!data() || length == 0 || offset >= length_) return;
+
+    const size_type first = make_offset_page_aligned(mapping_offset() + offset);
+    const size_type last = mapping_offset() + offset + std::min(length, length_ - offset);
+    track_dirty_ = true;
+
+    // Writes often go forward: extend the last range when they touch it.
+    if (!dirty_.empty() && first <= dirty_.back().second && last >= dirty_.back().first) {
+      dirty_.back() = {std::min(first, dirty_.back().first), std::max(last, dirty_.back().second)};
+      return;
+    }
+    dirty_.emplace_back(first, last);
+  }
+
+  /**
+     Flushes the ranges given to `mark_dirty` since the last call, as `mode`
+     says, and forgets them. Errors are reported via `error`, the first one if
+     several ranges fail.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> sync_dirty(const sync_mode mode, std::error_code &error)
+  {
+    error.clear();
+
+    if (!is_open()) {
+      error = std::make_error_code(std::errc::bad_file_descriptor);
+      return;
+    }
+
+    // Merge the ranges that overlap, or share a page.
+    std::sort(dirty_.begin(), dirty_.end());
+    size_type merged = 0;
+    for (size_type i = 1; i < dirty_.size(); ++i) {
+      if (dirty_[i].first <= dirty_[merged].second) {
+        dirty_[merged].second = std::max(dirty_[merged].second, dirty_[i].second);
+      } else {
+        dirty_[++merged] = dirty_[i];
       }
     }
-#ifdef _WIN32
-    if (::FlushFileBuffers(file_handle_) == 0) {
-      error = detail::last_error();
+    if (!dirty_.empty()) dirty_.resize(merged + 1);
+
+    for (const auto &range : dirty_) {
+      std::error_code range_error;
+      flush_pages(range.first, range.second, mode, range_error);
+      if (range_error && !error) error = range_error;
     }
-#endif
+    dirty_.clear();
+  }
+
+  /**
+     Whether the destructor of a write mapping syncs it, `true` by default.
+     Opting out leaves the write-back to the kernel, or to an explicit `sync`.
+   */
+  template<access_mode A = AccessMode>
+  typename std::enable_if_t<A == access_mode::write> set_sync_on_destroy(const bool value) noexcept
+  {
+    sync_on_destroy_ = value;
+  }
+
+  [[nodiscard]] bool sync_on_destroy() const noexcept
+  {
+    return sync_on_destroy_;
   }
 
 private:
@@ -1127,6 +1481,18 @@ private:
     return !data() ? nullptr : data() - mapping_offset();
   }
 
+  /**
+     Flushes [first, last), from the start of the mapping, `first` being page
+     aligned.
+   */
+  void flush_pages(const size_type first, const size_type last, const sync_mode mode,
+                   std::error_code &error) const noexcept
+  {
+    char *start = const_cast<char *>(reinterpret_cast<const char *>(get_mapping_start()));
+    detail::flush(start ? start + first : nullptr, start ? last - first : 0, file_handle_,
+                  file_offset_ - mapping_offset() + first, mode, error);
+  }
+
   /**
      The destructor syncs changes to disk if `AccessMode` is `write`, but not
      if it's `read`. Because the destructor cannot be a template, we need to
@@ -1136,8 +1502,10 @@ private:
   typename std::enable_if_t<A == access_mode::write> conditional_sync()
   {
     // Invoked from destructor, so not much we can do about failures here.
+    if (!sync_on_destroy_) return;
     std::error_code ec;
-    sync(ec);
+    if (track_dirty_) sync_dirty(sync_mode::blocking, ec);
+    else sync(ec);
   }
 
   template<access_mode A = AccessMode>
@@ -1234,13 +1602,21 @@ using ummap_sink [[maybe_unused]] = basic_mmap_sink<unsigned char>;
  */
 template<typename MMap, typename MappingToken>
 MMap make_mmap(const MappingToken &token, typename MMap::size_type offset,
-               typename MMap::size_type length, std::error_code &error)
+               typename MMap::size_type length, const map_options &options,
+               std::error_code &error)
 {
   MMap mmap;
-  mmap.map(token, offset, length, error);
+  mmap.map(token, offset, length, options, error);
   return mmap;
 }
 
+template<typename MMap, typename MappingToken>
+MMap make_mmap(const MappingToken &token, typename MMap::size_type offset,
+               typename MMap::size_type length, std::error_code &error)
+{
+  return make_mmap<MMap>(token, offset, length, map_options{}, error);
+}
+
 /**
    Convenience factory method.
 
@@ -1255,12 +1631,27 @@ mmap_source make_mmap_source(const MappingToken &token, mmap_source::size_type o
   return make_mmap<mmap_source>(token, offset, length, error);
 }
 
+template<typename MappingToken>
+mmap_source make_mmap_source(const MappingToken &token, mmap_source::size_type offset,
+                             mmap_source::size_type length, const map_options &options,
+                             std::error_code &error)
+{
+  return make_mmap<mmap_source>(token, offset, length, options, error);
+}
+
 template<typename MappingToken>
 mmap_source make_mmap_source(const MappingToken &token, std::error_code &error)
 {
   return make_mmap_source(token, 0, map_entire_file, error);
 }
 
+template<typename MappingToken>
+mmap_source make_mmap_source(const MappingToken &token, const map_options &options,
+                             std::error_code &error)
+{
+  return make_mmap_source(token, 0, map_entire_file, options, error);
+}
+
 /**
    Convenience factory method.
 
@@ -1275,11 +1666,26 @@ mmap_sink make_mmap_sink(const MappingToken &token, mmap_sink::size_type offset,
   return make_mmap<mmap_sink>(token, offset, length, error);
 }
 
+template<typename MappingToken>
+mmap_sink make_mmap_sink(const MappingToken &token, mmap_sink::size_type offset,
+                         mmap_sink::size_type length, const map_options &options,
+                         std::error_code &error)
+{
+  return make_mmap<mmap_sink>(token, offset, length, options, error);
+}
+
 template<typename MappingToken>
 mmap_sink make_mmap_sink(const MappingToken &token, std::error_code &error)
 {
   return make_mmap_sink(token, 0, map_entire_file, error);
 }
+
+template<typename MappingToken>
+mmap_sink make_mmap_sink(const MappingToken &token, const map_options &options,
+                         std::error_code &error)
+{
+  return make_mmap_sink(token, 0, map_entire_file, options, error);
+}
 #pragma endregion
 
 #pragma region - basic_shared_mmap
@@ -1577,6 +1983,32 @@ public:
     map_impl(handle, 0, map_entire_file, error);
   }
 
+  template<typename MappingToken>
+  void map(const MappingToken &token, const size_type offset, const size_type length,
+           const map_options &options, std::error_code &error)
+  {
+    map_impl(token, offset, length, error, options);
+  }
+
+  template<typename MappingToken>
+  void map(const MappingToken &token, const map_options &options, std::error_code &error)
+  {
+    map_impl(token, 0, map_entire_file, error, options);
+  }
+
+  void advise(const size_type offset, const size_type length, const advice hint,
+              std::error_code &error) const noexcept
+  {
+    if (pimpl_) pimpl_->advise(offset, length, hint, error);
+    else error = std::make_error_code(std::errc::bad_file_descriptor);
+  }
+
+  void prefetch(const size_type offset, const size_type length,
+                std::error_code &error) const noexcept
+  {
+    advise(offset, length, advice::willneed, error);
+  }
+
   void unmap()
   {
     if (pimpl_) pimpl_->unmap();
@@ -1596,6 +2028,61 @@ public:
     if (pimpl_) pimpl_->sync(error);
   }
 
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void sync(const sync_mode mode, std::error_code &error)
+  {
+    if (pimpl_) pimpl_->sync(mode, error);
+  }
+
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void sync(const size_type offset, const size_type length, std::error_code &error)
+  {
+    if (pimpl_) pimpl_->sync(offset, length, error);
+  }
+
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void sync(const size_type offset, const size_type length, const sync_mode mode,
+            std::error_code &error)
+  {
+    if (pimpl_) pimpl_->sync(offset, length, mode, error);
+  }
+
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void mark_dirty(const size_type offset, const size_type length)
+  {
+    if (pimpl_) pimpl_->mark_dirty(offset, length);
+  }
+
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void sync_dirty(const sync_mode mode, std::error_code &error)
+  {
+    if (pimpl_) pimpl_->sync_dirty(mode, error);
+  }
+
+  template<
+      access_mode A = AccessMode,
+      typename = std::enable_if_t<A == access_mode::write>
+  >
+  void set_sync_on_destroy(const bool value) noexcept
+  {
+    if (pimpl_) pimpl_->set_sync_on_destroy(value);
+  }
+
   /** All operators compare the underlying `basic_mmap`'s addresses. */
   friend bool operator==(const basic_shared_mmap &a, const basic_shared_mmap &b)
   {
@@ -1630,16 +2117,17 @@ public:
 private:
   template<typename MappingToken>
   void map_impl(const MappingToken &token, const size_type offset,
-                const size_type length, std::error_code &error)
+                const size_type length, std::error_code &error,
+                const map_options &options = {})
   {
     if (!pimpl_) {
-      mmap_type mmap = make_mmap<mmap_type>(token, offset, length, error);
+      mmap_type mmap = make_mmap<mmap_type>(token, offset, length, options, error);
       if (error) {
         return;
       }
       pimpl_ = std::make_shared<mmap_type>(std::move(mmap));
     } else {
-      pimpl_->map(token, offset, length, error);
+      pimpl_->map(token, offset, length, options, error);
     }
   }
 };
@@ -0,0 +1,501 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_PARALLEL_H_
+#define _MIO_PARALLEL_H_
+
+#include <mio/linescan.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mio {
+
+/**
+   A fixed set of worker threads, reused from one parallel run to the next.
+
+   `run` hands the same job to every worker and returns once all of them are
+   done. The calling thread takes part as worker 0, so a pool of size N starts
+   N - 1 threads. Runs on one pool are serialized; a run started from inside
+   a job of the same pool calls the job for every worker in turn on the
+   calling thread, as its workers are all busy.
+
+   Example:
+
+     mio::thread_pool pool;  // one worker per hardware thread
+     pool.run([](size_t a_worker) { ... });
+ */
+class thread_pool
+{
+public:
+  /**
+     \param a_threads Number of workers, the calling thread included; 0 means
+                      one per hardware thread.
+   */
+  explicit thread_pool(size_t a_threads = 0)
+  {
+    if (a_threads == 0) a_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    m_threads.reserve(a_threads - 1);
+    for (size_t i = 1; i < a_threads; i++)
+      m_threads.emplace_back([this, i] { work(i); });
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard l_lock{m_mutex};
+      m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto &l_thread : m_threads) l_thread.join();
+  }
+
+  [[nodiscard]] size_t size() const noexcept
+  {
+    return m_threads.size() + 1;
+  }
+
+  /**
+     Runs a_job(worker) on every worker, worker in [0, size()), and waits for
+     all of them. If a job throws, the first exception is rethrown here once
+     all workers are done.
+   */
+  void run(const std::function<void(size_t)> &a_job)
+  {
+    if (t_current == this) {
+      // Nested in one of our own jobs: waiting for the workers would deadlock.
+      for (size_t i = 0; i < size(); i++) a_job(i);
+      return;
+    }
+
+    std::lock_guard l_run{m_run_mutex};
+    {
+      std::lock_guard l_lock{m_mutex};
+      m_job = &a_job;
+      m_pending = m_threads.size();
+      m_error = nullptr;
+      m_generation++;
+    }
+    m_wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock l_lock{m_mutex};
+    m_done.wait(l_lock, [this] { return m_pending == 0; });
+    m_job = nullptr;
+    if (m_error) std::rethrow_exception(m_error);
+  }
+
+  /**
+     A pool with one worker per hardware thread, created on first use.
+   */
+  static thread_pool &shared()
+  {
+    static thread_pool l_pool;
+    return l_pool;
+  }
+
+private:
+  void execute(size_t a_worker) noexcept
+  {
+    const thread_pool *l_outer = std::exchange(t_current, this);
+    try {
+      (*m_job)(a_worker);
+    } catch (...) {
+      std::lock_guard l_lock{m_mutex};
+      if (!m_error) m_error = std::current_exception();
+    }
+    t_current = l_outer;
+  }
+
+  void work(size_t a_worker)
+  {
+    uint64_t l_seen{0};
+    for (;;) {
+      {
+        std::unique_lock l_lock{m_mutex};
+        m_wake.wait(l_lock, [&] { return m_quit || m_generation != l_seen; });
+        if (m_quit) return;
+        l_seen = m_generation;
+      }
+
+      execute(a_worker);
+
+      std::lock_guard l_lock{m_mutex};
+      if (--m_pending == 0) m_done.notify_one();
+    }
+  }
+
+  // The pool whose job runs on this thread, if any.
+  static inline thread_local const thread_pool *t_current{nullptr};
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_run_mutex;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  const std::function<void(size_t)> *m_job{nullptr};
+  size_t m_pending{0};
+  uint64_t m_generation{0};
+  std::exception_ptr m_error;
+  bool m_quit{false};
+};
+
+namespace detail {
+
+/**
+   Hands out chunk indices [0, n) to a fixed number of workers.
+
+   Each worker starts with an even share of the indices, as one range, and
+   takes them from its front. Once its range is empty, it steals the back half
+   of another worker's range. A range is packed in one 64-bit word, so both
+   taking and stealing are a single compare-and-swap.
+ */
+class chunk_scheduler
+{
+public:
+  chunk_scheduler(size_t a_chunks, size_t a_workers) :
+      m_ranges(std::make_unique<range[]>(a_workers)), m_workers{a_workers}
+  {
+    for (size_t i = 0; i < a_workers; i++)
+      m_ranges[i].bounds.store(pack(a_chunks * i / a_workers, a_chunks * (i + 1) / a_workers),
+                               std::memory_order_relaxed);
+  }
+
+  /**
+     Gets the next chunk for a_worker, false once every chunk has been handed out.
+   */
+  bool next(size_t a_worker, size_t &a_chunk) noexcept
+  {
+    auto &l_own = m_ranges[a_worker].bounds;
+    uint64_t l_bounds = l_own.load(std::memory_order_relaxed);
+    while (begin(l_bounds) < end(l_bounds)) {
+      if (l_own.compare_exchange_weak(l_bounds, pack(begin(l_bounds) + 1, end(l_bounds)),
+                                      std::memory_order_relaxed)) {
+        a_chunk = begin(l_bounds);
+        return true;
+      }
+    }
+    return steal(a_worker, a_chunk);
+  }
+
+private:
+  struct alignas(64) range
+  {
+    std::atomic<uint64_t> bounds{0};
+  };
+
+  static uint64_t pack(uint64_t a_begin, uint64_t a_end) noexcept
+  {
+    return (a_end << 32) | a_begin;
+  }
+
+  static size_t begin(uint64_t a_bounds) noexcept
+  {
+    return static_cast<size_t>(a_bounds & 0xffffffffu);
+  }
+
+  static size_t end(uint64_t a_bounds) noexcept
+  {
+    return static_cast<size_t>(a_bounds >> 32);
+  }
+
+  bool steal(size_t a_worker, size_t &a_chunk) noexcept
+  {
+    for (size_t k = 1; k < m_workers; k++) {
+      auto &l_victim = m_ranges[(a_worker + k) % m_workers].bounds;
+      uint64_t l_bounds = l_victim.load(std::memory_order_relaxed);
+      while (begin(l_bounds) < end(l_bounds)) {
+        const size_t l_mid = begin(l_bounds) + (end(l_bounds) - begin(l_bounds)) / 2;
+        if (l_victim.compare_exchange_weak(l_bounds, pack(begin(l_bounds), l_mid),
+                                           std::memory_order_relaxed)) {
+          // Only this worker refills its own range, and only once it is empty:
+          // nobody else changes an empty range.
+          a_chunk = l_mid;
+          m_ranges[a_worker].bounds.store(pack(l_mid + 1, end(l_bounds)), std::memory_order_relaxed);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  std::unique_ptr<range[]> m_ranges;
+  size_t m_workers;
+};
+
+/**
+   Splits [a_first, a_last) into chunks of about a_chunk_size bytes, each one
+   the lines that start in its byte range. A line longer than a chunk belongs
+   to the chunk it starts in, the chunks it spans have no line.
+ */
+class line_chunks
+{
+public:
+  line_chunks(const char *a_first, const char *a_last, size_t a_chunk_size) noexcept :
+      m_first{a_first}, m_last{a_last}
+  {
+    const auto l_size = static_cast<size_t>(a_last - a_first);
+    // Chunk indices must fit the 32-bit halves of the scheduler's ranges.
+    m_chunk_size = std::max({a_chunk_size, size_t{1}, l_size / 0xffffffffu + 1});
+    m_count = (l_size + m_chunk_size - 1) / m_chunk_size;
+  }
+
+  [[nodiscard]] size_t count() const noexcept
+  {
+    return m_count;
+  }
+
+  /**
+     The lines of chunk a_index, as [a_begin, a_end), both at a line start.
+   */
+  void bounds(size_t a_index, const char *&a_begin, const char *&a_end) const noexcept
+  {
+    a_begin = line_start(a_index * m_chunk_size, m_chunk_size);
+    a_end = a_begin == m_last ? m_last : line_start((a_index + 1) * m_chunk_size, npos);
+  }
+
+  /**
+     Calls a_on_line(line) for each line in [a_begin, a_end), the last one
+     even if it does not end with '\n'. Returns the number of lines.
+   */
+  template<typename OnLine>
+  static size_t for_each(const char *a_begin, const char *a_end, OnLine &&a_on_line)
+  {
+    std::array<const char *, 256> l_found;
+    size_t l_count{0};
+    while (a_begin < a_end) {
+      const size_t l_n = scan_newlines(a_begin, a_end, l_found.data(), l_found.size());
+      for (size_t i = 0; i < l_n; i++) {
+        a_on_line(std::string_view{a_begin, static_cast<size_t>(l_found[i] - a_begin)});
+        a_begin = l_found[i] + 1;
+      }
+      l_count += l_n;
+      if (l_n < l_found.size()) {
+        if (a_begin < a_end) {
+          a_on_line(std::string_view{a_begin, static_cast<size_t>(a_end - a_begin)});
+          l_count++;
+        }
+        break;
+      }
+    }
+    return l_count;
+  }
+
+private:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // The first line start at or after a_offset, looking no further than
+  // a_limit bytes ahead; m_last if there is none.
+  const char *line_start(size_t a_offset, size_t a_limit) const noexcept
+  {
+    const auto l_size = static_cast<size_t>(m_last - m_first);
+    if (a_offset == 0) return m_first;
+    if (a_offset >= l_size) return m_last;
+
+    // A line starts at a_offset if the byte before it is a newline.
+    const char *l_from = m_first + a_offset - 1;
+    const char *l_to = a_limit >= static_cast<size_t>(m_last - l_from) ? m_last : l_from + a_limit;
+    const char *l_nl = find_newline(l_from, l_to);
+    return l_nl == l_to ? m_last : l_nl + 1;
+  }
+
+  const char *m_first;
+  const char *m_last;
+  size_t m_chunk_size;
+  size_t m_count;
+};
+
+} // namespace detail
+
+/**
+   Default byte size of the chunks parallel line processing hands out: small
+   enough to balance skewed workloads on many cores, large enough to make
+   scheduling cost negligible.
+ */
+inline constexpr size_t default_chunk_size = 1024 * 1024;
+
+/**
+   Calls a_on_line(line, state) for every line of [a_first, a_last) on the
+   workers of a_pool, lines without their '\n'. a_states is resized to one
+   state per worker, and a worker only ever touches its own state, so no
+   locking is needed; merging them afterwards is up to the caller. Lines are
+   processed in no particular order.
+
+   \returns The number of lines, the last one counted even if it does not end with '\n'.
+ */
+template<typename State, typename OnLine>
+size_t parallel_for_each_line(thread_pool &a_pool, const char *a_first, const char *a_last,
+                              std::vector<State> &a_states, OnLine &&a_on_line,
+                              size_t a_chunk_size = default_chunk_size)
+{
+  a_states.resize(a_pool.size());
+
+  const detail::line_chunks l_chunks{a_first, a_last, a_chunk_size};
+  detail::chunk_scheduler l_scheduler{l_chunks.count(), a_pool.size()};
+  std::atomic<size_t> l_total{0};
+
+  a_pool.run([&](size_t a_worker) {
+    State &l_state = a_states[a_worker];
+    size_t l_count{0}, l_chunk;
+    const char *l_begin, *l_end;
+    while (l_scheduler.next(a_worker, l_chunk)) {
+      l_chunks.bounds(l_chunk, l_begin, l_end);
+      l_count += detail::line_chunks::for_each(l_begin, l_end, [&](std::string_view a_line) {
+        a_on_line(a_line, l_state);
+      });
+    }
+    l_total.fetch_add(l_count, std::memory_order_relaxed);
+  });
+
+  return l_total.load(std::memory_order_relaxed);
+}
+
+/**
+   Same as above, without per-worker state: a_on_line(line) is called
+   concurrently from all the workers.
+ */
+template<typename OnLine>
+size_t parallel_for_each_line(thread_pool &a_pool, const char *a_first, const char *a_last,
+                              OnLine &&a_on_line, size_t a_chunk_size = default_chunk_size)
+{
+  struct none {};
+  std::vector<none> l_states;
+  return parallel_for_each_line(a_pool, a_first, a_last, l_states,
+                                [&](std::string_view a_line, none &) { a_on_line(a_line); },
+                                a_chunk_size);
+}
+
+/**
+   Parallel reduction over the lines of [a_first, a_last): every worker folds
+   the lines it gets into its own accumulator, a copy of a_init, with
+   a_accumulate(accumulator, line); the accumulators are then merged in worker
+   order with a_combine(left, right) -> T. a_init must be an identity of
+   a_combine, and a_combine associative, as lines reach workers in no
+   particular order.
+
+   Example, the length of the longest line:
+
+     auto l_longest = mio::parallel_reduce_lines(
+         pool, first, last, size_t{0},
+         [](size_t &a_max, std::string_view a_line) { a_max = std::max(a_max, a_line.size()); },
+         [](size_t a, size_t b) { return std::max(a, b); });
+ */
+template<typename T, typename Accumulate, typename Combine>
+T parallel_reduce_lines(thread_pool &a_pool, const char *a_first, const char *a_last, const T &a_init,
+                        Accumulate &&a_accumulate, Combine &&a_combine,
+                        size_t a_chunk_size = default_chunk_size)
+{
+  // One cache line each: accumulators are written for every line.
+  struct alignas(64) padded
+  {
+    T value;
+  };
+
+  std::vector<padded> l_states(a_pool.size(), padded{a_init});
+  parallel_for_each_line(a_pool, a_first, a_last, l_states,
+                         [&](std::string_view a_line, padded &a_state) { a_accumulate(a_state.value, a_line); },
+                         a_chunk_size);
+
+  T l_result = a_init;
+  for (auto &l_state : l_states) l_result = a_combine(std::move(l_result), std::move(l_state.value));
+  return l_result;
+}
+
+/**
+   Ordered delivery: a_on_line(line) maps every line to a result in parallel,
+   and a_on_result(result) receives the results one at a time, in the order
+   of the lines in the file.
+
+   A chunk's results are held until every chunk before it has been delivered,
+   so memory grows with how far the fastest worker runs ahead of the slowest.
+
+   \returns The number of lines.
+ */
+template<typename OnLine, typename OnResult>
+size_t parallel_transform_lines(thread_pool &a_pool, const char *a_first, const char *a_last,
+                                OnLine &&a_on_line, OnResult &&a_on_result,
+                                size_t a_chunk_size = default_chunk_size)
+{
+  using result_type = std::decay_t<std::invoke_result_t<OnLine &, std::string_view>>;
+
+  struct slot
+  {
+    std::vector<result_type> results;
+    std::atomic<bool> ready{false};
+  };
+
+  const detail::line_chunks l_chunks{a_first, a_last, a_chunk_size};
+  detail::chunk_scheduler l_scheduler{l_chunks.count(), a_pool.size()};
+  std::unique_ptr<slot[]> l_slots = std::make_unique<slot[]>(l_chunks.count());
+  std::mutex l_deliver_mutex;
+  size_t l_next{0}; // first chunk not delivered yet, guarded by l_deliver_mutex
+  std::atomic<size_t> l_total{0};
+
+  // Delivers the ready chunks in order, by whichever worker holds the lock.
+  const auto l_deliver = [&] {
+    while (l_next < l_chunks.count() && l_slots[l_next].ready.load(std::memory_order_acquire)) {
+      for (auto &l_result : l_slots[l_next].results) a_on_result(std::move(l_result));
+      std::vector<result_type>{}.swap(l_slots[l_next].results);
+      l_next++;
+    }
+  };
+
+  a_pool.run([&](size_t a_worker) {
+    size_t l_count{0}, l_chunk;
+    const char *l_begin, *l_end;
+    while (l_scheduler.next(a_worker, l_chunk)) {
+      l_chunks.bounds(l_chunk, l_begin, l_end);
+      auto &l_slot = l_slots[l_chunk];
+      l_count += detail::line_chunks::for_each(l_begin, l_end, [&](std::string_view a_line) {
+        l_slot.results.push_back(a_on_line(a_line));
+      });
+      l_slot.ready.store(true, std::memory_order_release);
+
+      // Not waiting for the lock: if it is busy, its holder or the final
+      // drain below delivers this chunk.
+      std::unique_lock l_lock{l_deliver_mutex, std::try_to_lock};
+      if (l_lock) l_deliver();
+    }
+    l_total.fetch_add(l_count, std::memory_order_relaxed);
+  });
+
+  l_deliver();
+  return l_total.load(std::memory_order_relaxed);
+}
+
+}
+
+#endif
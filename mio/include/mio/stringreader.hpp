@@ -20,11 +20,18 @@
 #ifndef _MIO_STRING_READER_H_
 #define _MIO_STRING_READER_H_
 
+#include <mio/lineindex.hpp>
+#include <mio/linescan.hpp>
 #include <mio/mio.hpp>
+#include <mio/parallel.hpp>
 
+#include <array>
 #include <functional>
 #include <future>
 #include <numeric>
+#include <span>
+#include <string_view>
+#include <vector>
 
 #ifdef __GNUC__
 #define semi_branch_expect(x, y) __builtin_expect(x, y)
@@ -71,11 +78,13 @@ public:
   [[maybe_unused]] explicit StringReader(const std::string &a_file) : m_mmap{a_file}
   {
     m_begin = m_mmap.begin();
+    advise_sequential();
   }
 
   explicit StringReader(const std::string &&a_file) : m_mmap{a_file}
   {
     m_begin = m_mmap.begin();
+    advise_sequential();
   }
 
   StringReader() = delete;
@@ -119,7 +128,7 @@ public:
   std::string_view getline() noexcept
   {
     const char *l_begin = m_begin;
-    const char *l_find = std::find(l_begin, m_mmap.end(), '\n');
+    const char *l_find = detail::find_newline(l_begin, m_mmap.end());
 
     // l_find == m_mmap.end() happens only once at end of file. The majority of the
     // processing will be for l_find != m_mmap.end(). Give this hint to the compiler
@@ -132,6 +141,146 @@ public:
     return {l_begin, static_cast<size_t>(l_find - l_begin)};
   }
 
+  /**
+     Reads up to a_lines.size() lines into a_lines, without their '\n'.
+     Lines are found a batch at a time with the vectorized scanner, so a parsing
+     loop pays one call per batch instead of one per line.
+
+     Unlike getline, the end of file yields no empty line: the last line is
+     returned only if it is not empty, whether or not it ends with '\n'.
+     Precondition - StringReader::is_mapped() must be true.
+
+     \returns The number of lines read, 0 once the reader has reached end of file.
+   */
+  size_t getlines(std::span<std::string_view> a_lines) noexcept
+  {
+    return read_batch(a_lines.size(), [&](size_t i, const char *a_begin, const char *a_end) {
+      a_lines[i] = {a_begin, static_cast<size_t>(a_end - a_begin)};
+    });
+  }
+
+  /**
+     Same as above, but stores the end offset of each line, that is the offset
+     of its '\n' (or the file size for a last line without one) from the start
+     of the file. A line starts one past the end of the previous one.
+
+     \returns The number of lines read, 0 once the reader has reached end of file.
+   */
+  size_t getlines(std::span<size_t> a_ends) noexcept
+  {
+    const char *l_start = m_mmap.begin();
+    return read_batch(a_ends.size(), [&](size_t i, const char *, const char *a_end) {
+      a_ends[i] = static_cast<size_t>(a_end - l_start);
+    });
+  }
+
+  /**
+     Calls a_fn(line) for every remaining line, without its '\n'. The handler
+     is a template parameter, not an OnGetline, so a cheap handler (counting,
+     hashing, picking a field) is inlined into the scanning loop instead of
+     being called indirectly for every line. Like getlines, the end of file
+     yields no empty line.
+     Precondition - StringReader::is_mapped() must be true.
+
+     \returns The number of lines read.
+   */
+  template<typename F>
+  size_t for_each_line(F &&a_fn)
+  {
+    if (eof()) return 0;
+
+    const size_t l_numlines = detail::line_chunks::for_each(m_begin, m_mmap.end(), a_fn);
+    m_begin = nullptr;
+    return l_numlines;
+  }
+
+  /**
+     Same as above, in parallel on the workers of a_pool: a_fn(line) is called
+     concurrently, in no particular order (see getline_async).
+   */
+  template<typename F>
+  size_t for_each_line(thread_pool &a_pool, F &&a_fn, size_t a_chunk_size = default_chunk_size)
+  {
+    if (eof()) return 0;
+
+    const size_t l_numlines = parallel_for_each_line(a_pool, m_begin, m_mmap.end(), a_fn, a_chunk_size);
+    m_begin = nullptr;
+    return l_numlines;
+  }
+
+  /**
+     Folds every remaining line into a_init with a_accumulate(value, line).
+
+     \returns The folded value.
+   */
+  template<typename T, typename Accumulate>
+  T reduce_lines(T a_init, Accumulate &&a_accumulate)
+  {
+    for_each_line([&](std::string_view a_line) { a_accumulate(a_init, a_line); });
+    return a_init;
+  }
+
+  /**
+     Same as above, in parallel on the workers of a_pool: each worker folds its
+     lines into its own copy of a_init, then the copies are merged with
+     a_combine(left, right) -> T (see parallel_reduce_lines).
+   */
+  template<typename T, typename Accumulate, typename Combine>
+  T reduce_lines(thread_pool &a_pool, const T &a_init, Accumulate &&a_accumulate, Combine &&a_combine,
+                 size_t a_chunk_size = default_chunk_size)
+  {
+    if (eof()) return a_init;
+
+    T l_result = parallel_reduce_lines(a_pool, m_begin, m_mmap.end(), a_init, a_accumulate, a_combine,
+                                       a_chunk_size);
+    m_begin = nullptr;
+    return l_result;
+  }
+
+  /**
+     Moves the reader to the start of line a_line (0 for the first), found
+     through a_index in O(stride) instead of reading every line before it:
+     up to stride - 1 lines are scanned, none with LineIndex::exact_stride.
+     Precondition - a_index is the index of this file (see LineIndex::matches).
+
+     \returns False, with the reader at end of file, if there is no such line.
+   */
+  bool seek_line(const LineIndex &a_index, uint64_t a_line) noexcept
+  {
+    if (a_line >= a_index.lines()) {
+      m_begin = nullptr;
+      return false;
+    }
+    m_begin = m_mmap.begin() + a_index.line_offset(a_line, m_mmap.begin(), m_mmap.end());
+    return true;
+  }
+
+  /**
+     Splits the file into a_parts byte ranges of the same number of lines, to
+     within one, through a_index: part i holds lines [i * n / a_parts,
+     (i + 1) * n / a_parts) of the n lines, '\n' included. A part is empty if
+     there are fewer lines than parts. The ranges can be handed as is to
+     parallel_for_each_line, or read on as many threads.
+     Precondition - a_index is the index of this file (see LineIndex::matches).
+   */
+  [[nodiscard]] std::vector<std::string_view> partition(const LineIndex &a_index, size_t a_parts) const
+  {
+    std::vector<std::string_view> l_parts;
+    l_parts.reserve(a_parts);
+
+    const char *l_first = m_mmap.begin();
+    uint64_t l_begin{0};
+    for (size_t i = 1; i <= a_parts; i++) {
+      // n * i / a_parts, without overflowing n * i.
+      const uint64_t l_n = a_index.lines();
+      const uint64_t l_line = l_n / a_parts * i + l_n % a_parts * i / a_parts;
+      const uint64_t l_end = a_index.line_offset(l_line, l_first, m_mmap.end());
+      l_parts.emplace_back(l_first + l_begin, static_cast<size_t>(l_end - l_begin));
+      l_begin = l_end;
+    }
+    return l_parts;
+  }
+
   size_t getline(const OnGetline &a_on_getline)
   {
     size_t l_numlines{0};
@@ -145,71 +294,82 @@ public:
   }
 
   /**
-   Reads a new line asynchronously.
+   Reads all the remaining lines in parallel, a_on_getline being called
+   concurrently from the workers of a_pool, in no particular order. The file
+   is cut into many small chunks, each one the lines that start in it, and
+   idle workers steal chunks from busy ones, so long and short lines mix
+   without leaving cores idle. Unlike getline, the end of file yields no
+   empty line. For per-worker state or ordered results, see mio/parallel.hpp.
    Precondition - StringReader::is_mapped() must be true.
 
+   \param a_pool Workers to run on, the calling thread included.
    \param a_on_getline Event handler when a new line is read.
-   \tparam NumThreads Number of threads to run parallel.
-   \tparam MinFileByteSize Minimum byte size of the file required for async processing to kick in.
+   \param a_chunk_size Byte size of the chunks handed out to workers.
 
    \returns Total number of lines read.
  */
-  template<uint8_t NumThreads = 2, size_t MinFileByteSize = 1024 * 1024>
-  requires (NumThreads >= 2) and (NumThreads <= 8) and (MinFileByteSize >= 1024 * 1024)
-  [[maybe_unused]] size_t getline_async(const OnGetline &a_on_getline)
+  size_t getline_async(thread_pool &a_pool, const OnGetline &a_on_getline,
+                       size_t a_chunk_size = default_chunk_size)
   {
-    // Fallback to default sequential getline.
-    if (m_mmap.size() < MinFileByteSize)
-      return getline(a_on_getline);
-
-    // Spawn a couple of futures, and do async processing.
-    std::array<std::unique_ptr<std::future<size_t>>, NumThreads> l_futures;
+    return for_each_line(a_pool, a_on_getline, a_chunk_size);
+  }
 
-    const auto l_adv = m_mmap.size() / NumThreads;
-    const char *l_begin = m_begin;
-    const char *l_end = find_end(l_begin, l_adv);
+  /**
+   Same as above, on a pool of NumThreads workers kept for all the calls with
+   the same NumThreads, or on thread_pool::shared() if NumThreads is 0.
 
-    for (int i = 0; i < l_futures.size(); i++) {
-      *l_futures[i] = std::async(do_getline_async, l_begin, l_end, a_on_getline);
+   \tparam NumThreads Number of threads to run parallel, 0 for one per hardware thread.
+   \tparam MinFileByteSize Minimum byte size of the file required for async processing to kick in.
 
-      l_begin = l_end;
-      l_end = find_end(l_begin, l_adv);
+   \returns Total number of lines read.
+ */
+  template<size_t NumThreads = 0, size_t MinFileByteSize = 1024 * 1024>
+  [[maybe_unused]] size_t getline_async(const OnGetline &a_on_getline)
+  {
+    // Fall back to a sequential read, with no empty line at the end either.
+    if (m_mmap.size() < MinFileByteSize)
+      return for_each_line(a_on_getline);
 
-      if (std::distance(l_end, m_mmap.end()) < l_adv)
-        l_end = m_mmap.end();
+    if constexpr (NumThreads == 0) {
+      return getline_async(thread_pool::shared(), a_on_getline);
+    } else {
+      static thread_pool l_pool{NumThreads};
+      return getline_async(l_pool, a_on_getline);
     }
-
-    // Collect the total number of lines read.
-    return std::accumulate(l_futures.begin(), l_futures.end(), 0, [](auto &a, size_t b) { return a->get() + b; });
   }
 
 private:
-  static size_t do_getline_async(const char *a_begin, const char *a_end, const OnGetline &a_on_getline)
+  template<typename OnLine>
+  size_t read_batch(size_t a_max, OnLine &&a_on_line) noexcept
   {
-    const char *l_begin = a_begin;
-    const char *l_find = std::find(l_begin, a_end, '\n');
-
-    size_t l_counter{0};
-
-    while (l_find != a_end) {
-      a_on_getline({l_begin, static_cast<size_t>(l_find - l_begin)}), l_counter++;
-      l_begin = std::next(l_find);
-      l_find = std::find(l_begin, a_end, '\n');
+    std::array<const char *, 256> l_found;
+    size_t l_count{0};
+
+    while (l_count < a_max && m_begin) {
+      const size_t l_want = std::min(l_found.size(), a_max - l_count);
+      const size_t l_n = detail::scan_newlines(m_begin, m_mmap.end(), l_found.data(), l_want);
+
+      for (size_t i = 0; i < l_n; ++i) {
+        a_on_line(l_count++, m_begin, l_found[i]);
+        m_begin = l_found[i] + 1;
+      }
+
+      if (l_n < l_want) {
+        // No newline left: whatever remains is the last line.
+        if (m_begin != m_mmap.end()) a_on_line(l_count++, m_begin, m_mmap.end());
+        m_begin = nullptr;
+      }
     }
-
-    return l_counter;
+    return l_count;
   }
 
-  static const char *find_end(const char *a_begin, size_t a_advance)
+  /**
+     The file is read front to back: let the kernel read ahead aggressively.
+   */
+  void advise_sequential() noexcept
   {
-    using iter_diff_t = typename std::iterator_traits<const char *>::difference_type;
-
-    auto l_find = std::find(
-        std::reverse_iterator(std::next(a_begin, static_cast<iter_diff_t>(a_advance))),
-        std::reverse_iterator(a_begin),
-        '\n').base();
-
-    return std::next(l_find);
+    std::error_code l_error;
+    m_mmap.advise(0, map_entire_file, advice::sequential, l_error);
   }
 
 private:
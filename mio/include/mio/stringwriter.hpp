@@ -0,0 +1,392 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_STRING_WRITER_H_
+#define _MIO_STRING_WRITER_H_
+
+#include <mio/mio.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+namespace mio {
+
+/**
+   How a StringWriter grows its file.
+ */
+struct writer_options
+{
+  // Bytes of the first chunk mapped. Each next chunk is twice as large, up
+  // to max_chunk_size.
+  size_t chunk_size = size_t{64} << 20;
+  size_t max_chunk_size = size_t{1} << 30;
+
+  // Keep what the file holds and write after it, instead of truncating it.
+  bool append = false;
+
+  // Flush each full chunk to disk (msync) and unmap it on a helper thread,
+  // while the next one is written.
+  bool background_sync = false;
+};
+
+namespace detail {
+
+/**
+   Opens a_file for writing, creating it if needed, truncating it unless
+   a_append.
+ */
+inline file_handle_type create_file(const std::string &a_file, bool a_append, std::error_code &a_error) noexcept
+{
+  a_error.clear();
+#ifdef _WIN32
+  const auto l_handle = ::CreateFileA(a_file.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                                      a_append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+#else
+  const auto l_handle = ::open(a_file.c_str(), O_RDWR | O_CREAT | (a_append ? 0 : O_TRUNC), 0644);
+#endif
+  if (l_handle == invalid_handle) a_error = last_error();
+  return l_handle;
+}
+
+/**
+   Sets the size of the file behind a_handle to a_size.
+ */
+inline void resize_file(file_handle_type a_handle, uint64_t a_size, std::error_code &a_error) noexcept
+{
+  a_error.clear();
+#ifdef _WIN32
+  LARGE_INTEGER l_size;
+  l_size.QuadPart = static_cast<LONGLONG>(a_size);
+  if (::SetFilePointerEx(a_handle, l_size, nullptr, FILE_BEGIN) == 0 || ::SetEndOfFile(a_handle) == 0)
+    a_error = last_error();
+#else
+  if (::ftruncate(a_handle, static_cast<off_t>(a_size)) != 0) a_error = last_error();
+#endif
+}
+
+/**
+   Grows the file behind a_handle from a_size to a_new_size, with its disk
+   blocks allocated where the file system can: running out of space then
+   fails here rather than as a SIGBUS on writing through the mapping.
+ */
+inline void grow_file(file_handle_type a_handle, uint64_t a_size, uint64_t a_new_size,
+                      std::error_code &a_error) noexcept
+{
+#ifdef __linux__
+  if (::fallocate(a_handle, 0, static_cast<off_t>(a_size), static_cast<off_t>(a_new_size - a_size)) == 0) {
+    a_error.clear();
+    return;
+  }
+  if (errno != EOPNOTSUPP && errno != ENOSYS) {
+    a_error = last_error();
+    return;
+  }
+#else
+  (void) a_size;
+#endif
+  resize_file(a_handle, a_new_size, a_error);
+}
+
+} // namespace detail
+
+/**
+   A fast line writer based on memory mapped file, the mirror image of
+   StringReader. The file is grown a chunk at a time, each one twice as large
+   as the last up to writer_options::max_chunk_size, allocated ahead
+   (fallocate, or ftruncate) and mapped; writes are plain copies into the
+   mapping. close, or the destructor, cuts the file to the bytes written.
+
+   A file left by a writer that did not close has zeros after its content,
+   up to the end of the last chunk.
+
+   Example:
+
+     mio::StringWriter writer("out.csv");
+     for (const auto &link : links)
+       writer.writeline(link.to_string());
+     writer.close();
+ */
+class StringWriter
+{
+public:
+  /**
+     Creates a_file, or truncates it unless a_options.append. If it cannot be
+     opened, std::system_error is thrown with the error code describing why.
+
+     \param   a_file     The file to write.
+     \param   a_options  Chunk sizes and flushing policy.
+   */
+  explicit StringWriter(const std::string &a_file, const writer_options &a_options = {}) :
+      m_options{a_options}
+  {
+    m_options.chunk_size = std::max(m_options.chunk_size, page_size());
+    m_options.max_chunk_size = std::max(m_options.max_chunk_size, m_options.chunk_size);
+
+    std::error_code l_error;
+    m_handle = detail::create_file(a_file, a_options.append, l_error);
+    if (!l_error) m_reserved = m_offset = detail::query_file_size(m_handle, l_error);
+    if (l_error) {
+      close_handle();
+      throw std::system_error(l_error);
+    }
+
+    if (m_options.background_sync) m_syncer = std::thread{[this] { sync_chunks(); }};
+  }
+
+  StringWriter() = delete;
+  StringWriter(const StringWriter &) = delete;
+  StringWriter(StringWriter &&) = delete;
+  StringWriter &operator=(StringWriter &) = delete;
+  StringWriter &operator=(StringWriter &&) = delete;
+
+  /**
+     Closes the file, see close. Errors are ignored: call close to see them.
+   */
+  ~StringWriter()
+  {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  /**
+     Checks whether the writer has a file open, that is until close.
+   */
+  [[nodiscard]] bool is_open() const noexcept
+  {
+    return m_handle != invalid_handle;
+  }
+
+  /**
+     The number of bytes of the file, those written included.
+   */
+  [[nodiscard]] uint64_t size() const noexcept
+  {
+    return m_offset + static_cast<uint64_t>(m_cursor - m_chunk_begin);
+  }
+
+  /**
+     Appends a_bytes. If the file cannot be grown or mapped, std::system_error
+     is thrown.
+     Precondition - StringWriter::is_open() must be true.
+   */
+  void write(std::string_view a_bytes)
+  {
+    // Before the first chunk, the cursor is null: memcpy must not see it.
+    if (a_bytes.empty()) [[unlikely]] return;
+
+    if (a_bytes.size() <= static_cast<size_t>(m_chunk_end - m_cursor)) [[likely]] {
+      std::memcpy(m_cursor, a_bytes.data(), a_bytes.size());
+      m_cursor += a_bytes.size();
+      return;
+    }
+
+    // The chunk runs out: fill it, then go on in the next ones.
+    while (!a_bytes.empty()) {
+      if (m_cursor == m_chunk_end) next_chunk();
+      const size_t l_n = std::min(a_bytes.size(), static_cast<size_t>(m_chunk_end - m_cursor));
+      std::memcpy(m_cursor, a_bytes.data(), l_n);
+      m_cursor += l_n;
+      a_bytes.remove_prefix(l_n);
+    }
+  }
+
+  /**
+     Appends a_line and a '\n'.
+   */
+  void writeline(std::string_view a_line)
+  {
+    if (a_line.size() < static_cast<size_t>(m_chunk_end - m_cursor)) [[likely]] {
+      std::memcpy(m_cursor, a_line.data(), a_line.size());
+      m_cursor += a_line.size();
+      *m_cursor++ = '\n';
+      return;
+    }
+    write(a_line);
+    write({"\n", 1});
+  }
+
+  /**
+     Unmaps the last chunk, waits for the background flushes, cuts the file to
+     size() bytes, and closes it. If any of this fails, std::system_error is
+     thrown, the file being closed all the same. Does nothing if closed.
+   */
+  void close()
+  {
+    if (!is_open()) return;
+
+    const uint64_t l_size = size();
+    std::error_code l_error = retire_chunk();
+
+    if (m_syncer.joinable()) {
+      {
+        std::lock_guard l_lock{m_mutex};
+        m_stop = true;
+      }
+      m_wake.notify_all();
+      m_syncer.join();
+      if (!l_error) l_error = m_sync_error;
+    }
+
+    std::error_code l_resize_error;
+    detail::resize_file(m_handle, l_size, l_resize_error);
+    if (!l_error) l_error = l_resize_error;
+    close_handle();
+    if (l_error) throw std::system_error(l_error);
+  }
+
+private:
+  /**
+     Maps the next chunk, from the first byte not written, growing the file
+     to hold it if needed.
+   */
+  void next_chunk()
+  {
+    const uint64_t l_offset = size();
+    if (const auto l_error = retire_chunk()) throw std::system_error(l_error);
+
+#ifdef _WIN32
+    // A file cannot be resized while any part of it is mapped.
+    drain();
+#endif
+
+    const size_t l_length = m_next_chunk_size ? m_next_chunk_size : m_options.chunk_size;
+    m_next_chunk_size = std::min(2 * l_length, m_options.max_chunk_size);
+
+    std::error_code l_error;
+    if (l_offset + l_length > m_reserved) {
+      detail::grow_file(m_handle, m_reserved, l_offset + l_length, l_error);
+      if (l_error) throw std::system_error(l_error);
+      m_reserved = l_offset + l_length;
+    }
+
+    m_chunk.map(m_handle, l_offset, l_length, l_error);
+    if (l_error) throw std::system_error(l_error);
+
+    m_offset = l_offset;
+    m_chunk_begin = m_cursor = m_chunk.data();
+    m_chunk_end = m_chunk_begin + l_length;
+  }
+
+  /**
+     Unmaps the current chunk, through the helper thread if background_sync.
+   */
+  std::error_code retire_chunk()
+  {
+    m_offset = size();
+    m_chunk_begin = m_cursor = m_chunk_end = nullptr;
+    if (!m_chunk.is_mapped()) return {};
+
+    if (!m_syncer.joinable()) {
+      m_chunk.unmap();
+      return {};
+    }
+
+    // One chunk in flight at most, queued or being flushed, so that dirty
+    // pages do not pile up faster than the disk takes them.
+    std::unique_lock l_lock{m_mutex};
+    m_wake.wait(l_lock, [&] { return m_retired.empty() && !m_syncing; });
+    m_retired.push_back(std::move(m_chunk));
+    m_chunk = mmap_sink{};
+    l_lock.unlock();
+    m_wake.notify_all();
+    return {};
+  }
+
+  /**
+     Waits until the helper thread has no chunk left.
+   */
+  void drain()
+  {
+    if (!m_syncer.joinable()) return;
+    std::unique_lock l_lock{m_mutex};
+    m_wake.wait(l_lock, [&] { return m_retired.empty() && !m_syncing; });
+  }
+
+  /**
+     The helper thread: flushes and unmaps the chunks retired.
+   */
+  void sync_chunks()
+  {
+    std::unique_lock l_lock{m_mutex};
+    for (;;) {
+      m_wake.wait(l_lock, [&] { return m_stop || !m_retired.empty(); });
+      if (m_retired.empty()) return;
+
+      mmap_sink l_chunk = std::move(m_retired.front());
+      m_retired.pop_front();
+      m_syncing = true;
+      l_lock.unlock();
+      m_wake.notify_all();
+
+      std::error_code l_error;
+      l_chunk.sync(l_error);
+      l_chunk.unmap();
+
+      l_lock.lock();
+      m_syncing = false;
+      if (l_error && !m_sync_error) m_sync_error = l_error;
+      m_wake.notify_all();
+    }
+  }
+
+  void close_handle() noexcept
+  {
+    if (m_handle == invalid_handle) return;
+#ifdef _WIN32
+    ::CloseHandle(m_handle);
+#else
+    ::close(m_handle);
+#endif
+    m_handle = invalid_handle;
+  }
+
+private:
+  writer_options m_options;
+  file_handle_type m_handle{invalid_handle};
+  uint64_t m_reserved{0};         // the size of the file, allocated ahead
+  uint64_t m_offset{0};           // of the chunk in the file
+  size_t m_next_chunk_size{0};
+  mmap_sink m_chunk;
+  char *m_chunk_begin{nullptr};
+  char *m_cursor{nullptr};
+  char *m_chunk_end{nullptr};
+
+  std::thread m_syncer;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<mmap_sink> m_retired;
+  bool m_syncing{false};
+  bool m_stop{false};
+  std::error_code m_sync_error;
+};
+
+}
+
+#endif
@@ -0,0 +1,310 @@
+/* Copyright 2022 Wuping Xin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MIO_WINDOWED_READER_H_
+#define _MIO_WINDOWED_READER_H_
+
+#include <mio/linescan.hpp>
+#include <mio/mio.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace mio {
+
+/**
+   How much of the file a WindowedReader keeps mapped and resident.
+ */
+struct window_options
+{
+  // Bytes mapped at a time. A line longer than this gets a window of its own,
+  // twice the size of what has been found of it so far.
+  size_t window_size = size_t{256} << 20;
+
+  // Every release_step bytes read, the pages before the line being returned
+  // are dropped from the mapping (MADV_DONTNEED) instead of staying resident
+  // until the window moves on. 0 keeps them.
+  size_t release_step = 0;
+
+  // Also evict the pages read from the page cache (posix_fadvise, where
+  // available), so that a single pass over a huge file does not push
+  // everything else out of it.
+  bool drop_page_cache = false;
+
+  /**
+     Options that keep at most a_max_resident bytes of the file mapped, a
+     quarter of that resident at a time, and nothing cached behind the
+     cursor. Only a line longer than a_max_resident goes over the cap.
+   */
+  static window_options capped(size_t a_max_resident) noexcept
+  {
+    window_options l_options;
+    l_options.window_size = a_max_resident;
+    l_options.release_step = std::max(a_max_resident / 4, size_t{1});
+    l_options.drop_page_cache = true;
+    return l_options;
+  }
+};
+
+/**
+   A line reader for files larger than memory. Where StringReader maps the
+   whole file, and its resident size grows with every page touched, this one
+   maps a window of window_options::window_size bytes and, when the cursor
+   reaches the end of it, maps the next one from the start of the first
+   unfinished line, so a line is never split across windows.
+
+   getline behaves as StringReader::getline, but a line is valid only until
+   the window moves on, which may be the next call to getline: copy what must
+   outlive it.
+
+   Example:
+
+     mio::WindowedReader reader("huge.csv", mio::window_options::capped(64 << 20));
+     while (!reader.eof()) {
+       auto line = reader.getline();
+       // ... do something about the line just read.
+     }
+ */
+class WindowedReader
+{
+public:
+  /**
+    Fires when a new line has been read.
+  */
+  using OnGetline = std::function<void(const std::string_view)>;
+
+  /**
+     Opens a_file and maps its first window. If the file cannot be opened or
+     mapped, std::system_error is thrown with the error code describing why.
+
+     \param   a_file     The file to read. It must exist.
+     \param   a_options  Window size and page release policy.
+   */
+  explicit WindowedReader(const std::string &a_file, const window_options &a_options = {}) :
+      m_options{a_options}
+  {
+    m_options.window_size = std::max(m_options.window_size, page_size());
+
+    std::error_code l_error;
+    m_handle = detail::open_file(a_file, access_mode::read, l_error);
+    if (!l_error) m_size = detail::query_file_size(m_handle, l_error);
+    if (l_error) {
+      close();
+      throw std::system_error(l_error);
+    }
+
+    try {
+      slide(0, m_options.window_size);
+    } catch (...) {
+      close();
+      throw;
+    }
+  }
+
+  WindowedReader() = delete;
+  WindowedReader(const WindowedReader &) = delete;
+  WindowedReader(WindowedReader &&) = delete;
+  WindowedReader &operator=(WindowedReader &) = delete;
+  WindowedReader &operator=(WindowedReader &&) = delete;
+
+  ~WindowedReader()
+  {
+    m_window.unmap();
+    close();
+  }
+
+  /**
+     Checks whether the reader has reached end of file.
+
+     \returns True if end of line, false otherwise.
+   */
+  [[nodiscard]] bool eof() const noexcept
+  {
+    return (m_begin == nullptr);
+  }
+
+  /**
+     Checks whether the reader has successfully opened the underlying file.
+
+     \returns True if opened, false otherwise.
+   */
+  [[nodiscard]] bool is_mapped() const noexcept
+  {
+    return m_handle != invalid_handle;
+  }
+
+  /**
+     The size of the file.
+   */
+  [[nodiscard]] uint64_t size() const noexcept
+  {
+    return m_size;
+  }
+
+  /**
+     The number of bytes of the file mapped now, 0 once the reader has
+     reached end of file.
+   */
+  [[nodiscard]] size_t mapped_length() const noexcept
+  {
+    return m_window.mapped_length();
+  }
+
+  /**
+     Reads a new line into a string view, valid until the next call.
+     If the next window cannot be mapped, std::system_error is thrown.
+     Precondition - WindowedReader::is_mapped() must be true.
+
+     \returns A std::string_view, {nullptr, 0} will be returned if the reader has reached end of file.
+   */
+  std::string_view getline()
+  {
+    while (m_begin) {
+      const char *l_find = detail::find_newline(m_begin, m_end);
+
+      if (l_find != m_end) [[likely]] {
+        const std::string_view l_line{m_begin, static_cast<size_t>(l_find - m_begin)};
+        release_behind(m_begin);
+        m_begin = std::next(l_find);
+        return l_line;
+      }
+
+      const uint64_t l_offset = m_offset + static_cast<uint64_t>(m_begin - m_window_begin);
+      const auto l_partial = static_cast<size_t>(m_end - m_begin);
+      if (m_offset + static_cast<uint64_t>(m_end - m_window_begin) == m_size) {
+        // Same as StringReader: an unterminated last line is not returned.
+        m_begin = nullptr;
+        evict(m_offset + m_released, m_size);
+        m_window.unmap();
+        break;
+      }
+      // The line straddles the window: map the next one from its start.
+      slide(l_offset, std::max(m_options.window_size, 2 * l_partial));
+    }
+    return {nullptr, 0};
+  }
+
+  size_t getline(const OnGetline &a_on_getline)
+  {
+    size_t l_numlines{0};
+
+    while (!this->eof()) {
+      a_on_getline(this->getline());
+      l_numlines++;
+    }
+    return l_numlines;
+  }
+
+private:
+  /**
+     Maps a_length bytes (or up to the end of file) from a_offset, in place of
+     the current window, which is unmapped first so that the two never add up.
+   */
+  void slide(uint64_t a_offset, size_t a_length)
+  {
+    if (m_window.is_mapped()) {
+      evict(m_offset + m_released, a_offset);
+      m_window.unmap();
+    }
+
+    m_offset = a_offset;
+    m_released = 0;
+
+    const auto l_length = static_cast<size_t>(std::min<uint64_t>(a_length, m_size - a_offset));
+    if (l_length == 0) {
+      // An empty file: nothing to map, the first getline reaches end of file.
+      m_window_begin = m_begin = m_end = "";
+      return;
+    }
+
+    std::error_code l_error;
+    m_window.map(m_handle, a_offset, l_length, map_options{.hint = advice::sequential}, l_error);
+    if (l_error) throw std::system_error(l_error);
+
+    m_window_begin = m_begin = m_window.begin();
+    m_end = m_window.end();
+  }
+
+  /**
+     Every release_step bytes, drops the whole pages before a_keep, the start
+     of the line about to be returned.
+   */
+  void release_behind(const char *a_keep) noexcept
+  {
+    if (m_options.release_step == 0) return;
+
+    const auto l_read = static_cast<size_t>(a_keep - m_window_begin);
+    if (l_read - m_released < m_options.release_step) return;
+
+    // Not the page the line starts in: the caller is about to read it.
+    const uint64_t l_upto = make_offset_page_aligned(m_offset + l_read);
+    if (l_upto <= m_offset + m_released) return;
+
+    const auto l_length = static_cast<size_t>(l_upto - m_offset - m_released);
+    std::error_code l_error;
+    m_window.advise(m_released, l_length, advice::dontneed, l_error);
+    evict(m_offset + m_released, l_upto);
+    m_released += l_length;
+  }
+
+  /**
+     Evicts [a_first, a_last) of the file from the page cache if asked to.
+   */
+  void evict(uint64_t a_first, uint64_t a_last) const noexcept
+  {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    if (m_options.drop_page_cache && a_last > a_first)
+      ::posix_fadvise(m_handle, static_cast<off_t>(a_first), static_cast<off_t>(a_last - a_first),
+                      POSIX_FADV_DONTNEED);
+#else
+    (void) a_first;
+    (void) a_last;
+#endif
+  }
+
+  void close() noexcept
+  {
+    if (m_handle == invalid_handle) return;
+#ifdef _WIN32
+    ::CloseHandle(m_handle);
+#else
+    ::close(m_handle);
+#endif
+    m_handle = invalid_handle;
+  }
+
+private:
+  window_options m_options;
+  file_handle_type m_handle{invalid_handle};
+  uint64_t m_size{0};
+  mmap_source m_window;
+  uint64_t m_offset{0};           // of the window in the file
+  size_t m_released{0};           // bytes of the window already released
+  const char *m_window_begin{nullptr};
+  const char *m_begin{nullptr};   // the cursor, nullptr at end of file
+  const char *m_end{nullptr};
+};
+
+}
+
+#endif
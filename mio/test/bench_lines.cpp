@@ -0,0 +1,160 @@
+#include <mio/linescan.hpp>
+#include <mio/parallel.hpp>
+#include <mio/stringreader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Line splitting throughput, in GB/s of file read, warm cache, and lines read:
+//
+//   mio.bench_lines [file-size-in-MiB, default 512] [path, default bench-lines.csv]
+//
+// A file is generated at `path` if it does not exist or is smaller than asked.
+
+namespace {
+
+void make_file(const std::filesystem::path &path, size_t size)
+{
+  std::error_code ec;
+  if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) >= size) return;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  std::string line;
+  for (size_t written = 0, i = 0; written < size; written += line.size(), ++i) {
+    line = std::to_string(i) + ",link," + std::to_string(i * 7 % 1000) + ",node,"
+         + std::to_string(i * 13 % 100000) + "\n";
+    out << line;
+  }
+}
+
+template<typename Fn>
+void report(const char *name, size_t bytes, Fn &&fn)
+{
+  using namespace std::chrono;
+
+  const auto t0 = steady_clock::now();
+  const size_t lines = fn();
+  const auto t1 = steady_clock::now();
+
+  const double seconds = duration_cast<duration<double>>(t1 - t0).count();
+  std::printf("%-28s %8.2f GB/s %12zu\n", name, static_cast<double>(bytes) / 1e9 / seconds, lines);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  const size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+  const std::filesystem::path path = argc > 2 ? argv[2] : "bench-lines.csv";
+
+  make_file(path, mib * 1024 * 1024);
+  const size_t bytes = std::filesystem::file_size(path);
+
+  // Warm the page cache, so that every run below reads from memory.
+  {
+    mio::mmap_source m(path.string());
+    volatile size_t n = std::count(m.begin(), m.end(), '\n');
+    (void) n;
+  }
+
+  report("std::getline", bytes, [&] {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    size_t n = 0;
+    while (std::getline(in, line)) ++n;
+    return n;
+  });
+
+  report("std::find per line", bytes, [&] {
+    // What StringReader::getline did before the vectorized scanner.
+    mio::mmap_source m(path.string());
+    size_t n = 0;
+    for (const char *p = m.begin(), *f; (f = std::find(p, m.end(), '\n')) != m.end(); p = f + 1) ++n;
+    return n;
+  });
+
+  report("StringReader::getline", bytes, [&] {
+    mio::StringReader reader(path.string());
+    size_t n = 0;
+    while (!reader.eof()) reader.getline(), ++n;
+    return n - 1; // the empty view at end of file
+  });
+
+  for (const auto level : {mio::simd_level::scalar, mio::simd_level::sse2,
+                           mio::simd_level::avx2, mio::simd_level::avx512}) {
+    static const char *names[] = {"batch of 256, scalar", "batch of 256, sse2",
+                                  "batch of 256, avx2", "batch of 256, avx512"};
+    if (level > mio::supported_simd_level()) break;
+    report(names[static_cast<int>(level)], bytes, [&] {
+      mio::mmap_source m(path.string());
+      const auto scan = mio::detail::newline_scan_for(level);
+      const char *found[256];
+      size_t n = 0, got;
+      for (const char *p = m.begin(); (got = scan(p, m.end(), found, 256)) > 0; p = found[got - 1] + 1) n += got;
+      return n;
+    });
+  }
+
+  report("StringReader::getlines", bytes, [&] {
+    mio::StringReader reader(path.string());
+    std::string_view lines[256];
+    size_t n = 0, got;
+    while ((got = reader.getlines(lines)) > 0) n += got;
+    return n;
+  });
+
+  // Cheap handlers, called through std::function (OnGetline) or inlined (for_each_line).
+  const mio::StringReader::OnGetline count_line = [n = size_t{0}](std::string_view) mutable { ++n; };
+  size_t hash = 14695981039346656037ull;
+  const mio::StringReader::OnGetline hash_line = [&hash](std::string_view line) {
+    hash = (hash ^ line.size()) * 1099511628211ull;
+  };
+
+  report("count, std::function", bytes, [&] {
+    mio::StringReader reader(path.string());
+    return reader.getline(count_line) - 1; // the empty view at end of file
+  });
+  report("count, for_each_line", bytes, [&] {
+    mio::StringReader reader(path.string());
+    size_t n = 0;
+    reader.for_each_line([&](std::string_view) { ++n; });
+    return n;
+  });
+  report("hash, std::function", bytes, [&] {
+    mio::StringReader reader(path.string());
+    return reader.getline(hash_line) - 1;
+  });
+  report("hash, for_each_line", bytes, [&] {
+    mio::StringReader reader(path.string());
+    size_t h = 14695981039346656037ull;
+    const size_t n = reader.for_each_line([&](std::string_view line) { h = (h ^ line.size()) * 1099511628211ull; });
+    hash ^= h;
+    return n;
+  });
+  report("hash, scan + std::function", bytes, [&] {
+    // The same scanning loop as for_each_line: only the indirect call differs.
+    mio::mmap_source m(path.string());
+    return mio::detail::line_chunks::for_each(m.begin(), m.end(), hash_line);
+  });
+
+  // Parallel scaling, a reduction over 1 MiB chunks handed out by work stealing.
+  const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; ; threads = std::min(threads * 2, hardware)) {
+    mio::thread_pool pool(threads);
+    const std::string name = "parallel, " + std::to_string(threads) + " threads";
+    report(name.c_str(), bytes, [&] {
+      mio::StringReader reader(path.string());
+      return reader.reduce_lines(pool, size_t{0}, [](size_t &n, std::string_view) { ++n; }, std::plus<>{});
+    });
+    if (threads == hardware) break;
+  }
+}
@@ -0,0 +1,115 @@
+#include <mio/mio.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Scan throughput of a mapped file under each mapping option, with the file
+// evicted from the page cache first (cold) and right after a first scan (warm).
+//
+//   mio.bench_map [file-size-in-MiB, default 256] [path, default bench-map.dat]
+//
+// A file is generated at `path` if it does not exist or is smaller than asked.
+// Dropping clean pages of the file from the page cache needs no privilege on
+// Linux (posix_fadvise); elsewhere, cold numbers are only as cold as the OS
+// leaves them.
+
+namespace {
+
+struct option_case
+{
+  const char *name;
+  mio::map_options options;
+};
+
+void make_file(const std::filesystem::path &path, size_t size)
+{
+  std::error_code ec;
+  if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) >= size) return;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  std::string line;
+  for (size_t written = 0, i = 0; written < size; written += line.size(), ++i) {
+    line = std::to_string(i) + ",link," + std::to_string(i * 7 % 1000) + ",node,"
+         + std::to_string(i * 13 % 100000) + "\n";
+    out << line;
+  }
+}
+
+void drop_cache(const std::filesystem::path &path)
+{
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+#else
+  (void) path;
+#endif
+}
+
+// Counts lines, touching every byte once.
+size_t scan(const mio::mmap_source &m)
+{
+  return static_cast<size_t>(std::count(m.begin(), m.end(), '\n'));
+}
+
+double run(const std::filesystem::path &path, const mio::map_options &options, size_t &lines)
+{
+  using namespace std::chrono;
+
+  const auto t0 = steady_clock::now();
+  std::error_code error;
+  // Mapping is timed too: MAP_POPULATE moves the page faults there.
+  auto m = mio::make_mmap_source(path.string(), options, error);
+  if (error) {
+    std::printf("Error mapping file: %s\n", error.message().c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  lines = scan(m);
+  const auto t1 = steady_clock::now();
+
+  const double seconds = duration_cast<duration<double>>(t1 - t0).count();
+  return static_cast<double>(m.size()) / (1024.0 * 1024.0) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  const size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+  const std::filesystem::path path = argc > 2 ? argv[2] : "bench-map.dat";
+
+  make_file(path, mib * 1024 * 1024);
+
+  option_case cases[] = {
+      {"default", {}},
+      {"sequential", {mio::advice::sequential}},
+      {"random", {mio::advice::random}},
+      {"willneed", {mio::advice::willneed}},
+      {"dontneed", {mio::advice::dontneed}},
+      {"populate", {mio::advice::normal, true}},
+      {"populate+sequential", {mio::advice::sequential, true}},
+      {"huge_pages", {mio::advice::normal, false, true}},
+      {"copy_on_write", {mio::advice::normal, false, false, true}},
+  };
+
+  std::printf("%-22s %12s %12s %12s\n", "option", "cold MiB/s", "warm MiB/s", "lines");
+  for (const auto &c : cases) {
+    size_t lines = 0;
+    drop_cache(path);
+    const double cold = run(path, c.options, lines);
+    const double warm = run(path, c.options, lines);
+    std::printf("%-22s %12.0f %12.0f %12zu\n", c.name, cold, warm, lines);
+  }
+}
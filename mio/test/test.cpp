@@ -1,19 +1,34 @@
+#include <mio/bufferedreader.hpp>
+#include <mio/csvreader.hpp>
+#include <mio/lineindex.hpp>
 #include <mio/mio.hpp>
+#include <mio/parallel.hpp>
 #include <mio/stringreader.hpp>
+#include <mio/stringwriter.hpp>
+#include <mio/windowedreader.hpp>
 
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <numeric>
+#include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <vector>
 
 #ifndef _WIN32
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
 // Just make sure this compiles.
@@ -31,8 +46,26 @@ void test_at_offset(const std::string &buffer, const char *path,
 
 int handle_error(const std::error_code &error);
 
+void test_map_options(const std::string &buffer, const char *path);
+
+void test_sync();
+
+void test_linescan();
+
+void test_parallel();
+
+void test_csvreader();
+
 void test_stringreader();
 
+void test_windowedreader();
+
+void test_bufferedreader();
+
+void test_lineindex();
+
+void test_stringwriter();
+
 int main()
 {
   std::error_code error;
@@ -133,6 +166,25 @@ int main()
 #endif
   }
 
+  test_map_options(buffer, path);
+
+  test_sync();
+
+  test_linescan();
+
+  test_parallel();
+
+  test_csvreader();
+
+  test_windowedreader();
+
+  test_bufferedreader();
+
+  test_lineindex();
+
+  test_stringwriter();
+
+  // Last: it needs a CSV fixture of its own next to the binary.
   test_stringreader();
 
   std::printf("all tests passed!\n");
@@ -181,6 +233,417 @@ void test_at_offset(const MMap &file_view, const std::string &buffer,
   }
 }
 
+void test_map_options(const std::string &buffer, const char *path)
+{
+  std::error_code error;
+  const auto page_size = mio::page_size();
+
+  for (const auto hint : {mio::advice::normal, mio::advice::sequential, mio::advice::random,
+                          mio::advice::willneed, mio::advice::dontneed, mio::advice::hugepage}) {
+    mio::map_options options;
+    options.hint = hint;
+    options.populate = (hint == mio::advice::willneed);
+    options.huge_pages = (hint == mio::advice::hugepage);
+    auto m = mio::make_mmap_source(path, page_size + 3, mio::map_entire_file, options, error);
+    assert(!error);
+    assert(m.size() == buffer.size() - page_size - 3);
+    test_at_offset(m, buffer, page_size + 3);
+  }
+
+  {
+    auto m = mio::make_mmap_source(path, 3, mio::map_entire_file, error);
+    assert(!error);
+    // Ranges are relative to data(), and widened to whole pages.
+    m.advise(0, mio::map_entire_file, mio::advice::random, error);
+    assert(!error);
+    m.advise(page_size, 10, mio::advice::sequential, error);
+    assert(!error);
+    m.prefetch(2 * page_size - 1, 2, error);
+    assert(!error);
+    m.advise(m.size(), 0, mio::advice::normal, error);
+    assert(!error);
+    m.advise(m.size() + 1, 0, mio::advice::normal, error);
+    assert(error);
+    m.prefetch(1, m.size(), error);
+    assert(error);
+    test_at_offset(m, buffer, 3);
+
+    mio::mmap_source unmapped;
+    unmapped.prefetch(0, 1, error);
+    assert(error);
+  }
+
+  {
+    // Writes to a copy-on-write mapping never reach the file.
+    mio::map_options options;
+    options.copy_on_write = true;
+    {
+      auto m = mio::make_mmap_sink(path, options, error);
+      assert(!error);
+      std::fill(m.begin(), m.end(), '*');
+      assert(m[0] == '*' && m[m.size() - 1] == '*');
+      m.sync(error);
+    }
+    auto m = mio::make_mmap_source(path, error);
+    assert(!error);
+    test_at_offset(m, buffer, 0);
+
+    mio::shared_mmap_sink shared;
+    shared.map(path, options, error);
+    assert(!error);
+    shared[0] = '*';
+    shared.prefetch(0, mio::map_entire_file, error);
+    assert(!error);
+    assert(m[0] == buffer[0]);
+  }
+}
+
+void test_linescan()
+{
+  // Lines of 0 to 150 bytes, so that newlines fall everywhere in a vector,
+  // several in one or none in a few.
+  std::string text;
+  for (int i = 0; i < 5000; ++i) {
+    text.append(static_cast<size_t>(i * 7919 % 151), static_cast<char>('a' + i % 26));
+    text += '\n';
+  }
+  text += "no newline at the end";
+
+  std::vector<const char *> expected(text.size());
+  const auto l_first = text.data(), l_last = text.data() + text.size();
+  const size_t n = mio::detail::scan_newlines_scalar(l_first, l_last, expected.data(), expected.size());
+  assert(n == 5000);
+
+  for (const auto level : {mio::simd_level::scalar, mio::simd_level::sse2,
+                           mio::simd_level::avx2, mio::simd_level::avx512}) {
+    const auto scan = mio::detail::newline_scan_for(level);
+    for (const size_t max : {size_t{1}, size_t{3}, size_t{64}, expected.size()}) {
+      std::vector<const char *> found(max);
+      size_t total = 0;
+      for (const char *p = l_first; ; ) {
+        const size_t got = scan(p, l_last, found.data(), max);
+        for (size_t i = 0; i < got; ++i) assert(found[i] == expected[total + i]);
+        total += got;
+        if (got < max) break;
+        p = found[got - 1] + 1;
+      }
+      assert(total == n);
+    }
+    // Unaligned starts and short ranges end in the scalar tail.
+    for (size_t skip = 0; skip < 70; ++skip) {
+      const char *found = nullptr;
+      const size_t got = scan(l_first + skip, l_first + skip + 80, &found, 1);
+      const char *want = std::find(l_first + skip, l_first + skip + 80, '\n');
+      assert(got == (want != l_first + skip + 80 ? 1u : 0u));
+      assert(!got || found == want);
+    }
+  }
+
+#ifndef _WIN32
+  // A kernel that has filled its quota must stop loading: the only newline
+  // sits at byte 10 and the page after it is unreadable, so scanning on
+  // towards a_last faults.
+  {
+    const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto *base = static_cast<char *>(::mmap(nullptr, 3 * page, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    assert(base != MAP_FAILED);
+    std::memset(base, 'x', page);
+    base[10] = '\n';
+    assert(::mprotect(base + page, page, PROT_NONE) == 0);
+    for (const auto level : {mio::simd_level::scalar, mio::simd_level::sse2,
+                             mio::simd_level::avx2, mio::simd_level::avx512}) {
+      const char *found = nullptr;
+      const size_t got = mio::detail::newline_scan_for(level)(base, base + 3 * page, &found, 1);
+      assert(got == 1 && found == base + 10);
+    }
+    ::munmap(base, 3 * page);
+  }
+#endif
+
+  const auto path = std::filesystem::current_path() / "linescan-test.txt";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+  }
+
+  std::vector<std::string> lines;
+  {
+    mio::StringReader reader(path.string());
+    while (!reader.eof()) lines.emplace_back(reader.getline());
+    // getline ends with an empty view, and drops an unterminated last line.
+    assert(lines.size() == 5001 && lines.back().empty());
+    lines.pop_back();
+  }
+
+  {
+    mio::StringReader reader(path.string());
+    std::string_view batch[100];
+    size_t total = 0, got;
+    while ((got = reader.getlines(batch)) > 0) {
+      for (size_t i = 0; i < got; ++i, ++total) {
+        if (total < lines.size()) assert(batch[i] == lines[total]);
+        else assert(batch[i] == "no newline at the end");
+      }
+    }
+    assert(total == 5001 && reader.eof());
+  }
+
+  {
+    mio::StringReader reader(path.string());
+    size_t ends[7];
+    size_t total = 0, begin = 0, got;
+    while ((got = reader.getlines(std::span<size_t>(ends))) > 0) {
+      for (size_t i = 0; i < got; ++i, ++total) {
+        assert(std::string_view(text).substr(begin, ends[i] - begin) ==
+               (total < lines.size() ? lines[total] : "no newline at the end"));
+        begin = ends[i] + 1;
+      }
+    }
+    assert(total == 5001 && ends[(total - 1) % 7] == text.size());
+  }
+
+  std::filesystem::remove(path);
+}
+
+void test_parallel()
+{
+  // Skewed lines: mostly short, some spanning many chunks, some empty.
+  std::string text;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 20000; ++i) {
+    const size_t len = i % 997 == 0 ? 50000 : i % 13 == 0 ? 0 : static_cast<size_t>(i * 31 % 90);
+    expected.emplace_back(len, static_cast<char>('a' + i % 26));
+    text += expected.back();
+    text += '\n';
+  }
+  expected.emplace_back("tail");
+  text += "tail";
+
+  size_t expected_bytes = 0;
+  for (const auto &line : expected) expected_bytes += line.size();
+
+  const auto l_first = text.data(), l_last = text.data() + text.size();
+  for (const size_t threads : {1, 3, 8}) {
+    mio::thread_pool pool(threads);
+    assert(pool.size() == threads);
+
+    for (const size_t chunk : {size_t{7}, size_t{64}, size_t{4096}, mio::default_chunk_size}) {
+      struct state { size_t lines = 0, bytes = 0; };
+      std::vector<state> states;
+      const size_t n = mio::parallel_for_each_line(pool, l_first, l_last, states,
+          [](std::string_view line, state &s) { s.lines++; s.bytes += line.size(); }, chunk);
+      assert(n == expected.size() && states.size() == threads);
+      size_t lines = 0, bytes = 0;
+      for (const auto &s : states) lines += s.lines, bytes += s.bytes;
+      assert(lines == expected.size() && bytes == expected_bytes);
+
+      size_t i = 0;
+      const size_t m = mio::parallel_transform_lines(pool, l_first, l_last,
+          [](std::string_view line) { return std::string(line); },
+          [&](std::string &&line) { assert(line == expected[i]); ++i; }, chunk);
+      assert(m == expected.size() && i == expected.size());
+    }
+
+    // The pool is reusable after a job throws.
+    bool thrown = false;
+    try {
+      pool.run([](size_t worker) { if (worker == 0) throw std::runtime_error("worker 0"); });
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    assert(thrown);
+    std::atomic<size_t> ran{0};
+    pool.run([&](size_t) { ran++; });
+    assert(ran == threads);
+  }
+
+  {
+    mio::thread_pool pool(3);
+    std::atomic<size_t> ran{0};
+    // A run nested in a job of the same pool runs inline instead of deadlocking.
+    pool.run([&](size_t) { pool.run([&](size_t) { ran++; }); });
+    assert(ran == 9);
+  }
+
+  {
+    mio::thread_pool pool(4);
+    const auto longest = mio::parallel_reduce_lines(
+        pool, l_first, l_last, size_t{0},
+        [](size_t &max, std::string_view line) { max = std::max(max, line.size()); },
+        [](size_t a, size_t b) { return std::max(a, b); }, 4096);
+    assert(longest == 50000);
+  }
+
+  const auto path = std::filesystem::current_path() / "parallel-test.txt";
+  {
+    std::ofstream out(path, std::ios::binary);
+    for (int i = 0; i < 100; ++i) out << text;
+  }
+  {
+    mio::StringReader reader(path.string());
+    std::atomic<size_t> lines{0};
+    // 99 times all the lines, "tail" being glued to the first line of the next copy.
+    assert(reader.getline_async<16>([&](std::string_view) { lines++; }) == 100 * expected.size() - 99);
+    assert(lines == 100 * expected.size() - 99 && reader.eof());
+  }
+  {
+    // Below MinFileByteSize: read in sequence, still without an empty line at the end.
+    const auto small = std::filesystem::current_path() / "parallel-small.txt";
+    std::ofstream(small, std::ios::binary) << "a\nb\n";
+    {
+      mio::StringReader reader(small.string());
+      size_t lines = 0;
+      assert(reader.getline_async([&](std::string_view a_line) { assert(!a_line.empty()); ++lines; }) == 2);
+      assert(lines == 2 && reader.eof());
+    }
+    std::filesystem::remove(small);
+  }
+  {
+    const size_t total = 100 * expected.size() - 99;
+    mio::thread_pool pool(3);
+
+    mio::StringReader sequential(path.string());
+    size_t lines = 0;
+    assert(sequential.for_each_line([&](std::string_view) { ++lines; }) == total && lines == total);
+    assert(sequential.eof() && sequential.for_each_line([](std::string_view) { assert(0); }) == 0);
+
+    mio::StringReader parallel(path.string());
+    std::atomic<size_t> parallel_lines{0};
+    assert(parallel.for_each_line(pool, [&](std::string_view) { parallel_lines++; }) == total);
+    assert(parallel_lines == total);
+
+    mio::StringReader folded(path.string());
+    const size_t bytes = folded.reduce_lines(size_t{0}, [](size_t &sum, std::string_view line) { sum += line.size(); });
+    assert(bytes == 100 * expected_bytes);
+
+    mio::StringReader reduced(path.string());
+    assert(reduced.reduce_lines(pool, size_t{0},
+                                [](size_t &sum, std::string_view line) { sum += line.size(); },
+                                std::plus<>{}) == bytes);
+  }
+  std::filesystem::remove(path);
+}
+
+void test_csvreader()
+{
+  const auto path = std::filesystem::current_path() / "csvreader-test.csv";
+  const auto write = [&](const std::string &text) {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+  };
+
+  write("id,name,length\r\n"
+        "1,plain,2.5\r\n"
+        "\r\n"
+        "2,\"with, comma\",-3\n"
+        "3,\"with \"\"quotes\"\" and\nnewline\",1e3\n"
+        "4,,\n"
+        "5\n"
+        "6,last, 7 ");
+  {
+    mio::CsvReader reader(path.string(), {.header = true});
+    assert(reader.header().size() == 3 && reader.header()[2] == "length");
+    assert(reader.column("name") == 1 && reader.column("none") == mio::CsvReader::npos);
+
+    std::vector<std::string_view> fields;
+    assert(reader.next_row(fields) && fields.size() == 3 && fields[1] == "plain" && fields[2] == "2.5");
+    assert(reader.next_row(fields) && fields.size() == 3 && fields[1] == "with, comma");
+    int length = 0;
+    assert(mio::parse_field(fields[2], length) && length == -3);
+    assert(reader.next_row(fields) && fields.size() == 3);
+    std::string name;
+    mio::parse_field(fields[1], name);
+    assert(name == "with \"quotes\" and\nnewline");
+    double value = 0;
+    assert(mio::parse_field(fields[2], value) && value == 1000);
+    assert(!mio::parse_field(fields[1], value) && value == 1000);
+    assert(reader.next_row(fields) && fields.size() == 3 && fields[1].empty() && fields[2].empty());
+    assert(reader.next_row(fields) && fields.size() == 1 && fields[0] == "5");
+    assert(reader.next_row(fields) && fields.size() == 3 && fields[2] == " 7 ");
+    assert(mio::parse_field(fields[2], length) && length == 7);
+    assert(!reader.next_row(fields) && !reader.next_row(fields));
+
+    mio::thread_pool pool(2);
+    auto [ids, names, lengths] = reader.read_columns<int, std::string, double>(pool, {"id", "name", "length"});
+    assert(ids == std::vector<int>({1, 2, 3, 4, 5, 6}));
+    assert(names[1] == "with, comma" && names[4].empty() && names[5] == "last");
+    assert(lengths[0] == 2.5 && lengths[2] == 1000 && std::isnan(lengths[3]) && std::isnan(lengths[4]));
+  }
+
+  {
+    write("a\tb\tc\nx\t\"y\tz\"\t\n");
+    mio::CsvReader reader(path.string(), {.delimiter = '\t'});
+    size_t rows = reader.for_each_row([](std::span<const std::string_view> fields) {
+      assert(fields.size() == 3);
+    });
+    assert(rows == 2);
+  }
+
+  {
+    // Another quote character, doubled inside quoted fields as well.
+    write("1;'it''s';\"x\"\"\n");
+    mio::CsvReader reader(path.string(), {.delimiter = ';', .quote = '\''});
+    std::vector<std::string_view> fields;
+    assert(reader.next_row(fields) && fields.size() == 3);
+    std::string name;
+    assert(mio::parse_field(fields[1], name, reader.options()) && name == "it's");
+    assert(mio::parse_field(fields[2], name, reader.options()) && name == "\"x\"\"");
+    mio::thread_pool pool(2);
+    auto [names] = reader.read_columns<std::string>(pool, {1});
+    assert(names.size() == 1 && names[0] == "it's");
+  }
+
+  // Every SIMD level and chunk size against a reference, on rows with quoted
+  // newlines and delimiters falling anywhere in the 64-byte blocks.
+  std::string text;
+  std::vector<std::vector<std::string>> expected;
+  for (int i = 0; i < 3000; ++i) {
+    std::vector<std::string> row;
+    std::string line;
+    for (int j = 0; j < 1 + i % 5; ++j) {
+      std::string field(static_cast<size_t>(1 + (i * 7 + j * 13) % 40), static_cast<char>('a' + j));
+      if ((i + j) % 7 == 0) {
+        field += i % 2 ? "\n" : ",";
+        line += (j ? "," : "") + ("\"" + field + "\"");
+      } else {
+        line += (j ? "," : "") + field;
+      }
+      row.push_back(field);
+    }
+    text += line + (i % 3 ? "\n" : "\r\n");
+    expected.push_back(row);
+  }
+  write(text);
+
+  for (const auto level : {mio::simd_level::scalar, mio::simd_level::sse2,
+                           mio::simd_level::avx2, mio::simd_level::avx512}) {
+    mio::detail::csv_tokenizer tokenizer(text.data(), text.data() + text.size(), {}, level);
+    std::vector<std::string_view> fields;
+    size_t i = 0;
+    for (; tokenizer.next_row(fields); ++i) {
+      assert(i < expected.size() && fields.size() == expected[i].size());
+      for (size_t j = 0; j < fields.size(); ++j) assert(fields[j] == expected[i][j]);
+    }
+    assert(i == expected.size());
+  }
+
+  mio::CsvReader reader(path.string());
+  for (const size_t threads : {1, 4}) {
+    mio::thread_pool pool(threads);
+    for (const size_t chunk : {size_t{64}, size_t{1000}, mio::default_chunk_size}) {
+      auto [first, second] = reader.read_columns<std::string_view, std::string>(pool, {0, 1}, chunk);
+      assert(first.size() == expected.size() && second.size() == expected.size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        assert(first[i] == expected[i][0]);
+        assert(second[i] == (expected[i].size() > 1 ? expected[i][1] : ""));
+      }
+    }
+  }
+
+  std::filesystem::remove(path);
+}
+
 int handle_error(const std::error_code &error)
 {
   const auto &errmsg = error.message();
@@ -237,3 +700,453 @@ void test_stringreader()
     std::cout << std::flush;
   }
 }
+
+void test_windowedreader()
+{
+  const auto path = std::filesystem::current_path() / "windowedreader-test.txt";
+  const size_t page = mio::page_size();
+
+  // Lines of every length around the window size, one several windows long,
+  // with and without a newline at the end of the file, and an empty file.
+  std::string text;
+  for (size_t i = 0; i < 2000; ++i) {
+    text += std::string((i * 37) % (page / 2), static_cast<char>('a' + i % 26)) + "\n";
+    if (i == 1000) text += std::string(5 * page + 7, 'L') + "\n";
+  }
+  for (const std::string &content : {text, text + "tail", std::string{}, std::string{"\n"}}) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << content;
+    }
+
+    std::vector<std::string> expected;
+    if (!content.empty()) {
+      mio::StringReader reader(path.string());
+      while (!reader.eof()) expected.emplace_back(reader.getline());
+    } else {
+      expected.emplace_back();
+    }
+
+    for (const auto &options : {mio::window_options{.window_size = 2 * page},
+                                mio::window_options{.window_size = 3 * page + 1, .release_step = 1},
+                                mio::window_options::capped(4 * page)}) {
+      mio::WindowedReader reader(path.string(), options);
+      assert(reader.is_mapped() && reader.size() == content.size());
+      std::vector<std::string> lines;
+      while (!reader.eof()) {
+        lines.emplace_back(reader.getline());
+        // The window is as asked, but for the long line.
+        assert(reader.mapped_length() <= std::max(options.window_size, 2 * (5 * page + 7)) + page);
+      }
+      assert(lines == expected);
+      assert(reader.mapped_length() == 0);
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::remove(path, error);
+
+  bool thrown = false;
+  try {
+    mio::WindowedReader reader((std::filesystem::current_path() / "no-such-file").string());
+  } catch (const std::system_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_bufferedreader()
+{
+  const auto path = std::filesystem::current_path() / "bufferedreader-test.txt";
+
+  // Short lines, empty lines, and lines longer than a block and its headroom.
+  std::string text;
+  for (size_t i = 0; i < 3000; ++i) {
+    text += std::string((i * 13) % 97, static_cast<char>('a' + i % 26)) + "\n";
+    if (i % 1000 == 500) text += std::string(100000 + i, 'L') + "\n";
+  }
+
+  const auto read_all = [](auto &reader) {
+    std::vector<std::string> lines;
+    while (!reader.eof()) lines.emplace_back(reader.getline());
+    return lines;
+  };
+
+  for (const std::string &content : {text, text + "tail", std::string{}}) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << content;
+    }
+
+    std::vector<std::string> expected{std::string{}};
+    if (!content.empty()) {
+      mio::StringReader reader(path.string());
+      expected = read_all(reader);
+    }
+
+    for (const size_t block_size : {size_t{61}, size_t{4096}, size_t{1} << 20}) {
+      for (const bool prefetch : {false, true}) {
+        mio::BufferedReader reader(path.string(), {.block_size = block_size, .prefetch = prefetch});
+        assert(read_all(reader) == expected);
+        assert(reader.getline().data() == nullptr);
+      }
+    }
+
+    // A regular file is mapped, unless empty.
+    mio::LineReader reader(path.string());
+    assert(reader.is_mapped() == !content.empty());
+    assert(read_all(reader) == expected);
+  }
+
+  // Stopping early, with the helper thread still reading ahead.
+  {
+    mio::BufferedReader reader(path.string(), {.block_size = 64});
+    reader.getline();
+  }
+
+#ifndef _WIN32
+  // A pipe, written to in small pieces while it is read.
+  {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+    std::vector<std::string> expected;
+    {
+      mio::StringReader reader(path.string());
+      expected = read_all(reader);
+    }
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    std::thread writer([&] {
+      for (size_t i = 0; i < text.size(); i += 777) {
+        const size_t n = std::min<size_t>(777, text.size() - i);
+        assert(write(fds[1], text.data() + i, n) == static_cast<ssize_t>(n));
+      }
+      close(fds[1]);
+    });
+    {
+      assert(!mio::detail::is_mappable(fds[0]));
+      mio::BufferedReader reader(fds[0], {.block_size = 10000}, true);
+      assert(read_all(reader) == expected);
+    }
+    writer.join();
+
+    // A FIFO by name goes to the buffered reader.
+    const auto fifo = std::filesystem::current_path() / "bufferedreader-test.fifo";
+    std::error_code error;
+    std::filesystem::remove(fifo, error);
+    assert(mkfifo(fifo.c_str(), 0600) == 0);
+    std::thread fifo_writer([&] {
+      std::ofstream(fifo, std::ios::binary) << text;
+    });
+    {
+      mio::LineReader reader(fifo.string());
+      assert(!reader.is_mapped());
+      assert(read_all(reader) == expected);
+    }
+    fifo_writer.join();
+    std::filesystem::remove(fifo, error);
+  }
+
+  // A line comes out as soon as it is written, not once a block is full.
+  {
+    int fds[2];
+    assert(pipe(fds) == 0);
+    std::promise<void> got_first;
+    bool waited = false;
+    std::thread writer([&] {
+      assert(write(fds[1], "first\n", 6) == 6);
+      waited = got_first.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+      assert(write(fds[1], "second\n", 7) == 7);
+      close(fds[1]);
+    });
+    {
+      mio::BufferedReader reader(fds[0], {.block_size = size_t{1} << 20}, true);
+      assert(reader.getline() == "first");
+      got_first.set_value();
+      assert(reader.getline() == "second");
+      assert(reader.getline().data() == nullptr && reader.eof());
+    }
+    writer.join();
+    assert(waited);
+  }
+
+  // Going away while the helper waits in a read on a pipe that stays open.
+  {
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], "first\n", 6) == 6);
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+      mio::BufferedReader reader(fds[0], {}, true);
+      assert(reader.getline() == "first");
+    }
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(5));
+    close(fds[1]);
+  }
+
+  // A handle it does not own, such as stdin, is read ahead too: the read
+  // waiting when the reader goes away is cancelled, the handle stays open
+  // and what is written afterwards is there for the next one.
+  for (const bool prefetch : {false, true}) {
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], "first\n", 6) == 6);
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+      mio::BufferedReader reader(fds[0], {.prefetch = prefetch});
+      assert(reader.getline() == "first");
+    }
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(5));
+    assert(write(fds[1], "later\n", 6) == 6);
+    char buf[8] = {};
+    assert(read(fds[0], buf, sizeof(buf)) == 6 && std::string(buf, 6) == "later\n");
+    close(fds[0]);
+    close(fds[1]);
+  }
+#endif
+
+  std::error_code error;
+  std::filesystem::remove(path, error);
+}
+
+void test_lineindex()
+{
+  const auto path = (std::filesystem::current_path() / "lineindex-test.txt").string();
+  const std::string index_path = mio::LineIndex::sidecar_path(path);
+
+  std::string text;
+  for (size_t i = 0; i < 5000; ++i) text += std::string(i * 7 % 50, static_cast<char>('a' + i % 26)) + "\n";
+
+  mio::thread_pool pool(3);
+  for (const std::string &content : {text, text + "tail", std::string{"\n\n"}, std::string{}}) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << content;
+    }
+    std::vector<std::string> expected;
+    for (size_t begin = 0, end; begin < content.size(); begin = end + 1) {
+      end = std::min(content.find('\n', begin), content.size());
+      expected.push_back(content.substr(begin, end - begin));
+    }
+
+    for (const uint32_t stride : {mio::LineIndex::exact_stride, 3u, 1024u}) {
+      mio::LineIndex::build(pool, path, index_path, stride);
+      mio::LineIndex index(index_path);
+      assert(index.matches(path) && index.stride() == stride);
+      assert(index.lines() == expected.size() && index.file_size() == content.size());
+      if (content.empty()) continue;
+
+      mio::StringReader reader(path);
+      for (size_t line = 0; line < expected.size(); line += 1 + line % 17) {
+        assert(reader.seek_line(index, line));
+        const auto got = reader.getline();
+        assert(got == expected[line] || (reader.eof() && line + 1 == expected.size()));
+      }
+      assert(!reader.seek_line(index, expected.size()) && reader.eof());
+
+      for (const size_t parts : {1, 4, 7}) {
+        const auto ranges = reader.partition(index, parts);
+        assert(ranges.size() == parts);
+        size_t line = 0;
+        for (size_t i = 0; i < parts; ++i) {
+          const size_t count = mio::detail::line_chunks::for_each(
+              ranges[i].data(), ranges[i].data() + ranges[i].size(),
+              [&](std::string_view got) { assert(got == expected[line++]); });
+          assert(count == expected.size() * (i + 1) / parts - expected.size() * i / parts);
+        }
+        assert(line == expected.size());
+      }
+    }
+  }
+
+  // A stale or damaged index is rebuilt.
+  {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+    std::ofstream(index_path, std::ios::binary | std::ios::trunc) << "not an index";
+    bool thrown = false;
+    try {
+      mio::LineIndex index(index_path);
+    } catch (const std::system_error &) {
+      thrown = true;
+    }
+    assert(thrown);
+
+    auto index = mio::LineIndex::open_or_build(path, 16, pool);
+    assert(index.lines() == 5000 && index.stride() == 16);
+
+    std::ofstream(path, std::ios::binary | std::ios::app) << "one more\n";
+    assert(!index.matches(path));
+    index = mio::LineIndex::open_or_build(path, 16, pool);
+    assert(index.lines() == 5001 && index.matches(path));
+    assert(mio::LineIndex::open_or_build(path, 16, pool).lines() == 5001);
+  }
+
+  // Concurrent builds of the same index: each writes its own temporary file,
+  // and the index is whole whichever rename comes last.
+  {
+    std::vector<std::thread> builders;
+    for (const uint32_t stride : {1u, 2u, 5u, 1024u})
+      builders.emplace_back([&, stride] { mio::LineIndex::build(path, index_path, stride); });
+    for (auto &builder : builders) builder.join();
+    mio::LineIndex index(index_path);
+    assert(index.lines() == 5001 && index.matches(path));
+    for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::current_path()))
+      assert(entry.path().string().find(index_path + ".tmp") == std::string::npos);
+  }
+
+  std::error_code error;
+  std::filesystem::remove(path, error);
+  std::filesystem::remove(index_path, error);
+}
+
+void test_stringwriter()
+{
+  const auto path = (std::filesystem::current_path() / "stringwriter-test.txt").string();
+  const size_t page = mio::page_size();
+  const auto read_file = [&] {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  };
+
+  // Lines of every length around the chunk sizes, and bytes with no newline.
+  std::string expected;
+  for (const bool background_sync : {false, true}) {
+    const mio::writer_options options{.chunk_size = page, .max_chunk_size = 4 * page,
+                                      .background_sync = background_sync};
+    expected.clear();
+    {
+      mio::StringWriter writer(path, options);
+      assert(writer.is_open() && writer.size() == 0);
+      for (size_t i = 0; i < 1000; ++i) {
+        const std::string line(i * 31 % (page + 100), static_cast<char>('a' + i % 26));
+        if (i % 10 == 0) {
+          writer.write(line);
+          expected += line;
+        } else {
+          writer.writeline(line);
+          expected += line + "\n";
+        }
+        if (i == 500) {
+          const std::string huge(10 * page + 3, 'H');
+          writer.writeline(huge);
+          expected += huge + "\n";
+        }
+        assert(writer.size() == expected.size());
+      }
+      writer.close();
+      assert(!writer.is_open());
+      writer.close();
+    }
+    assert(std::filesystem::file_size(path) == expected.size());
+    assert(read_file() == expected);
+
+    // Appending, closed by the destructor.
+    {
+      mio::writer_options append = options;
+      append.append = true;
+      mio::StringWriter writer(path, append);
+      assert(writer.size() == expected.size());
+      writer.writeline("appended");
+    }
+    expected += "appended\n";
+    assert(read_file() == expected);
+
+    mio::StringReader reader(path);
+    size_t lines = 0;
+    reader.for_each_line([&](std::string_view) { ++lines; });
+    assert(lines == static_cast<size_t>(std::count(expected.begin(), expected.end(), '\n')));
+  }
+
+  // Nothing written: an empty file, even over an existing one.
+  {
+    mio::StringWriter writer(path);
+    writer.write({}); // no chunk mapped yet
+    assert(writer.size() == 0);
+  }
+  assert(std::filesystem::exists(path) && std::filesystem::file_size(path) == 0);
+
+  bool thrown = false;
+  try {
+    mio::StringWriter writer((std::filesystem::current_path() / "no-such-dir" / "file").string());
+  } catch (const std::system_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  std::error_code error;
+  std::filesystem::remove(path, error);
+}
+
+void test_sync()
+{
+  const auto path = (std::filesystem::current_path() / "sync-test.bin").string();
+  const size_t page = mio::page_size();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << std::string(16 * page, '.');
+  }
+  const auto read_file = [&] {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  };
+
+  std::error_code error;
+  {
+    // Not at a page boundary, so that ranges are widened from the mapping start.
+    mio::mmap_sink sink(path, 3, mio::map_entire_file);
+    assert(sink.sync_on_destroy());
+
+    sink[0] = 'a';
+    sink.sync(0, 1, error);
+    assert(!error);
+    sink[5 * page] = 'b';
+    sink.sync(5 * page, page, mio::sync_mode::async, error);
+    assert(!error);
+    sink.sync(mio::sync_mode::async, error);
+    assert(!error);
+    sink.sync(sink.size() - 1, mio::map_entire_file, error);
+    assert(!error);
+
+    sink.sync(sink.size() + 1, 1, error);
+    assert(error == std::errc::invalid_argument);
+    sink.sync(0, sink.size() + 1, error);
+    assert(error == std::errc::invalid_argument);
+
+    // Dirty ranges, out of order and overlapping.
+    for (const size_t at : {9 * page, 2 * page, 9 * page + 10, page - 1}) {
+      sink[at] = 'd';
+      sink.mark_dirty(at, 1);
+    }
+    sink.mark_dirty(10 * page, 3 * page);
+    sink.mark_dirty(sink.size() - 1, 100);
+    sink.sync_dirty(mio::sync_mode::blocking, error);
+    assert(!error);
+    sink.sync_dirty(mio::sync_mode::async, error);
+    assert(!error);
+
+    mio::mmap_sink moved = std::move(sink);
+    moved[12 * page] = 'm';
+    moved.mark_dirty(12 * page, 1);
+    moved.set_sync_on_destroy(false);
+    assert(!moved.sync_on_destroy());
+  }
+  const std::string content = read_file();
+  assert(content[3] == 'a' && content[3 + 5 * page] == 'b' && content[3 + 2 * page] == 'd');
+  assert(content[3 + 12 * page] == 'm');
+
+  {
+    mio::shared_mmap_sink shared(path, 0, mio::map_entire_file);
+    shared.mark_dirty(0, page);
+    shared.sync_dirty(mio::sync_mode::async, error);
+    assert(!error);
+    shared.sync(page, page, mio::sync_mode::blocking, error);
+    assert(!error);
+    shared.set_sync_on_destroy(false);
+  }
+
+  mio::mmap_sink unmapped;
+  unmapped.sync(mio::sync_mode::async, error);
+  assert(error == std::errc::bad_file_descriptor);
+
+  std::filesystem::remove(path, error);
+}